@@ -0,0 +1,135 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "dso_map.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+// Compares the flat DsoMap with the std::map it replaced, on processes with
+// many mappings (JVMs, browsers) : inserting mappings in address order
+// (procfs), in random order (mmap events) and looking up addresses.
+
+namespace {
+typedef std::map<ProcessAddress_t, ddprof::Dso> StdDsoMap;
+
+const pid_t k_pid = 10;
+const int k_nb_lookups = 1 << 20;
+
+ddprof::StringInterner s_filenames;
+
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+std::vector<ddprof::Dso> make_dsos(int nb_dsos) {
+  std::mt19937 gen(42);
+  std::vector<ddprof::Dso> dsos;
+  ProcessAddress_t start = 0x400000;
+  for (int i = 0; i < nb_dsos; ++i) {
+    ProcessAddress_t size = 0x1000 * (1 + gen() % 16);
+    std::string filename = "/usr/lib/libfoo_" + std::to_string(i % 64) + ".so";
+    dsos.emplace_back(k_pid, start, start + size - 1, 0,
+                      s_filenames.intern(filename));
+    start += size + 0x1000 * (gen() % 4);
+  }
+  return dsos;
+}
+
+void insert(ddprof::DsoMap &map, const ddprof::Dso &dso) {
+  map.insert(ddprof::Dso(dso));
+}
+
+void insert(StdDsoMap &map, const ddprof::Dso &dso) {
+  map.emplace(dso._start, dso);
+}
+
+const ddprof::Dso &get_dso(ddprof::DsoMap::const_iterator it) { return *it; }
+
+const ddprof::Dso &get_dso(StdDsoMap::const_iterator it) { return it->second; }
+
+// Same logic as DsoHdr::dso_find_closest
+const ddprof::Dso *find_closest(const ddprof::DsoMap &map,
+                                ProcessAddress_t addr) {
+  bool is_within;
+  ddprof::DsoMap::const_iterator it = map.find_closest(addr, &is_within);
+  return is_within ? &*it : nullptr;
+}
+
+template <typename MapT>
+const ddprof::Dso *find_closest(const MapT &map, ProcessAddress_t addr) {
+  auto it = map.lower_bound(addr);
+  if (it != map.end() && get_dso(it).is_within(k_pid, addr)) {
+    return &get_dso(it);
+  }
+  if (it == map.begin()) {
+    return nullptr;
+  }
+  --it;
+  return get_dso(it).is_within(k_pid, addr) ? &get_dso(it) : nullptr;
+}
+
+template <typename MapT>
+void run(const char *name, const std::vector<ddprof::Dso> &dsos) {
+  std::vector<const ddprof::Dso *> shuffled;
+  for (const ddprof::Dso &dso : dsos) {
+    shuffled.push_back(&dso);
+  }
+  std::mt19937 gen(42);
+  std::shuffle(shuffled.begin(), shuffled.end(), gen);
+
+  double start = now_s();
+  {
+    MapT map;
+    for (const ddprof::Dso &dso : dsos) {
+      insert(map, dso);
+    }
+  }
+  double sorted_ns = (now_s() - start) * 1e9 / dsos.size();
+
+  MapT map;
+  start = now_s();
+  for (const ddprof::Dso *dso : shuffled) {
+    insert(map, *dso);
+  }
+  double random_ns = (now_s() - start) * 1e9 / dsos.size();
+
+  std::vector<ProcessAddress_t> addrs;
+  ProcessAddress_t first = dsos.front()._start;
+  ProcessAddress_t span = dsos.back()._end - first;
+  for (int i = 0; i < k_nb_lookups; ++i) {
+    addrs.push_back(first + gen() % span);
+  }
+  uint64_t nb_found = 0;
+  start = now_s();
+  for (ProcessAddress_t addr : addrs) {
+    nb_found += find_closest(map, addr) != nullptr;
+  }
+  double lookup_ns = (now_s() - start) * 1e9 / k_nb_lookups;
+  printf("%-8s insert sorted %7.1f ns, insert random %7.1f ns, "
+         "lookup %6.1f ns (found %lu)\n",
+         name, sorted_ns, random_ns, lookup_ns, nb_found);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  int nb_dsos = argc > 1 ? atoi(argv[1]) : 5000;
+  if (nb_dsos <= 0) {
+    fprintf(stderr, "usage: %s [nb_mappings]\n", argv[0]);
+    return 1;
+  }
+  std::vector<ddprof::Dso> dsos = make_dsos(nb_dsos);
+  printf("%d mappings\n", nb_dsos);
+  run<StdDsoMap>("std::map", dsos);
+  run<ddprof::DsoMap>("DsoMap", dsos);
+  return 0;
+}
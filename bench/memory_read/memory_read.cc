@@ -0,0 +1,112 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "dso_hdr.hpp"
+
+#include <algorithm>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Replays the reads outside of the stack snapshot done while unwinding (the
+// memory_read path), on the binaries mapped by this process. Each frame reads
+// a few words from the binary of its pc.
+
+namespace {
+const int k_nb_frames = 64;
+
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef bool (*read_fun)(ddprof::DsoHdr &, pid_t, ElfWord_t *,
+                         ProcessAddress_t);
+
+bool read_uncached(ddprof::DsoHdr &dso_hdr, pid_t pid, ElfWord_t *word,
+                   ProcessAddress_t addr) {
+  return dso_hdr.pid_read_dso(pid, word, sizeof(ElfWord_t), addr).second;
+}
+
+bool read_cached(ddprof::DsoHdr &dso_hdr, pid_t pid, ElfWord_t *word,
+                 ProcessAddress_t addr) {
+  return dso_hdr.pid_read(pid, word, sizeof(ElfWord_t), addr);
+}
+
+// Addresses read by the frames of a stack, frames spread over the binaries
+std::vector<ProcessAddress_t> make_reads(ddprof::DsoHdr &dso_hdr, pid_t pid,
+                                         int reads_per_frame) {
+  std::vector<const ddprof::Dso *> dsos;
+  for (const ddprof::Dso &dso : dso_hdr._map[pid]) {
+    ElfWord_t word;
+    if (dso._executable &&
+        read_uncached(dso_hdr, pid, &word, dso._start + 0x1000)) {
+      dsos.push_back(&dso);
+    }
+  }
+  std::vector<ProcessAddress_t> reads;
+  if (dsos.empty()) {
+    return reads;
+  }
+  std::mt19937 gen(42);
+  for (int i = 0; i < k_nb_frames; ++i) {
+    const ddprof::Dso &dso = *dsos[gen() % dsos.size()];
+    uint64_t nb_words =
+        std::min<uint64_t>(dso._end - dso._start, 0x8000) / sizeof(ElfWord_t);
+    for (int j = 0; j < reads_per_frame; ++j) {
+      reads.push_back(dso._start +
+                      (gen() % (nb_words - 1)) * sizeof(ElfWord_t));
+    }
+  }
+  return reads;
+}
+
+void run(const char *name, ddprof::DsoHdr &dso_hdr, pid_t pid,
+         const std::vector<ProcessAddress_t> &reads, long iterations,
+         read_fun read) {
+  uint64_t checksum = 0;
+  double start = now_s();
+  for (long i = 0; i < iterations; ++i) {
+    for (ProcessAddress_t addr : reads) {
+      ElfWord_t word = 0;
+      read(dso_hdr, pid, &word, addr);
+      checksum += word;
+    }
+  }
+  double elapsed = now_s() - start;
+  double nb_reads = static_cast<double>(reads.size()) * iterations;
+  printf("%-10s %8.1f ns/read %10.0f ns/frame (checksum %lu)\n", name,
+         elapsed * 1e9 / nb_reads,
+         elapsed * 1e9 / (static_cast<double>(k_nb_frames) * iterations),
+         checksum);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 10000;
+  int reads_per_frame = argc > 2 ? atoi(argv[2]) : 4;
+  if (iterations <= 0 || reads_per_frame <= 0) {
+    fprintf(stderr, "usage: %s [iterations] [reads_per_frame]\n", argv[0]);
+    return 1;
+  }
+  ddprof::DsoHdr dso_hdr;
+  pid_t pid = getpid();
+  int nb_elts = 0;
+  dso_hdr.pid_backpopulate(pid, nb_elts);
+  std::vector<ProcessAddress_t> reads =
+      make_reads(dso_hdr, pid, reads_per_frame);
+  if (reads.empty()) {
+    fprintf(stderr, "No readable binary\n");
+    return 1;
+  }
+  printf("%d frames, %d reads per frame\n", k_nb_frames, reads_per_frame);
+  run("uncached", dso_hdr, pid, reads, iterations, read_uncached);
+  run("cached", dso_hdr, pid, reads, iterations, read_cached);
+  return 0;
+}
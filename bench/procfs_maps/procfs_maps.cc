@@ -0,0 +1,158 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "dso_hdr.hpp"
+
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+
+// Backpopulates the DSOs of a process from a large synthetic maps file (JVMs
+// can have tens of thousands of mappings, most of them anonymous). Compares
+// the getline + sscanf parsing that was used before with ProcMapsReader.
+
+namespace {
+const pid_t k_pid = 10;
+
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// A fifth of the mappings are segments of shared libraries, others are
+// anonymous (java heap, thread stacks, code cache)
+bool write_maps(const char *path, int nb_mappings) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+  std::mt19937 gen(42);
+  static const char *perms[] = {"r--p", "r-xp", "r--p", "rw-p"};
+  uint64_t start = 0x7f0000000000;
+  for (int i = 0; i < nb_mappings; ++i) {
+    uint64_t end = start + 0x1000 * (1 + gen() % 64);
+    if (i % 5 == 0) {
+      int lib = i / 5;
+      fprintf(file,
+              "%lx-%lx %s %08x fe:01 %-10d               "
+              "/usr/lib/x86_64-linux-gnu/libfoo_%d.so\n",
+              start, end, perms[lib % 4], (lib % 4) * 0x1000, 3932979 + lib,
+              lib / 4);
+    } else {
+      fprintf(file, "%lx-%lx %s 00000000 00:00 0 \n", start, end,
+              gen() % 16 ? "rw-p" : "rwxp");
+    }
+    start = end + 0x1000 * (gen() % 2);
+  }
+  fclose(file);
+  return true;
+}
+
+// Parsing used before ProcMapsReader
+int parse_sscanf(ddprof::DsoHdr &dso_hdr, const char *path,
+                 ddprof::DsoMap &map) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return 0;
+  }
+  static const char spec[] = "%lx-%lx %4c %lx %*x:%*x %*d%n";
+  char *buf = NULL;
+  size_t sz_buf = 0;
+  int nb_dsos = 0;
+  while (-1 != getline(&buf, &sz_buf, file)) {
+    uint64_t m_start = 0;
+    uint64_t m_end = 0;
+    uint64_t m_off = 0;
+    char m_mode[4] = {0};
+    int m_p = 0;
+    if (4 != sscanf(buf, spec, &m_start, &m_end, m_mode, &m_off, &m_p)) {
+      continue;
+    }
+    char *p = &buf[m_p], *q;
+    while (isspace(*p))
+      p++;
+    if ((q = strchr(p, '\n')))
+      *q = '\0';
+    nb_dsos += map.insert(ddprof::Dso(k_pid, m_start, m_end - 1, m_off,
+                                      dso_hdr.intern_filename(p),
+                                      'x' == m_mode[2]))
+                   .second;
+  }
+  free(buf);
+  fclose(file);
+  return nb_dsos;
+}
+
+int parse_reader(ddprof::DsoHdr &dso_hdr, ddprof::ProcMapsReader &reader,
+                 const char *path, ddprof::DsoMap &map, bool all) {
+  if (!reader.read(path)) {
+    return 0;
+  }
+  int nb_dsos = 0;
+  ddprof::ProcMapsEntry entry;
+  while (reader.next(entry)) {
+    if (!all && !ddprof::DsoHdr::is_relevant_mapping(entry)) {
+      continue;
+    }
+    nb_dsos += map.insert(dso_hdr.dso_from_maps_entry(k_pid, entry)).second;
+  }
+  return nb_dsos;
+}
+
+template <typename Fun>
+void run(const char *name, int iterations, int nb_mappings, Fun fun) {
+  int nb_dsos = 0;
+  double start = now_s();
+  for (int i = 0; i < iterations; ++i) {
+    ddprof::DsoMap map;
+    nb_dsos = fun(map);
+  }
+  double elapsed = now_s() - start;
+  printf("%-16s %8.2f ms/backpopulate %7.1f ns/line (%d DSOs)\n", name,
+         elapsed * 1e3 / iterations,
+         elapsed * 1e9 / (static_cast<double>(iterations) * nb_mappings),
+         nb_dsos);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  int nb_mappings = argc > 1 ? atoi(argv[1]) : 20000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 100;
+  if (nb_mappings <= 0 || iterations <= 0) {
+    fprintf(stderr, "usage: %s [nb_mappings] [iterations]\n", argv[0]);
+    return 1;
+  }
+  char path[] = "/tmp/procfs_maps.XXXXXX";
+  int fd = mkstemp(path);
+  if (fd == -1) {
+    fprintf(stderr, "Unable to create maps file\n");
+    return 1;
+  }
+  close(fd);
+  if (!write_maps(path, nb_mappings)) {
+    fprintf(stderr, "Unable to write maps file\n");
+    unlink(path);
+    return 1;
+  }
+  ddprof::DsoHdr dso_hdr;
+  ddprof::ProcMapsReader reader;
+  printf("%d mappings\n", nb_mappings);
+  run("getline+sscanf", iterations, nb_mappings,
+      [&](ddprof::DsoMap &map) { return parse_sscanf(dso_hdr, path, map); });
+  run("reader (all)", iterations, nb_mappings,
+      [&](ddprof::DsoMap &map) {
+        return parse_reader(dso_hdr, reader, path, map, true);
+      });
+  run("reader", iterations, nb_mappings, [&](ddprof::DsoMap &map) {
+    return parse_reader(dso_hdr, reader, path, map, false);
+  });
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "perf_ringbuffer.h"
+
+// Decodes the same set of samples with the generic decoders (mask checked at
+// runtime) and with the ones specialized for DEFAULT_SAMPLE_TYPE.
+
+#define NB_RECORDS 256
+#define STACK_SIZE 4096
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static struct perf_event_header *make_records(void) {
+  static char stack[STACK_SIZE];
+  static uint64_t regs[PERF_REGS_COUNT];
+  size_t rec_sz = STACK_SIZE + 1024;
+  char *records = calloc(NB_RECORDS, rec_sz);
+  if (!records)
+    return NULL;
+  for (int i = 0; i < NB_RECORDS; ++i) {
+    perf_event_sample sample = {0};
+    sample.header.type = PERF_RECORD_SAMPLE;
+    sample.sample_id = i;
+    sample.pid = 1000 + i;
+    sample.tid = 1000 + i;
+    sample.time = 1000000 * i;
+    sample.period = 1;
+    sample.abi = PERF_REGS_MASK_X86;
+    sample.regs = regs;
+    sample.size_stack = STACK_SIZE;
+    sample.data_stack = stack;
+    sample.dyn_size_stack = STACK_SIZE / 2;
+    samp2hdr((struct perf_event_header *)(records + i * rec_sz), &sample,
+             rec_sz, DEFAULT_SAMPLE_TYPE);
+  }
+  return (struct perf_event_header *)records;
+}
+
+static struct perf_event_header *record_at(struct perf_event_header *records,
+                                           int i) {
+  return (struct perf_event_header *)((char *)records +
+                                      i * (STACK_SIZE + 1024));
+}
+
+typedef perf_event_sample *(*decode_fun)(const RecordView *, uint64_t);
+typedef uint64_t (*time_fun)(struct perf_event_header *, uint64_t);
+
+static void run(const char *name, struct perf_event_header *records,
+                long iterations, decode_fun decode, time_fun get_time) {
+  uint64_t checksum = 0;
+  double start = now_s();
+  for (long it = 0; it < iterations; ++it) {
+    for (int i = 0; i < NB_RECORDS; ++i) {
+      RecordView view;
+      record_view_init(&view, record_at(records, i));
+      checksum += get_time(view.hdr, DEFAULT_SAMPLE_TYPE);
+      perf_event_sample *sample = decode(&view, DEFAULT_SAMPLE_TYPE);
+      checksum += sample->pid + sample->size_stack + sample->period;
+    }
+  }
+  double elapsed = now_s() - start;
+  double events = (double)iterations * NB_RECORDS;
+  printf("%-12s %12.0f events/s (checksum %lu)\n", name, events / elapsed,
+         checksum);
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : 100000;
+  if (iterations <= 0)
+    iterations = 100000;
+  struct perf_event_header *records = make_records();
+  if (!records)
+    return 1;
+
+  run("generic", records, iterations, view2samp_generic, hdr_time_generic);
+  run("specialized", records, iterations, view2samp, hdr_time);
+  free(records);
+  return 0;
+}
@@ -0,0 +1,26 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ddprof {
+
+// Build-ids are kept in their hexadecimal representation (as in pprof)
+typedef std::string BuildId;
+
+BuildId format_build_id(const unsigned char *bits, size_t len);
+
+// Build-id found in the notes of an ELF file (content of a PT_NOTE segment),
+// empty if there is none
+BuildId build_id_from_notes(const char *notes, size_t sz, size_t align = 4);
+
+// Read the GNU build-id note of an ELF file through its program headers.
+// Empty if the file can not be read or has no build-id.
+BuildId read_build_id(const char *path);
+
+} // namespace ddprof
@@ -0,0 +1,111 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include "ddprof_defs.h"
+}
+
+#include "ddprof_file_info-i.hpp"
+#include "unwind_registers.hpp"
+
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef struct Elf Elf;
+
+namespace ddprof {
+
+namespace cfi {
+enum CfaRule : uint8_t {
+  kCfaUndef,  // no unwinding information for this range
+  kCfaRsp,    // CFA = rsp + cfa_offset
+  kCfaRbp,    // CFA = rbp + cfa_offset
+  kCfaUnknown // rule we do not handle (DWARF expressions, other registers)
+};
+enum RegRule : uint8_t {
+  kRegSame,   // register keeps its value in the caller
+  kRegOffset, // saved at CFA + offset
+  kRegUndef,  // no value : for the return address, this is the outermost frame
+};
+} // namespace cfi
+
+// Unwinding rules from an address up to the start of the next row
+struct CfiRow {
+  uint32_t start; // offset from CfiTable::_base
+  int32_t cfa_offset;
+  int16_t rbp_offset;
+  int16_t ra_offset;
+  cfi::CfaRule cfa_rule;
+  cfi::RegRule rbp_rule;
+  cfi::RegRule ra_rule;
+}; // 16 bytes
+
+/// Unwinding rules of a file, parsed once from its .eh_frame section and
+/// sorted by address
+class CfiTable {
+public:
+  CfiTable() : _base(0) {}
+
+  // Read the .eh_frame section and executable segments of an ELF file
+  bool load(const std::string &path);
+  bool load(Elf *elf);
+  // section_addr : ELF address of the section
+  bool parse_eh_frame(const uint8_t *data, size_t size,
+                      ElfAddress_t section_addr);
+  // Add an executable segment, to convert file offsets to ELF addresses
+  void add_segment(Offset_t offset, ElfAddress_t addr, uint64_t size);
+
+  bool offset_to_addr(Offset_t offset, ElfAddress_t *addr) const;
+  // Returns nullptr if the address is not covered
+  const CfiRow *find(ElfAddress_t addr) const;
+
+  size_t size() const { return _rows.size(); }
+
+private:
+  struct Segment {
+    Offset_t offset;
+    ElfAddress_t addr;
+    uint64_t size;
+  };
+
+  ElfAddress_t _base;
+  std::vector<CfiRow> _rows;
+  std::vector<Segment> _segments;
+};
+
+typedef bool (*CfiReadFun)(ProcessAddress_t addr, ElfWord_t *result,
+                           void *arg);
+
+namespace cfi {
+enum StepResult { kStepError, kStepOk, kStepEnd };
+}
+
+// Compute the registers of the caller from the rules of the current frame
+cfi::StepResult cfi_step(const CfiRow &row, const UnwindRegisters &regs,
+                         UnwindRegisters *caller, CfiReadFun read, void *arg);
+
+/// Tables shared by all processes, keyed by file
+class CfiTableHdr {
+public:
+  // Returns nullptr if the file has no usable unwinding information (elf can
+  // be null when the file could not be opened)
+  const CfiTable *get_or_insert(FileInfoId_t file_info_id, Elf *elf);
+
+  // Returns false if the file was never parsed (table is then untouched)
+  bool find(FileInfoId_t file_info_id, const CfiTable **table) const;
+
+  size_t size() const { return _tables.size(); }
+
+private:
+  // null for files we failed to parse (avoid retrying)
+  std::unordered_map<FileInfoId_t, std::unique_ptr<CfiTable>> _tables;
+};
+
+} // namespace ddprof
@@ -25,7 +25,18 @@ typedef struct DDProfContext {
     int num_cpu;
     pid_t pid; // ! only use for perf attach (can be -1 in global mode)
     bool global;
-    uint32_t worker_period; // exports between worker refreshes
+    uint32_t worker_period;        // exports between worker refreshes
+    int worker_threads;            // threads draining the ring buffers
+    uint32_t sample_queue_mb;      // reader to unwinder queue (0 : off)
+    int buf_size_shift;            // ring buffers hold (1 << shift) pages
+    bool adaptive_buffer;          // resize ring buffers on worker refresh
+    uint32_t wakeup_watermark_pct; // buffer fill before wakeups (0 : off)
+    bool unwind_fp;                // follow frame pointers before DWARF
+    const char *unwind_fp_exclude; // DSOs built without frame pointers
+    bool unwind_tables;            // tables built from .eh_frame
+    const char *symbol_cache_dir;  // symbols persisted across workers
+    bool eager_symbols;            // load symbol tables of files at once
+    bool line_info;                // resolve source lines of symbols
     const char *internal_stats;
     const char *tags;
   } params;
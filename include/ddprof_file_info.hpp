@@ -12,6 +12,7 @@ extern "C" {
 #include <unordered_map>
 #include <vector>
 
+#include "build_id.hpp"
 #include "ddprof_file_info-i.hpp"
 #include "hash_helper.hpp"
 
@@ -32,9 +33,30 @@ struct FileInfoInodeKey {
   std::size_t _sz;
 };
 
+/// Same binary seen through different inodes (example: containers running
+/// the same image). The size tells stripped and unstripped copies apart.
+struct FileInfoBuildIdKey {
+  FileInfoBuildIdKey(const BuildId &build_id, ElfAddress_t offset,
+                     std::size_t sz)
+      : _build_id(build_id), _offset(offset), _sz(sz) {}
+  bool operator==(const FileInfoBuildIdKey &o) const;
+  BuildId _build_id;
+  Offset_t _offset;
+  std::size_t _sz;
+};
+
 } // namespace ddprof
 
 namespace std {
+template <> struct hash<ddprof::FileInfoBuildIdKey> {
+  std::size_t operator()(const ddprof::FileInfoBuildIdKey &k) const {
+    std::size_t hash_val = ddprof::hash_combine(
+        hash<std::string>()(k._build_id), hash<Offset_t>()(k._offset));
+    hash_val = ddprof::hash_combine(hash_val, hash<size_t>()(k._sz));
+    return hash_val;
+  }
+};
+
 template <> struct hash<ddprof::FileInfoInodeKey> {
   std::size_t operator()(const ddprof::FileInfoInodeKey &k) const {
     std::size_t hash_val = ddprof::hash_combine(hash<inode_t>()(k._inode),
@@ -65,8 +87,10 @@ public:
   FileInfoId_t get_id() const { return _id; }
   int64_t get_size() const { return _info._size; }
   const std::string &get_path() const { return _info._path; }
+  const BuildId &get_build_id() const { return _build_id; }
 
   FileInfo _info;
+  BuildId _build_id; // empty if the file has none
 
   mutable bool _errored; // a flag to avoid trying to read in a loop bad files
 private:
@@ -74,6 +98,8 @@ private:
 };
 
 typedef std::unordered_map<FileInfoInodeKey, FileInfoId_t> FileInfoInodeMap;
+typedef std::unordered_map<FileInfoBuildIdKey, FileInfoId_t>
+    FileInfoBuildIdMap;
 typedef std::vector<FileInfoValue> FileInfoVector;
 
 } // namespace ddprof
@@ -33,6 +33,17 @@ typedef struct DDProfInput {
   char *internal_stats;
   char *tags;
   char *url;
+  char *worker_threads;
+  char *sample_queue_mb;
+  char *buffer_pages;
+  char *adaptive_buffer;
+  char *wakeup_watermark;
+  char *unwind_fp;
+  char *unwind_fp_exclude;
+  char *unwind_tables;
+  char *symbol_cache_dir;
+  char *eager_symbols;
+  char *line_info;
   // Watcher presets
   watcher_index_t watchers[MAX_TYPE_WATCHER];
   uint64_t sampling_value[MAX_TYPE_WATCHER];
@@ -93,7 +104,18 @@ typedef struct DDProfInput {
   XX(DD_PROFILING_NATIVE_LOG_LEVEL,     log_level,          l, 'l', 1, input, NULL, "error", )                 \
   XX(DD_PROFILING_NATIVE_TARGET_PID,    pid,                p, 'p', 1, input, NULL, "", )                      \
   XX(DD_PROFILING_NATIVE_GLOBAL,        global,             g, 'g', 1, input, NULL, "", )                      \
-  XX(DD_PROFILING_INTERNAL_STATS,       internal_stats,     b, 'b', 1, input, NULL, "", )
+  XX(DD_PROFILING_INTERNAL_STATS,       internal_stats,     b, 'b', 1, input, NULL, "", )                      \
+  XX(DD_PROFILING_NATIVE_WORKER_THREADS, worker_threads,    t, 't', 1, input, NULL, "1", )                     \
+  XX(DD_PROFILING_NATIVE_SAMPLE_QUEUE_MB, sample_queue_mb,  q, 'q', 1, input, NULL, "", )                     \
+  XX(DD_PROFILING_NATIVE_BUFFER_PAGES,  buffer_pages,       B, 'B', 1, input, NULL, "64", )                    \
+  XX(DD_PROFILING_NATIVE_ADAPTIVE_BUFFER, adaptive_buffer,  a, 'a', 1, input, NULL, "no", )                    \
+  XX(DD_PROFILING_NATIVE_WAKEUP_WATERMARK, wakeup_watermark, W, 'W', 1, input, NULL, "", )                     \
+  XX(DD_PROFILING_NATIVE_UNWIND_FP,     unwind_fp,          F, 'F', 1, input, NULL, "no", )                    \
+  XX(DD_PROFILING_NATIVE_UNWIND_FP_EXCLUDE, unwind_fp_exclude, x, 'x', 1, input, NULL, "", )                   \
+  XX(DD_PROFILING_NATIVE_UNWIND_TABLES, unwind_tables,      C, 'C', 1, input, NULL, "no", )                    \
+  XX(DD_PROFILING_NATIVE_SYMBOL_CACHE_DIR, symbol_cache_dir, D, 'D', 1, input, NULL, "", )                     \
+  XX(DD_PROFILING_NATIVE_EAGER_SYMBOLS, eager_symbols,      y, 'y', 1, input, NULL, "no", )                    \
+  XX(DD_PROFILING_NATIVE_LINE_INFO,     line_info,          z, 'z', 1, input, NULL, "yes", )
 // clang-format on
 
 #define X_ENUM(a, b, c, d, e, f, g, h, i) a,
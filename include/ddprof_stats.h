@@ -20,13 +20,31 @@
   X(UNWIND_TICKS, "unwind.ticks", STAT_GAUGE)                                  \
   X(UNWIND_FRAMES, "unwind.frames", STAT_GAUGE)                                \
   X(UNWIND_ERRORS, "unwind.errors", STAT_GAUGE)                                \
+  X(UNWIND_FP_FRAMES, "unwind.fp_frames", STAT_GAUGE)                          \
+  X(UNWIND_FP_FALLBACKS, "unwind.fp_fallbacks", STAT_GAUGE)                    \
+  X(UNWIND_FP_TICKS, "unwind.fp_ticks", STAT_GAUGE)                            \
+  X(UNWIND_DWFL_TICKS, "unwind.dwfl_ticks", STAT_GAUGE)                        \
+  X(UNWIND_CFI_FRAMES, "unwind.cfi_frames", STAT_GAUGE)                        \
+  X(UNWIND_CFI_TICKS, "unwind.cfi_ticks", STAT_GAUGE)                          \
+  X(FRAME_CACHE_HITS, "unwind.frame_cache_hits", STAT_GAUGE)                   \
+  X(FRAME_CACHE_MISSES, "unwind.frame_cache_misses", STAT_GAUGE)               \
   X(PROCFS_RSS, "procfs.rss", STAT_GAUGE)                                      \
   X(PROCFS_UTIME, "procfs.utime", STAT_GAUGE)                                  \
   X(PPROF_ST_ELEMS, "pprof.st_elements", STAT_GAUGE)                           \
   X(DSO_UNHANDLED_SECTIONS, "dso.unhandled_sections", STAT_GAUGE)              \
   X(DSO_NEW_DSO, "dso.new", STAT_GAUGE)                                        \
   X(DSO_SIZE, "dso.size", STAT_GAUGE)                                          \
-  X(DSO_MAPPED, "dso.mapped", STAT_GAUGE)
+  X(DSO_MAPPED, "dso.mapped", STAT_GAUGE)                                      \
+  X(PID_LIVE, "pid.live", STAT_GAUGE)                                          \
+  X(PID_DEAD, "pid.dead", STAT_GAUGE)                                          \
+  X(SAMPLE_QUEUE_DEPTH, "sample_queue.depth", STAT_GAUGE)                      \
+  X(SAMPLE_QUEUE_DROPS, "sample_queue.drops", STAT_GAUGE)                      \
+  X(WORKER_WAITS, "worker.waits", STAT_GAUGE)                                  \
+  X(WORKER_WAIT_TIMEOUTS, "worker.wait_timeouts", STAT_GAUGE)                  \
+  X(RB_FILL_Q1, "ring_buffer.fill_q1", STAT_GAUGE)                             \
+  X(RB_FILL_Q2, "ring_buffer.fill_q2", STAT_GAUGE)                             \
+  X(RB_FILL_Q3, "ring_buffer.fill_q3", STAT_GAUGE)                             \
+  X(RB_FILL_Q4, "ring_buffer.fill_q4", STAT_GAUGE)
 
 // Expand the enum/index for the individual stats
 typedef enum DDPROF_STATS { STATS_TABLE(X_ENUM) STATS_LEN } DDPROF_STATS;
@@ -9,6 +9,7 @@
 #include <stdbool.h>
 
 #include "ddres.h"
+#include "perf_ringbuffer.h"
 #include "pevent.h"
 
 typedef struct DDProfContext DDProfContext;
@@ -21,6 +22,12 @@ DDRes ddprof_worker_cycle(DDProfContext *ctx, int64_t now,
                           bool synchronous_export);
 DDRes ddprof_worker_process_event(struct perf_event_header *hdr, int pos,
                                   DDProfContext *arg);
+// Same as above, for a record read in place from the ring buffer
+DDRes ddprof_worker_process_view(const RecordView *view, int pos,
+                                 DDProfContext *arg);
+
+// Ring buffer size (shift) to use for the next worker in adaptive mode
+int ddprof_worker_next_buf_size_shift(const DDProfContext *ctx);
 
 // Only init unwinding elements
 DDRes worker_library_init(DDProfContext *ctx);
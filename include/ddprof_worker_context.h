@@ -9,6 +9,8 @@ typedef struct StackHandler StackHandler;
 typedef struct StackHandler StackHandler;
 typedef struct UnwindState UnwindState;
 typedef struct UserTags UserTags;
+typedef struct WorkerShardPool WorkerShardPool;
+typedef struct UnwindPipeline UnwindPipeline;
 
 // Mutable states within a worker
 typedef struct DDProfWorkerContext {
@@ -19,9 +21,14 @@ typedef struct DDProfWorkerContext {
   volatile bool exp_error;
   pthread_t exp_tid;
   UnwindState *us;
+  WorkerShardPool *shard_pool; // only set when draining from several threads
+  UnwindPipeline *pipeline;    // only set when unwinding from a queue
   UserTags *user_tags;
   ProcStatus proc_status;
-  int64_t send_nanos;     // Last time an export was sent
-  uint32_t count_worker;  // exports since last cache clear
-  uint32_t count_samples; // sample count to avoid bouncing on backpopulates
+  int64_t send_nanos;        // Last time an export was sent
+  uint32_t count_worker;     // exports since last cache clear
+  uint32_t count_samples;    // sample count to avoid bouncing on backpopulates
+  int buf_size_shift;        // ring buffers hold (1 << shift) pages
+  uint32_t buf_lossy_cycles; // cycles that lost events (adaptive buffers)
+  uint32_t buf_busy_cycles;  // cycles with a well filled ring buffer
 } DDProfWorkerContext;
@@ -14,19 +14,27 @@ extern "C" {
 #include <utility>
 
 #include "region_holder.hpp"
+#include "string_interner.hpp"
 
 // Out of namespace to allow holding it in C object
 
 namespace ddprof {
 
+namespace dso {
+// Whether the frame pointer chain can be followed through the code of a DSO
+enum FpStatus { kFpUnknown, kFpAvailable, kFpMissing };
+
+// Classify a mapping from its null terminated path (as seen by the user)
+DsoType dso_type_from_path(const char *path, size_t len);
+} // namespace dso
+
 // DSO definition
 class Dso {
 public:
   Dso();
-  // pid, start, end, offset, filename (copied once to avoid creating 3
-  // different APIs)
+  // pid, start, end, offset, filename (interned by the owner of the DSO)
   Dso(pid_t pid, ElfAddress_t start, ElfAddress_t end, ElfAddress_t pgoff = 0,
-      std::string &&filename = "", bool executable = true);
+      InternedString filename = InternedString(), bool executable = true);
   // copy parent and update pid
   Dso(const Dso &parent, pid_t new_pid) : Dso(parent) { _pid = new_pid; }
 
@@ -47,10 +55,11 @@ public:
   ElfAddress_t _start;
   ElfAddress_t _end;
   ElfAddress_t _pgoff;
-  std::string _filename; // path as perceived by the user
+  InternedString _filename; // path as perceived by the user
   dso::DsoType _type;
   bool _executable;
   mutable FileInfoId_t _id;
+  mutable dso::FpStatus _fp_status; // evaluated by the frame pointer unwinder
 };
 
 std::ostream &operator<<(std::ostream &os, const Dso &dso);
@@ -7,12 +7,13 @@
 
 #include <array>
 #include <cassert>
-#include <map>
 #include <string>
 #include <unordered_map>
 
 #include "ddprof_file_info.hpp"
 #include "dso.hpp"
+#include "dso_map.hpp"
+#include "procfs_maps.hpp"
 
 namespace ddprof {
 
@@ -69,7 +70,7 @@ private:
 class DsoHdr {
 public:
   /******* Structures and types **********/
-  typedef std::map<ProcessAddress_t, Dso> DsoMap;
+  typedef ddprof::DsoMap DsoMap;
   typedef std::unordered_map<pid_t, DsoMap> DsoPidMap;
 
   typedef DsoMap::const_iterator DsoMapConstIt;
@@ -91,9 +92,21 @@ public:
 
   DsoFindRes pid_read_dso(int pid, void *buf, size_t sz, uint64_t addr);
 
+  // Same as pid_read_dso, remembering the last ranges read from : unwinding
+  // reads repeatedly from the same few binaries
+  bool pid_read(pid_t pid, void *buf, size_t sz, ProcessAddress_t addr);
+
   // Clear all dsos and regions associated with this pid
   void pid_free(int pid);
 
+  // Copy the dsos of the parent : a forked pid starts with the same mappings.
+  // Returns the number of dsos inherited.
+  int pid_fork(pid_t ppid, pid_t pid);
+
+  // Changes whenever DSOs of the pid are erased or replaced : resolutions
+  // cached for an address of the pid are valid within a generation
+  uint64_t get_generation(pid_t pid);
+
   // Find the first associated to this pid
   DsoFindRes dso_find_first_std_executable(pid_t pid);
 
@@ -120,7 +133,16 @@ public:
   static DsoRange get_intersection(DsoMap &map, const Dso &dso);
 
   // Helper to create a dso from a line in /proc/pid/maps
-  static Dso dso_from_procline(int pid, char *line);
+  Dso dso_from_procline(int pid, char *line);
+  Dso dso_from_maps_entry(pid_t pid, const ProcMapsEntry &entry);
+  // Whether a mapping read from procfs is worth keeping track of
+  static bool is_relevant_mapping(const ProcMapsEntry &entry);
+
+  // Filenames of the DSOs are stored once, for the lifetime of the header
+  InternedString intern_filename(const char *filename) {
+    return _filenames.intern(filename);
+  }
+  const StringInterner &filenames() const { return _filenames; }
 
   static DsoFindRes find_res_not_found(const DsoMap &map) {
     return std::make_pair<DsoMapConstIt, bool>(map.end(), false);
@@ -174,15 +196,46 @@ private:
 
   FileInfoId_t update_id_and_path(const Dso &dso);
 
+  void invalidate_generation(pid_t pid);
+
+  // Mapped bytes of a dso, readable within [_start, _end)
+  struct ReadRange {
+    pid_t _pid;
+    uint64_t _generation; // 0 for unused entries
+    ProcessAddress_t _start;
+    ProcessAddress_t _end;
+    const char *_src; // bytes at _start
+  };
+
+  DsoFindRes find_read_range(int pid, uint64_t addr, size_t sz,
+                             ReadRange &range);
+
   BackpopulateStateMap _backpopulate_state_map;
 
   RegionMap _region_map;
 
   FileInfoInodeMap _file_info_inode_map;
+  // files sharing a build-id share their id (and caches)
+  FileInfoBuildIdMap _file_info_build_id_map;
 
   FileInfoVector _file_info_vector;
   // /proc files can be mounted at various places (whole host profiling)
   std::string _path_to_proc;
+
+  StringInterner _filenames;
+  // buffer reused when parsing procfs
+  ProcMapsReader _maps_reader;
+
+  // Generations are unique across pids : a freed pid gets a new one
+  uint64_t _generation;
+  std::unordered_map<pid_t, uint64_t> _generation_map;
+  // last looked up pid (frames of a sample share the same pid)
+  pid_t _generation_pid;
+  uint64_t *_generation_ptr;
+
+  static constexpr unsigned k_nb_read_ranges = 4;
+  std::array<ReadRange, k_nb_read_ranges> _read_ranges;
+  unsigned _read_range_next; // next entry to replace
 };
 
 } // namespace ddprof
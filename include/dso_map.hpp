@@ -0,0 +1,186 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+#include "dso.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace ddprof {
+
+/// DSOs of a pid, sorted by start address
+///
+/// Lookups binary search a flat array of start addresses, next to an array
+/// of (end, DSO) entries : finding the DSO of an address does not read the
+/// DSOs it skips. DSOs inserted out of address order (mmap events) go to a
+/// small sorted staging level, merged into the main level in one pass once
+/// it grows over the square root of the main level : inserting does not
+/// move all the entries that follow. Lookups and iterations see both levels.
+/// DSOs are stored in separate slots : references to a DSO stay valid until
+/// it is erased (as with a std::map), iterators are invalidated by
+/// insertions and erasures. The range of an inserted DSO is only modified
+/// through adjust_same.
+class DsoMap {
+  struct Entry {
+    ProcessAddress_t _end;
+    Dso *_dso;
+  };
+
+  // sorted start addresses, same order as the entries
+  struct Level {
+    std::vector<ProcessAddress_t> _starts;
+    std::vector<Entry> _entries;
+
+    size_t size() const { return _starts.size(); }
+    size_t lower_bound(ProcessAddress_t addr) const;
+    size_t upper_bound(ProcessAddress_t addr) const;
+    void insert(size_t pos, const Entry &entry);
+    void erase(size_t first, size_t last);
+    void clear();
+  };
+
+public:
+  // Walks the two levels in address order : positions in both levels
+  template <typename DsoT> class Iterator {
+  public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef DsoT value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef DsoT *pointer;
+    typedef DsoT &reference;
+
+    Iterator() = default;
+    // iterator to const_iterator
+    template <typename OtherDso,
+              typename = typename std::enable_if<
+                  std::is_convertible<OtherDso *, DsoT *>::value>::type>
+    Iterator(const Iterator<OtherDso> &other)
+        : _map(other._map), _main(other._main), _staged(other._staged) {}
+
+    reference operator*() const { return *entry()._dso; }
+    pointer operator->() const { return entry()._dso; }
+
+    Iterator &operator++() {
+      if (in_main()) {
+        ++_main;
+      } else {
+        ++_staged;
+      }
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator res = *this;
+      ++*this;
+      return res;
+    }
+    Iterator &operator--() {
+      // the previous entry is the last one of the two levels
+      if (_staged == 0 ||
+          (_main != 0 &&
+           _map->_main._starts[_main - 1] >
+               _map->_staged._starts[_staged - 1])) {
+        --_main;
+      } else {
+        --_staged;
+      }
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator res = *this;
+      --*this;
+      return res;
+    }
+
+    friend bool operator==(const Iterator &lhs, const Iterator &rhs) {
+      return lhs._main == rhs._main && lhs._staged == rhs._staged;
+    }
+    friend bool operator!=(const Iterator &lhs, const Iterator &rhs) {
+      return !(lhs == rhs);
+    }
+
+  private:
+    template <typename> friend class Iterator;
+    friend class DsoMap;
+    Iterator(const DsoMap *map, size_t main, size_t staged)
+        : _map(map), _main(main), _staged(staged) {}
+
+    bool in_main() const {
+      return _staged == _map->_staged.size() ||
+          (_main != _map->_main.size() &&
+           _map->_main._starts[_main] < _map->_staged._starts[_staged]);
+    }
+    const Entry &entry() const {
+      return in_main() ? _map->_main._entries[_main]
+                       : _map->_staged._entries[_staged];
+    }
+
+    const DsoMap *_map = nullptr;
+    size_t _main = 0;
+    size_t _staged = 0;
+  };
+
+  typedef Iterator<Dso> iterator;
+  typedef Iterator<const Dso> const_iterator;
+
+  DsoMap() = default;
+  // entries point into the slots of this map
+  DsoMap(const DsoMap &) = delete;
+  DsoMap &operator=(const DsoMap &) = delete;
+  DsoMap(DsoMap &&) = default;
+  DsoMap &operator=(DsoMap &&) = default;
+
+  iterator begin() { return iterator(this, 0, 0); }
+  iterator end() { return iterator(this, _main.size(), _staged.size()); }
+  const_iterator begin() const { return const_iterator(this, 0, 0); }
+  const_iterator end() const {
+    return const_iterator(this, _main.size(), _staged.size());
+  }
+
+  bool empty() const { return size() == 0; }
+  size_t size() const { return _main.size() + _staged.size(); }
+  void clear();
+
+  // First DSO starting at or after addr
+  iterator lower_bound(ProcessAddress_t addr);
+  const_iterator lower_bound(ProcessAddress_t addr) const;
+  // First DSO starting after addr
+  const_iterator upper_bound(ProcessAddress_t addr) const;
+  // DSO starting at addr
+  iterator find(ProcessAddress_t addr);
+  // Last DSO starting at or before addr (end() if there is none), is_within
+  // tells if it contains addr
+  const_iterator find_closest(ProcessAddress_t addr, bool *is_within) const;
+
+  // Does nothing if a DSO starts at the same address (returns it and false).
+  // Appending in address order (procfs) does not move other entries.
+  std::pair<iterator, bool> insert(Dso &&dso);
+
+  // Extends the DSO at it to the end of dso if they match (Dso::adjust_same)
+  bool adjust_same(iterator it, const Dso &dso);
+
+  iterator erase(const_iterator it);
+  iterator erase(const_iterator first, const_iterator last);
+
+private:
+  Entry &entry(const_iterator it) {
+    return it.in_main() ? _main._entries[it._main]
+                        : _staged._entries[it._staged];
+  }
+  // Moves the staged entries into the main level
+  void merge_staged();
+
+  Level _main;
+  Level _staged;
+  // storage of the DSOs, erased slots are reused
+  std::deque<Dso> _slots;
+  std::vector<Dso *> _free_slots;
+};
+
+} // namespace ddprof
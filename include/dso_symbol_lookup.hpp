@@ -32,7 +32,9 @@ private:
   // toghether
   // TODO : find efficient clear on symbol table before we do this
   typedef std::unordered_map<FileAddress_t, SymbolIdx_t> AddressMap;
-  typedef std::unordered_map<std::string, AddressMap> DsoPathMap;
+  // filenames are interned by the DSO header
+  typedef std::unordered_map<InternedString, AddressMap, InternedStringHash>
+      DsoPathMap;
   DsoPathMap _map_dso_path;
   // For non-standard DSO types, address is not relevant
   std::unordered_map<dso::DsoType, SymbolIdx_t, EnumClassHash>
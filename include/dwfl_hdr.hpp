@@ -15,6 +15,7 @@ extern "C" {
 
 #include "ddprof_file_info.hpp"
 #include "dso.hpp"
+#include "elf_cache.hpp"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -27,7 +28,8 @@ struct DwflWrapper {
   explicit DwflWrapper();
 
   DwflWrapper(DwflWrapper &&other)
-      : _dwfl(nullptr), _attached(false), _inconsistent(false) {
+      : _dwfl(nullptr), _attached(false), _inconsistent(false),
+        _elf_cache(nullptr) {
     swap(*this, other);
   }
 
@@ -50,11 +52,14 @@ struct DwflWrapper {
   static void swap(DwflWrapper &first, DwflWrapper &second) noexcept {
     std::swap(first._dwfl, second._dwfl);
     std::swap(first._attached, second._attached);
+    std::swap(first._elf_cache, second._elf_cache);
   }
 
   Dwfl *_dwfl;
   bool _attached;
   bool _inconsistent;
+  // Elf handles shared with the other pids (owned by DwflHdr)
+  ElfCache *_elf_cache;
 
   // Keep track of the files we added to the dwfl object
   std::unordered_map<FileInfoId_t, bool> _mod_added;
@@ -70,7 +75,11 @@ public:
   int get_nb_mod() const;
   void display_stats() const;
 
+  ElfCache &get_elf_cache() { return _elf_cache; }
+
 private:
+  // Declared first : outlives the modules referencing its entries
+  ElfCache _elf_cache;
   std::unordered_map<pid_t, DwflWrapper> _dwfl_map;
   std::unordered_set<pid_t> _visited_pid;
 };
@@ -6,6 +6,7 @@ extern "C" {
 
 #include "ddprof_file_info.hpp"
 #include "dso.hpp"
+#include "elf_cache.hpp"
 
 namespace ddprof {
 
@@ -26,8 +27,15 @@ struct DDProfMod {
 };
 
 // From a dso object (and the matching file), attach the module to the dwfl
-// object, return the associated Dwfl_Module
+// object, return the associated Dwfl_Module.
+// With an elf_cache, the module shares the Elf handle opened for other pids.
 DDProfMod update_module(Dwfl *dwfl, ProcessAddress_t pc, const Dso &dso,
-                        const FileInfoValue &fileInfoValue);
+                        const FileInfoValue &fileInfoValue,
+                        ElfCache *elf_cache = nullptr);
+
+// find_elf callback of dwfl : provides the shared Elf handle of modules
+// reported through an ElfCache
+int find_cached_elf(Dwfl_Module *mod, void **userdata, const char *modname,
+                    Dwarf_Addr base, char **file_name, Elf **elfp);
 
 } // namespace ddprof
@@ -6,7 +6,7 @@
 #pragma once
 
 #include "ddprof_defs.h"
-#include "symbol.hpp"
+#include "symbol_table.hpp"
 
 extern "C" {
 #include "gelf.h"
@@ -21,8 +21,12 @@ static const Offset_t k_min_symbol_size = 8;
 static const Offset_t k_max_symbol_size = 80;
 
 // get symbol from dwarf for this mod
+// strings of the symbol are interned in the table
+// line_info : also read the source file and line (dwarf line tables)
 bool symbol_get_from_dwfl(Dwfl_Module *mod, ProcessAddress_t process_pc,
-                          Symbol &symbol, GElf_Sym &elf_sym, Offset_t &lbias);
+                          SymbolTable &table, Symbol &symbol,
+                          GElf_Sym &elf_sym, Offset_t &lbias,
+                          bool line_info = true);
 
 // Compute the start and end addresses in the scope of a region for this symbol
 bool compute_elf_range(RegionAddress_t region_pc, ProcessAddress_t mod_lowaddr,
@@ -9,11 +9,14 @@
 #include "ddprof_file_info.hpp"
 #include "dso.hpp"
 #include "dso_symbol_lookup.hpp"
+#include "elf_symbol_table.hpp"
 #include "hash_helper.hpp"
+#include "symbol_disk_cache.hpp"
 #include "symbol_table.hpp"
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <unordered_map>
 
 extern "C" {
@@ -30,13 +33,16 @@ struct DwflWrapper;
 
 struct DwflSymbolLookupStats {
   DwflSymbolLookupStats()
-      : _hit(0), _calls(0), _errors(0), _no_dwfl_symbols(0) {}
+      : _hit(0), _calls(0), _errors(0), _no_dwfl_symbols(0),
+        _disk_loaded(0), _elf_table_hits(0) {}
   void reset();
   void display(unsigned nb_elts) const;
   int _hit;
   int _calls;
   int _errors;
   int _no_dwfl_symbols;
+  int _disk_loaded;    // symbols loaded from the disk cache
+  int _elf_table_hits; // lookups resolved by eager symbol tables
 };
 
 using DwflSymbolKey_V2 = RegionAddress_t;
@@ -84,7 +90,21 @@ public:
                             ProcessAddress_t process_pc, const Dso &dso,
                             const FileInfoValue &file_info);
 
-  void erase(FileInfoId_t file_info_id) { _file_info_map.erase(file_info_id); }
+  void erase(FileInfoId_t file_info_id) {
+    _file_info_map.erase(file_info_id);
+    _elf_symbols_map.erase(file_info_id);
+    _disk_cache.close(file_info_id);
+  }
+
+  // Load the symbol tables of files the first time they are looked up
+  // instead of resolving addresses one by one through libdwfl
+  void set_eager_symbols(bool eager) { _eager_symbols = eager; }
+
+  // Resolve source files and lines of symbols (dwarf line tables)
+  void set_line_info(bool line_info) { _line_info = line_info; }
+
+  // Persist symbols in this directory (empty : no persistence)
+  void set_disk_cache_dir(const char *dir) { _disk_cache.set_directory(dir); }
 
   DwflSymbolLookupStats _stats;
 
@@ -98,6 +118,8 @@ private:
   } SymbolLookupSetting;
 
   SymbolLookupSetting _lookup_setting;
+  bool _eager_symbols;
+  bool _line_info;
 
   SymbolIdx_t insert(DwflWrapper &dwfl_wrapper, SymbolTable &table,
                      DsoSymbolLookup &dso_symbol_lookup,
@@ -105,6 +127,15 @@ private:
                      const FileInfoValue &file_info, DwflSymbolMap &map,
                      DwflSymbolMapFindRes find_res);
 
+  // Resolve through the symbol table of the file, false if not covered
+  bool find_eager(DwflWrapper &dwfl_wrapper, SymbolTable &table,
+                  ProcessAddress_t process_pc, const Dso &dso,
+                  const FileInfoValue &file_info, SymbolIdx_t &symbol_idx);
+
+  // Fill the map of a file with the symbols persisted for its build-id
+  void load_disk_cache(SymbolTable &table, const Dso &dso,
+                       const FileInfoValue &file_info, DwflSymbolMap &map);
+
   static bool dwfl_symbol_is_within(const Offset_t &norm_pc,
                                     const DwflSymbolMapValueType &kv);
   static DwflSymbolMapFindRes find_closest(DwflSymbolMap &map,
@@ -123,6 +154,16 @@ private:
 
   // unordered map of DSO elements
   FileInfo2SymbolMap _file_info_map;
+
+  SymbolDiskCache _disk_cache;
+
+  struct ElfSymbols {
+    // null if the file has no symbol table
+    std::unique_ptr<ElfSymbolTable> _table;
+    // symbols of the table inserted in the symbol table (-1 until used)
+    std::vector<SymbolIdx_t> _symbol_idx;
+  };
+  std::unordered_map<FileInfoId_t, ElfSymbols> _elf_symbols_map;
 };
 
 } // namespace ddprof
@@ -0,0 +1,55 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include "ddprof_defs.h"
+}
+
+#include "ddprof_file_info-i.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+typedef struct Elf Elf;
+
+namespace ddprof {
+
+/// ELF file mapped once and shared by the dwfl modules of every process
+/// mapping it. Modules hold their own reference on the Elf handle.
+struct ElfCacheEntry {
+  ElfCacheEntry() : _elf(nullptr), _vaddr(0), _end_vaddr(0) {}
+  ~ElfCacheEntry();
+
+  ElfCacheEntry(const ElfCacheEntry &other) = delete;
+  ElfCacheEntry &operator=(const ElfCacheEntry &other) = delete;
+
+  Elf *_elf;
+  std::string _path;
+  ElfAddress_t _vaddr;     // start of the first loadable segment (aligned)
+  ElfAddress_t _end_vaddr; // end of the last loadable segment
+};
+
+class ElfCache {
+public:
+  // Returns nullptr if the file can not be read as an ELF file
+  const ElfCacheEntry *get_or_insert(FileInfoId_t file_info_id,
+                                     const std::string &path);
+
+  // Release the files that are not in the referenced set. Callers keep the
+  // files reported to dwfl modules (modules point to their entry).
+  void evict_unreferenced(const std::unordered_set<FileInfoId_t> &referenced);
+
+  size_t size() const { return _entries.size(); }
+
+private:
+  // null for files we failed to open (avoid retrying)
+  std::unordered_map<FileInfoId_t, std::unique_ptr<ElfCacheEntry>> _entries;
+};
+
+} // namespace ddprof
@@ -0,0 +1,65 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include "ddprof_defs.h"
+}
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+typedef struct Elf Elf;
+
+namespace ddprof {
+
+// Function symbol of an ELF file
+struct ElfSymbolEntry {
+  ElfAddress_t _start;
+  uint32_t _size;
+  uint32_t _name_offset; // in ElfSymbolTable::_names
+}; // 16 bytes
+
+/// Function symbols of a file, loaded at once from its .symtab (or .dynsym
+/// for stripped files) into a sorted array
+class ElfSymbolTable {
+public:
+  bool load(const std::string &path);
+  bool load(Elf *elf);
+  // Add a symbol before calling sort
+  void add_symbol(ElfAddress_t start, uint64_t size, const char *name);
+  // Sort symbols and give symbols without size the space up to the next one
+  void sort();
+  // Add an executable segment, to convert file offsets to ELF addresses
+  void add_segment(Offset_t offset, ElfAddress_t addr, uint64_t size);
+
+  bool offset_to_addr(Offset_t offset, ElfAddress_t *addr) const;
+  // Index of the symbol covering the address, -1 if none
+  int find(ElfAddress_t addr) const;
+
+  const ElfSymbolEntry &operator[](int idx) const { return _entries[idx]; }
+  const char *name(int idx) const {
+    return &_names[_entries[idx]._name_offset];
+  }
+  size_t size() const { return _entries.size(); }
+
+private:
+  struct Segment {
+    Offset_t offset;
+    ElfAddress_t addr;
+    uint64_t size;
+  };
+
+  bool load_symbols(Elf *elf, uint32_t section_type);
+
+  std::vector<ElfSymbolEntry> _entries;
+  // null terminated names
+  std::vector<char> _names;
+  std::vector<Segment> _segments;
+};
+
+} // namespace ddprof
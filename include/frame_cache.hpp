@@ -0,0 +1,57 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include "ddprof_defs.h"
+#include <sys/types.h>
+}
+
+#include <vector>
+
+namespace ddprof {
+
+struct FrameCacheStats {
+  FrameCacheStats() : _hits(0), _misses(0) {}
+  void reset() { *this = FrameCacheStats(); }
+  void display() const;
+
+  uint64_t _hits;
+  uint64_t _misses;
+};
+
+/// Direct-mapped cache of frame resolutions, keyed by (pid, pc).
+/// Entries are tagged with the DSO generation of the pid : they are ignored
+/// once the mappings of the pid changed (see DsoHdr::get_generation).
+class FrameCache {
+public:
+  FrameCache();
+
+  // Returns true and sets the indices if (pid, pc) was resolved within the
+  // same generation
+  bool find(pid_t pid, ProcessAddress_t pc, uint64_t generation,
+            SymbolIdx_t *symbol_idx, MapInfoIdx_t *map_info_idx);
+  void insert(pid_t pid, ProcessAddress_t pc, uint64_t generation,
+              SymbolIdx_t symbol_idx, MapInfoIdx_t map_info_idx);
+  void clear();
+
+  FrameCacheStats _stats;
+
+private:
+  struct Entry {
+    ProcessAddress_t pc;
+    uint64_t generation; // 0 for empty entries
+    pid_t pid;
+    SymbolIdx_t symbol_idx;
+    MapInfoIdx_t map_info_idx;
+  };
+
+  static unsigned index(pid_t pid, ProcessAddress_t pc);
+
+  std::vector<Entry> _entries;
+};
+
+} // namespace ddprof
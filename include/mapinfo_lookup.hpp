@@ -8,6 +8,7 @@
 #include "ddprof_defs.h"
 #include "mapinfo_table.hpp"
 
+#include "build_id.hpp"
 #include "dso.hpp"
 
 #include <string>
@@ -20,7 +21,7 @@ namespace ddprof {
 class MapInfoLookup {
 public:
   MapInfoIdx_t get_or_insert(pid_t pid, MapInfoTable &mapinfo_table,
-                             const Dso &dso);
+                             const Dso &dso, const BuildId &build_id);
   void erase(pid_t pid) {
     // table elements are not removed (TODO to gain memory usage)
     _mapinfo_pidmap.erase(pid);
@@ -6,8 +6,8 @@
 #pragma once
 
 #include "ddprof_defs.h"
+#include "string_interner.hpp"
 
-#include <string>
 #include <vector>
 
 namespace ddprof {
@@ -15,15 +15,33 @@ class MapInfo {
 public:
   MapInfo() : _low_addr(0), _high_addr(0), _offset(0), _sopath() {}
   MapInfo(ElfAddress_t low_addr, ElfAddress_t high_addr, Offset_t offset,
-          std::string &&sopath)
+          InternedString sopath, InternedString build_id = InternedString())
       : _low_addr(low_addr), _high_addr(high_addr), _offset(offset),
-        _sopath(sopath) {}
+        _sopath(sopath), _build_id(build_id) {}
   ElfAddress_t _low_addr;
   ElfAddress_t _high_addr;
   Offset_t _offset;
-  std::string _sopath;
+  InternedString _sopath;
+  InternedString _build_id; // hexadecimal, empty if unknown
 };
 
-typedef std::vector<MapInfo> MapInfoTable;
+/// Mappings of the worker. Their paths are stored once, in the table.
+class MapInfoTable {
+public:
+  MapInfo &operator[](MapInfoIdx_t idx) { return _mapinfos[idx]; }
+  const MapInfo &operator[](MapInfoIdx_t idx) const { return _mapinfos[idx]; }
+  size_t size() const { return _mapinfos.size(); }
+  void push_back(MapInfo &&mapinfo) { _mapinfos.push_back(std::move(mapinfo)); }
+
+  InternedString intern(const char *str) { return _strings.intern(str); }
+  InternedString intern(const std::string &str) {
+    return _strings.intern(str);
+  }
+  const StringInterner &strings() const { return _strings; }
+
+private:
+  std::vector<MapInfo> _mapinfos;
+  StringInterner _strings;
+};
 
 } // namespace ddprof
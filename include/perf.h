@@ -15,13 +15,19 @@
 
 #define PSAMPLE_DEFAULT_WAKEUP_MS 100 // sample frequency check
 #define PERF_SAMPLE_STACK_SIZE (4096 * 8)
+// Ring buffers hold (1 << shift) data pages. The smallest size still fits a
+// few samples with their copy of the stack.
+#define DEFAULT_BUFF_SIZE_SHIFT 6
+#define MIN_BUFF_SIZE_SHIFT 4
+#define MAX_BUFF_SIZE_SHIFT 12
 #define PERF_SAMPLE_STACK_REGS 3
 #define MAX_INSN 16
 
 // TODO, probably make this part of the unwinding context or ddprof ctx
+// The identifier allows several events to share a ring buffer
 #define DEFAULT_SAMPLE_TYPE                                                    \
-  (PERF_SAMPLE_STACK_USER | PERF_SAMPLE_REGS_USER | PERF_SAMPLE_TID |          \
-   PERF_SAMPLE_TIME | PERF_SAMPLE_PERIOD)
+  (PERF_SAMPLE_IDENTIFIER | PERF_SAMPLE_STACK_USER | PERF_SAMPLE_REGS_USER |   \
+   PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_PERIOD)
 
 // TODO, this comes from BP, SP, and IP
 // see arch/x86/include/uapi/asm/perf_regs.h in the linux sources
@@ -117,6 +123,8 @@ typedef struct perf_event_sample {
   uint64_t    *regs;                    // if PERF_SAMPLE_REGS_USER
   uint64_t    size_stack;               // if PERF_SAMPLE_STACK_USER
   char        *data_stack;              // if PERF_SAMPLE_STACK_USER
+  uint64_t    size_stack_head;          // bytes of data_stack before the wrap
+  char        *data_stack_wrap;         // rest of the stack (record wraps)
   uint64_t    dyn_size_stack;           // if PERF_SAMPLE_STACK_USER
   uint64_t    weight;                   // if PERF_SAMPLE_WEIGHT
   uint64_t    data_src;                 // if PERF_SAMPLE_DATA_SRC
@@ -133,10 +141,13 @@ typedef struct perf_samplestacku {
 } perf_samplestacku;
 
 int perf_event_open(struct perf_event_attr *, pid_t, int, int, unsigned long);
-int perfopen(pid_t pid, const PerfOption *opt, int cpu, bool extras);
+// wakeup_watermark : bytes in the buffer before poll is notified (0: every
+// event)
+int perfopen(pid_t pid, const PerfOption *opt, int cpu, bool extras,
+             uint32_t wakeup_watermark);
 size_t perf_mmap_size(int buf_size_shift);
 void *perfown_sz(int fd, size_t size_of_buffer);
-void *perfown(int fd, size_t *size);
+void *perfown(int fd, int buf_size_shift, size_t *size);
 int perfdisown(void *region, size_t size);
 long get_page_size(void);
 size_t get_mask_from_size(size_t size);
@@ -15,6 +15,8 @@ extern "C" {
 typedef struct MLWorkerFlags {
   volatile bool restart_worker;
   volatile bool errors;
+  volatile int buf_size_shift; // ring buffer size for the next worker (0: use
+                               // the configured size)
 } MLWorkerFlags;
 
 /**
@@ -18,13 +18,40 @@ typedef struct RingBuffer {
   unsigned char *wrbuf;
 } RingBuffer;
 
+// Record read in place from the ring buffer. When the record wraps around the
+// end of the buffer, its remaining bytes start at wrap.
+typedef struct RecordView {
+  struct perf_event_header *hdr;
+  const char *wrap; // NULL if the record is contiguous
+  uint64_t split;   // bytes of the record before the wrap
+} RecordView;
+
+void record_view_init(RecordView *view, struct perf_event_header *hdr);
+
 bool rb_init(RingBuffer *rb, struct perf_event_mmap_page *page, size_t size);
 void rb_free(RingBuffer *rb);
 void rb_clear(RingBuffer *rb); // does not deallocate the buffer storage
 uint64_t rb_next(RingBuffer *rb);
 struct perf_event_header *rb_seek(RingBuffer *rb, uint64_t offset);
+// Same as rb_seek, without copying samples that wrap within the user stack :
+// only their stack is split in two parts.
+void rb_seek_view(RingBuffer *rb, uint64_t offset, uint64_t mask,
+                  RecordView *view);
 bool samp2hdr(struct perf_event_header *hdr, perf_event_sample *sample,
               size_t sz_hdr, uint64_t mask);
 perf_event_sample *hdr2samp(struct perf_event_header *hdr, uint64_t mask);
+perf_event_sample *view2samp(const RecordView *view, uint64_t mask);
+
+// Offset of the user stack data within samples (0 if it can not be computed)
+uint64_t sample_stack_offset(uint64_t mask);
 
 uint64_t hdr_time(struct perf_event_header *hdr, uint64_t mask);
+
+// view2samp and hdr_time dispatch to decoders specialized for the configured
+// sample types. The generic versions handle any mask (tests and benchmarks).
+perf_event_sample *view2samp_generic(const RecordView *view, uint64_t mask);
+uint64_t hdr_time_generic(struct perf_event_header *hdr, uint64_t mask);
+
+// Identifier of the event that emitted the record (0 if unavailable).
+// Assumes sample_id_all is set for non-sample records.
+uint64_t hdr_id(struct perf_event_header *hdr, uint64_t mask);
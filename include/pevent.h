@@ -5,20 +5,37 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #include "perf_ringbuffer.h"
 
-#define MAX_NB_WATCHERS 450
+#define PEVENT_ALIGNMENT 64 // cache line
+#define PEVENT_FILL_BUCKETS 4 // quarters of the ring buffer
 
 typedef struct PEvent {
-  int pos;       // Index into the sample
-  int fd;        // Underlying perf event FD
-  RingBuffer rb; // metadata and buffers for processing perf ringbuffer
+  int pos;           // Index into the sample
+  int fd;            // Underlying perf event FD
+  int cpu;           // CPU the event is bound to
+  uint64_t max_fill; // highest ring buffer usage over the cycle (bytes)
+  bool shared_rb;    // other events are redirected to this ring buffer
+  // number of drain passes per fill level of the ring buffer (over the cycle)
+  uint32_t fill_hist[PEVENT_FILL_BUCKETS];
+  RingBuffer rb;     // metadata and buffers for processing perf ringbuffer
 } PEvent;
 
+// Identifier of an event, to find the watcher of records in shared buffers
+typedef struct PEventId {
+  uint64_t id;
+  int pos;
+} PEventId;
+
+// One PEvent per watcher and per CPU, allocated when the events are opened
 typedef struct PEventHdr {
-  PEvent pes[MAX_NB_WATCHERS];
+  PEvent *pes;
   size_t size;
-  size_t max_size;
+  size_t max_size; // allocated number of PEvents
+  PEventId *ids;   // sorted by id (empty if identifiers are not available)
+  size_t nb_ids;
 } PEventHdr;
@@ -13,16 +13,33 @@
 void pevent_init(PEventHdr *pevent_hdr);
 
 /// Setup perf event according to requested watchers.
+/// One event is allocated per watcher and per CPU.
 DDRes pevent_open(DDProfContext *ctx, pid_t pid, int num_cpu,
                   PEventHdr *pevent_hdr);
 
 /// Setup mmap buffers according to content of peventhdr
-DDRes pevent_mmap(PEventHdr *pevent_hdr, bool use_override);
+/// Events of a given CPU are redirected to a single ring buffer when possible.
+/// Buffers hold (1 << buf_size_shift) pages. Smaller buffers are attempted if
+/// the mapping fails (locked memory limits) : mapped_shift is set to the size
+/// of the smallest buffer that was mapped.
+DDRes pevent_mmap(PEventHdr *pevent_hdr, int buf_size_shift,
+                  bool use_override, int *mapped_shift);
+
+/// Ring buffer size (shift) to map after a cycle in adaptive mode. Buffers
+/// grow when events were lost and shrink back to base_shift when they were
+/// not busy. The result is clamped to the MIN/MAX_BUFF_SIZE_SHIFT range.
+int pevent_next_buf_size_shift(int shift, int base_shift, bool lossy,
+                               bool busy);
 
 /// Setup watchers = setup mmap + setup perfevent
 DDRes pevent_setup(DDProfContext *ctx, pid_t pid, int num_cpu,
                    PEventHdr *pevent_hdr);
 
+/// Watcher position of a record read from a shared ring buffer
+/// default_pos is returned if the identifier is unknown
+int pevent_pos_from_id(const PEventHdr *pevent_hdr, uint64_t id,
+                       int default_pos);
+
 /// Call ioctl PERF_EVENT_IOC_ENABLE on available file descriptors
 DDRes pevent_enable(PEventHdr *pevent_hdr);
 
@@ -33,4 +50,5 @@ DDRes pevent_munmap(PEventHdr *pevent_hdr);
 DDRes pevent_close(PEventHdr *pevent_hdr);
 
 /// cleanup watchers = cleanup perfevent + cleanup mmap (clean everything)
+/// The storage of the events is released.
 DDRes pevent_cleanup(PEventHdr *pevent_hdr);
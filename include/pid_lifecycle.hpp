@@ -0,0 +1,61 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include <sys/types.h>
+}
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace ddprof {
+
+/// Pids whose thread group leader exited. Their unwinding structures are
+/// released after a grace period : samples recorded before the exit can still
+/// be pending in the ring buffers of other CPUs.
+class PidLifecycle {
+public:
+  static constexpr int64_t k_default_grace_period_ns = 1000000000;
+
+  explicit PidLifecycle(int64_t grace_period_ns = k_default_grace_period_ns)
+      : _grace_period_ns(grace_period_ns), _generation(0) {}
+
+  void exited(pid_t pid, int64_t now_ns);
+  // The pid is used again by a new process
+  void started(pid_t pid);
+
+  // Appends the pids that exited for longer than the grace period, they are
+  // no longer tracked
+  void pop_expired(int64_t now_ns, std::vector<pid_t> &pids);
+
+  bool empty() const { return _exited.empty(); }
+  size_t nb_exited() const { return _generations.size(); }
+  bool is_exited(pid_t pid) const {
+    return _generations.find(pid) != _generations.end();
+  }
+
+  // pids released since the last reset
+  std::vector<pid_t> _released;
+
+private:
+  struct Exited {
+    pid_t _pid;
+    int64_t _time_ns;
+    uint64_t _generation;
+  };
+
+  int64_t _grace_period_ns;
+  uint64_t _generation;
+  // in exit order, entries of pids that started or exited again are stale
+  std::deque<Exited> _exited;
+  // generation of the last exit of the pids that are still exited
+  std::unordered_map<pid_t, uint64_t> _generations;
+};
+
+} // namespace ddprof
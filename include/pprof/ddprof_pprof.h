@@ -25,13 +25,13 @@ DDRes pprof_create_profile(DDProfPProf *pprof, const PerfOption *options,
 /**
  * Aggregate to the existing profile the provided unwinding output.
  * @param uw_output
+ * @param symbol_hdr names of the symbols are demangled on first export
  * @param value matching the watcher type (ex : cpu period)
  * @param watcher_idx matches the registered order at profile creation
  * @param pprof
  */
-DDRes pprof_aggregate(const UnwindOutput *uw_output,
-                      const SymbolHdr *symbol_hdr, uint64_t value,
-                      int watcher_idx, DDProfPProf *pprof);
+DDRes pprof_aggregate(const UnwindOutput *uw_output, SymbolHdr *symbol_hdr,
+                      uint64_t value, int watcher_idx, DDProfPProf *pprof);
 
 DDRes pprof_reset(DDProfPProf *pprof);
 
@@ -0,0 +1,57 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include "ddprof_defs.h"
+}
+
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace ddprof {
+
+/// Mapping described by a line of /proc/<pid>/maps
+struct ProcMapsEntry {
+  ProcessAddress_t _start;
+  ProcessAddress_t _end; // first address after the mapping
+  Offset_t _offset;
+  bool _executable;
+  // null terminated, points into the buffer of the reader
+  const char *_path;
+  size_t _path_len;
+};
+
+/// Parses /proc/<pid>/maps files
+///
+/// The file is read at once into a buffer kept across reads, lines are then
+/// parsed in place : no allocation once the buffer is large enough for the
+/// biggest maps file seen.
+class ProcMapsReader {
+public:
+  ProcMapsReader() : _size(0), _pos(0) {}
+
+  // false if the file can not be read
+  bool read(const char *path);
+  bool read(pid_t pid, const std::string &path_to_proc = "");
+
+  // Next valid mapping of the file read, false once all lines are consumed.
+  // Entries are valid until the next read.
+  bool next(ProcMapsEntry &entry);
+
+  // Parse a line of a maps file, line_end points to its '\n' or to a null
+  // character. The path is null terminated in place.
+  static bool parse_line(char *line, char *line_end, ProcMapsEntry &entry);
+
+private:
+  std::vector<char> _buf;
+  size_t _size; // bytes read
+  size_t _pos;  // start of the next line
+};
+
+} // namespace ddprof
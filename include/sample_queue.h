@@ -0,0 +1,56 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Single producer / single consumer queue of perf records.
+// Storage is preallocated. Records are copied contiguously, prefixed by a
+// SampleQueueEntry. When a record does not fit before the end of the storage,
+// a padding entry is inserted and the record starts again at the beginning.
+// head and tail are monotonic byte counters : head is only written by the
+// producer, tail is only written by the consumer.
+typedef struct SampleQueueEntry {
+  uint32_t size; // size of the entry, including this header
+  int32_t pos;   // watcher position (-1 for padding)
+} SampleQueueEntry;
+
+typedef struct SampleQueue {
+  char *buf;
+  uint64_t capacity;
+  uint64_t reserved; // producer only : size of the pending reservation
+  uint64_t head;
+  char _pad[56]; // keep head and tail on separate cache lines
+  uint64_t tail;
+} SampleQueue;
+
+// Allocates storage (capacity is rounded to a multiple of 8 bytes)
+bool sample_queue_init(SampleQueue *q, uint64_t capacity);
+
+void sample_queue_free(SampleQueue *q);
+
+// Producer : reserve room for a record of the given size (multiple of 8).
+// Returns NULL if the queue is full. The record becomes visible to the
+// consumer on commit.
+struct perf_event_header *sample_queue_reserve(SampleQueue *q, uint32_t size,
+                                               int pos);
+void sample_queue_commit(SampleQueue *q);
+
+// Producer : copy a record. Returns false if the queue is full.
+bool sample_queue_push(SampleQueue *q, const struct perf_event_header *hdr,
+                       int pos);
+
+// Consumer : get the oldest record, NULL if the queue is empty
+struct perf_event_header *sample_queue_front(SampleQueue *q, int *pos);
+
+// Consumer : release the record returned by the last front call
+void sample_queue_pop(SampleQueue *q);
+
+// Number of bytes used (approximate when called concurrently)
+uint64_t sample_queue_used(const SampleQueue *q);
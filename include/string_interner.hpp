@@ -0,0 +1,86 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ddprof {
+
+/// Null terminated string owned by a StringInterner, valid for the lifetime
+/// of the interner. Strings of an interner are stored once : equal strings
+/// share the same storage.
+class InternedString {
+public:
+  InternedString() : _ptr(""), _len(0) {}
+
+  const char *c_str() const { return _ptr; }
+  size_t size() const { return _len; }
+  size_t length() const { return _len; }
+  bool empty() const { return _len == 0; }
+  char operator[](size_t pos) const { return _ptr[pos]; }
+  std::string str() const { return std::string(_ptr, _len); }
+
+  bool operator==(const InternedString &o) const {
+    return _ptr == o._ptr ||
+        (_len == o._len && memcmp(_ptr, o._ptr, _len) == 0);
+  }
+  bool operator!=(const InternedString &o) const { return !(*this == o); }
+
+private:
+  friend class StringInterner;
+  friend struct InternedStringHash;
+  InternedString(const char *ptr, uint32_t len) : _ptr(ptr), _len(len) {}
+
+  const char *_ptr;
+  uint32_t _len;
+};
+
+struct InternedStringHash {
+  size_t operator()(const InternedString &str) const;
+};
+
+/// Stores each distinct string once, in large blocks that are never freed
+/// before the interner
+class StringInterner {
+public:
+  StringInterner() : _block_pos(nullptr), _block_end(nullptr), _arena_size(0) {}
+  // interned strings point to the blocks of this interner
+  StringInterner(const StringInterner &) = delete;
+  StringInterner &operator=(const StringInterner &) = delete;
+  // blocks do not move
+  StringInterner(StringInterner &&) = default;
+  StringInterner &operator=(StringInterner &&) = default;
+
+  InternedString intern(const char *str, size_t len);
+  InternedString intern(const char *str) { return intern(str, strlen(str)); }
+  InternedString intern(const std::string &str) {
+    return intern(str.c_str(), str.size());
+  }
+
+  // number of distinct strings
+  size_t size() const { return _strings.size(); }
+  // bytes allocated to store the strings
+  size_t arena_size() const { return _arena_size; }
+
+private:
+  static constexpr size_t k_block_size = 64 * 1024;
+
+  char *allocate(size_t size);
+
+  std::unordered_set<InternedString, InternedStringHash> _strings;
+  std::vector<std::unique_ptr<char[]>> _blocks;
+  char *_block_pos;
+  char *_block_end;
+  size_t _arena_size;
+};
+
+} // namespace ddprof
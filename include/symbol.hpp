@@ -6,8 +6,7 @@
 #pragma once
 
 #include "ddprof_defs.h"
-
-#include <string>
+#include "string_interner.hpp"
 
 // Symbol
 // Information relating to a given location
@@ -17,20 +16,21 @@ class Symbol {
 public:
   Symbol() : _lineno(0) {}
 
-  // Warning : Generates some string copies (these are not rvalues)
-  Symbol(std::string symname, std::string demangle_name, uint32_t lineno,
-         std::string srcpath)
-      : _symname(std::move(symname)), _demangle_name(std::move(demangle_name)),
-        _lineno(lineno), _srcpath(std::move(srcpath)) {}
+  // Strings are interned in the symbol table
+  Symbol(InternedString symname, InternedString demangle_name,
+         uint32_t lineno, InternedString srcpath)
+      : _symname(symname), _demangle_name(demangle_name), _lineno(lineno),
+        _srcpath(srcpath) {}
 
   // OUTPUT OF ADDRINFO
-  std::string _symname;
+  InternedString _symname;
 
-  // DEMANGLING CACHE
-  std::string _demangle_name;
+  // DEMANGLING CACHE : empty until the symbol is exported
+  // (see SymbolTable::demangled)
+  InternedString _demangle_name;
 
   // OUTPUT OF LINE INFO
   uint32_t _lineno;
-  std::string _srcpath;
+  InternedString _srcpath;
 };
 } // namespace ddprof
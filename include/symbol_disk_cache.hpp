@@ -0,0 +1,74 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include "ddprof_defs.h"
+}
+
+#include "build_id.hpp"
+#include "ddprof_file_info-i.hpp"
+#include "symbol.hpp"
+#include "symbol_table.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ddprof {
+
+/// Symbol resolved for a range of file offsets (end included)
+struct SymbolCacheEntry {
+  Offset_t _start;
+  Offset_t _end;
+  Symbol _symbol;
+};
+
+/// Symbols of binaries persisted on disk, keyed by build-id and file size
+///
+/// Each binary has an append-only file <dir>/<build-id>-<size>.sym : a header
+/// followed by records (range of file offsets, line, then the mangled name
+/// and source path of the symbol). Files are memory mapped and loaded the
+/// first time a binary is symbolized, symbols then resolved through libdwfl
+/// are appended. The symbols survive worker restarts and are shared by the
+/// worker threads and by other profilers using the same directory.
+class SymbolDiskCache {
+public:
+  SymbolDiskCache() {}
+  ~SymbolDiskCache();
+
+  SymbolDiskCache(const SymbolDiskCache &other) = delete;
+  SymbolDiskCache &operator=(const SymbolDiskCache &other) = delete;
+
+  // An empty directory disables the cache
+  void set_directory(const char *dir);
+  bool enabled() const { return !_dir.empty(); }
+
+  // Open (or create) the cache file of the binary and load the symbols of
+  // the range [start_offset, end_offset), strings are interned in the table.
+  // The size tells stripped and unstripped copies (same build-id) apart.
+  // Returns the number of entries loaded.
+  int open(FileInfoId_t id, const BuildId &build_id, int64_t file_size,
+           Offset_t start_offset, Offset_t end_offset, SymbolTable &table,
+           std::vector<SymbolCacheEntry> &entries);
+
+  // Persist a symbol of a binary opened previously
+  void append(FileInfoId_t id, Offset_t start, Offset_t end,
+              const Symbol &symbol);
+
+  void close(FileInfoId_t id);
+
+private:
+  std::string file_path(const BuildId &build_id, int64_t file_size) const;
+  int open_file(const std::string &path);
+
+  std::string _dir;
+  // append-only descriptors of the files opened, per file
+  std::unordered_map<FileInfoId_t, int> _fds;
+  std::vector<char> _record_buf;
+};
+
+} // namespace ddprof
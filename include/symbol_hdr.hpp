@@ -24,6 +24,13 @@ struct SymbolHdr {
   void display_stats() const {
     _dwfl_symbol_lookup_v2._stats.display(_dwfl_symbol_lookup_v2.size());
     _dso_symbol_lookup.stats_display();
+    LG_NTC("STRINGS   | %10s | %lu (%lu bytes)", "SYMBOLS",
+           _symbol_table.strings().size(),
+           _symbol_table.strings().arena_size());
+    LG_NTC("STRINGS   | %10s | %lu", "DEMANGLED", _symbol_table.nb_demangled());
+    LG_NTC("STRINGS   | %10s | %lu (%lu bytes)", "MAPINFOS",
+           _mapinfo_table.strings().size(),
+           _mapinfo_table.strings().arena_size());
   }
   void cycle() { _dwfl_symbol_lookup_v2._stats.reset(); }
 
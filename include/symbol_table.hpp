@@ -7,10 +7,39 @@
 
 #include "symbol.hpp"
 
+#include <unordered_map>
 #include <vector>
 
 namespace ddprof {
 
-typedef std::vector<Symbol> SymbolTable;
+/// Symbols of the worker. Their strings are stored once, in the table.
+class SymbolTable {
+public:
+  Symbol &operator[](SymbolIdx_t idx) { return _symbols[idx]; }
+  const Symbol &operator[](SymbolIdx_t idx) const { return _symbols[idx]; }
+  size_t size() const { return _symbols.size(); }
+  void push_back(Symbol &&symbol) { _symbols.push_back(std::move(symbol)); }
+
+  InternedString intern(const char *str) { return _strings.intern(str); }
+  InternedString intern(const char *str, size_t len) {
+    return _strings.intern(str, len);
+  }
+  InternedString intern(const std::string &str) {
+    return _strings.intern(str);
+  }
+  const StringInterner &strings() const { return _strings; }
+
+  // Symbol with its demangled name. Names are only demangled when a symbol
+  // is exported, each distinct name once.
+  const Symbol &demangled(SymbolIdx_t idx);
+  // number of distinct names demangled
+  size_t nb_demangled() const { return _demangled_names.size(); }
+
+private:
+  std::vector<Symbol> _symbols;
+  StringInterner _strings;
+  // mangled -> demangled names, keyed by the storage of the interned names
+  std::unordered_map<const char *, InternedString> _demangled_names;
+};
 
 } // namespace ddprof
@@ -6,6 +6,7 @@
 #pragma once
 
 extern "C" {
+#include <stdint.h>
 #include <sys/types.h>
 
 #include "ddres.h"
@@ -17,9 +18,12 @@ namespace ddprof {
 void unwind_init(void);
 
 // Fill sample info to prepare for unwinding
+// The stack can be split in two parts (sample_data_stack_wrap is NULL
+// otherwise)
 void unwind_init_sample(UnwindState *us, uint64_t *sample_regs,
                         pid_t sample_pid, uint64_t sample_size_stack,
-                        char *sample_data_stack);
+                        char *sample_data_stack, uint64_t sample_stack_split,
+                        char *sample_data_stack_wrap);
 
 // Main unwind API
 DDRes unwindstate__unwind(UnwindState *us);
@@ -30,4 +34,19 @@ void unwind_cycle(UnwindState *us);
 // Clear unwinding structures of this pid
 void unwind_pid_free(UnwindState *us, pid_t pid);
 
+// Start the unwinding structures of a forked pid from the ones of its parent
+void unwind_pid_fork(UnwindState *us, pid_t ppid, pid_t pid);
+
+// Fork replayed from another shard, possibly after events of the child : the
+// state of a child already known is kept (mappings and lifecycle)
+void unwind_pid_fork_replayed(UnwindState *us, pid_t ppid, pid_t pid);
+
+// The thread group leader of the pid exited : structures of the pid are
+// released after a grace period
+void unwind_pid_exit(UnwindState *us, pid_t pid, int64_t now_ns);
+
+// Clear unwinding structures of the pids exited for longer than the grace
+// period
+void unwind_release_exited(UnwindState *us, int64_t now_ns);
+
 } // namespace ddprof
@@ -0,0 +1,18 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+#include "ddres_def.h"
+
+typedef struct UnwindState UnwindState;
+namespace ddprof {
+
+// Unwind from us->dwarf_regs using the tables precompiled from .eh_frame.
+// complete is false when a frame is not covered by the tables : libdwfl
+// should then resume from us->dwarf_regs.
+DDRes unwind_cfi(UnwindState *us, bool *complete);
+
+} // namespace ddprof
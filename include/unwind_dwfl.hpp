@@ -5,13 +5,27 @@
 
 #pragma once
 
+extern "C" {
+#include "ddprof_defs.h"
+}
+
 #include "ddres_def.h"
 
 typedef struct UnwindState UnwindState;
 namespace ddprof {
+class Dso;
 
 DDRes unwind_init_dwfl(UnwindState *us);
 
 DDRes unwind_dwfl(UnwindState *us);
 
+// Symbolize pc and append it to the unwinding output
+DDRes add_dwfl_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc);
+
+// Append the frame if (pid, pc) was already resolved. Returns false otherwise.
+bool add_cached_frame(UnwindState *us, ElfAddress_t pc);
+
+// Same as add_dwfl_frame, without looking up the frame cache
+DDRes add_resolved_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc);
+
 } // namespace ddprof
@@ -0,0 +1,22 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+#include "ddres_def.h"
+
+typedef struct UnwindState UnwindState;
+namespace ddprof {
+
+// exclude : comma separated list of DSO paths (or parts of them) built without
+// frame pointers
+void unwind_fp_config(UnwindState *us, bool enable, const char *exclude);
+
+// Follow the frame pointers within the stack snapshot. complete is false when
+// the chain can not be followed up to its end : DWARF unwinding should then
+// resume from us->dwarf_regs.
+DDRes unwind_fp(UnwindState *us, bool *complete);
+
+} // namespace ddprof
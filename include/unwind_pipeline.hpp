@@ -0,0 +1,60 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include <linux/perf_event.h>
+#include <pthread.h>
+
+#include "ddres_def.h"
+#include "perf_ringbuffer.h"
+#include "sample_queue.h"
+}
+
+typedef struct DDProfContext DDProfContext;
+
+/// UnwindPipeline
+/// Decouples the consumption of the perf ring buffers from unwinding.
+/// The reader copies records (trimming the unused part of the stack) into a
+/// preallocated queue, which releases the kernel buffer right away. An
+/// unwinder thread processes the records in order.
+/// The worker context (unwinding state, profile) belongs to the unwinder
+/// thread until quiesce returns.
+struct UnwindPipeline {
+  UnwindPipeline();
+  ~UnwindPipeline();
+
+  DDRes start(DDProfContext *ctx, uint64_t capacity);
+
+  // Reader side : samples are dropped when the queue is full, other events
+  // wait for room as they modify the unwinding state
+  DDRes push_event(const RecordView *view, int pos);
+
+  // Wait for the unwinder to process everything that was pushed
+  DDRes quiesce();
+
+  // Publish the queue statistics for the current cycle
+  void cycle_stats();
+
+private:
+  static void *thread_entry(void *arg);
+  void consume();
+  bool push_trimmed_sample(const RecordView *view, int pos);
+  void notify_consumer();
+
+  SampleQueue _queue;
+  DDProfContext *_ctx;
+  pthread_t _tid;
+  bool _started;
+  pthread_mutex_t _mutex;
+  pthread_cond_t _wake_cond; // signaled by the reader
+  pthread_cond_t _idle_cond; // signaled by the unwinder when out of work
+  bool _sleeping;            // unwinder waits for new records
+  bool _stop;
+  bool _fatal;        // the unwinder reported a fatal error
+  uint64_t _max_used; // high watermark of the queue over the cycle
+  DDRes _res;         // first error reported by the unwinder
+};
@@ -0,0 +1,42 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+#include <stdint.h>
+
+#define K_NB_REGS_UNWIND 3
+
+struct UnwindRegisters {
+  UnwindRegisters() {
+    for (int i = 0; i < K_NB_REGS_UNWIND; ++i) {
+      regs[i] = 0;
+    }
+  }
+  union {
+    uint64_t regs[K_NB_REGS_UNWIND];
+    struct {
+      uint64_t ebp; // base address of the function's frame
+      uint64_t esp; // top of the stack
+      uint64_t eip; // Extended Instruction Pointer
+    };
+  };
+};
+
+static inline bool unwind_registers_equal(const UnwindRegisters *lhs,
+                                          const UnwindRegisters *rhs) {
+  for (unsigned i = 0; i < K_NB_REGS_UNWIND; ++i) {
+    if (lhs->regs[i] != rhs->regs[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static inline void unwind_registers_clear(UnwindRegisters *unwind_registers) {
+  for (unsigned i = 0; i < K_NB_REGS_UNWIND; ++i) {
+    unwind_registers->regs[i] = 0;
+  }
+}
@@ -10,32 +10,21 @@ extern "C" {
 #include <sys/types.h>
 }
 
+#include "cfi_table.hpp"
 #include "ddprof_defs.h"
 #include "ddres_def.h"
 #include "dso_hdr.hpp"
 #include "dwfl_hdr.hpp"
 #include "dwfl_thread_callbacks.hpp"
+#include "frame_cache.hpp"
+#include "pid_lifecycle.hpp"
 #include "symbol_hdr.hpp"
+#include "unwind_registers.hpp"
 
-typedef struct Dwfl Dwfl;
-
-#define K_NB_REGS_UNWIND 3
+#include <string>
+#include <vector>
 
-struct UnwindRegisters {
-  UnwindRegisters() {
-    for (int i = 0; i < K_NB_REGS_UNWIND; ++i) {
-      regs[i] = 0;
-    }
-  }
-  union {
-    uint64_t regs[K_NB_REGS_UNWIND];
-    struct {
-      uint64_t ebp; // base address of the function's frame
-      uint64_t esp; // top of the stack
-      uint64_t eip; // Extended Instruction Pointer
-    };
-  };
-};
+typedef struct Dwfl Dwfl;
 
 /// UnwindState
 /// Single structure with everything necessary in unwinding. The structure is
@@ -43,7 +32,8 @@ struct UnwindRegisters {
 typedef struct UnwindState {
   UnwindState()
       : _dwfl_wrapper(nullptr), pid(-1), stack(nullptr), stack_sz(0),
-        current_eip(0) {
+        stack_wrap(nullptr), stack_split(0), current_eip(0), fp_unwind(false),
+        cfi_unwind(false) {
     uw_output_clear(&output);
   }
 
@@ -52,29 +42,32 @@ typedef struct UnwindState {
 
   ddprof::DsoHdr dso_hdr;
   SymbolHdr symbol_hdr;
+  ddprof::CfiTableHdr cfi_table_hdr;
+  // (pid, pc) to symbol and mapping, skips lookups on hot frames
+  ddprof::FrameCache frame_cache;
+  // exited pids, released after a grace period
+  ddprof::PidLifecycle pid_lifecycle;
 
   pid_t pid;
   char *stack;
   size_t stack_sz;
+  // When the sample wraps around the ring buffer, the stack is read in place
+  // from two parts : stack_split bytes from stack, then the rest from
+  // stack_wrap
+  char *stack_wrap;
+  size_t stack_split;
 
   UnwindRegisters initial_regs;
+  // Registers DWARF unwinding starts from (frames above were found by
+  // following frame pointers or with the unwind tables)
+  UnwindRegisters dwarf_regs;
   ProcessAddress_t current_eip;
 
+  // Frame pointer unwinding, with DWARF as a fallback
+  bool fp_unwind;
+  std::vector<std::string> fp_exclude; // DSO paths built without FP
+  // Unwind tables precompiled from .eh_frame, before falling back to libdwfl
+  bool cfi_unwind;
+
   UnwindOutput output;
 } UnwindState;
-
-static inline bool unwind_registers_equal(const UnwindRegisters *lhs,
-                                          const UnwindRegisters *rhs) {
-  for (unsigned i = 0; i < K_NB_REGS_UNWIND; ++i) {
-    if (lhs->regs[i] != rhs->regs[i]) {
-      return false;
-    }
-  }
-  return true;
-}
-
-static inline void unwind_registers_clear(UnwindRegisters *unwind_registers) {
-  for (unsigned i = 0; i < K_NB_REGS_UNWIND; ++i) {
-    unwind_registers->regs[i] = 0;
-  }
-}
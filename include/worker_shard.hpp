@@ -0,0 +1,121 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#pragma once
+
+extern "C" {
+#include <linux/perf_event.h>
+#include <pthread.h>
+
+#include "ddres_def.h"
+#include "pevent.h"
+#include "unwind_output.h"
+}
+
+#include "unwind_state.hpp"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+typedef struct DDProfContext DDProfContext;
+
+// Unwinding output kept aside until shards are joined : the profile we
+// aggregate into is not thread safe.
+struct PendingSample {
+  uint64_t value;
+  int pos;
+  unsigned nb_locs;
+};
+
+/// WorkerShard
+/// A subset of the ring buffers (all watchers of a set of CPUs) drained by a
+/// single thread, along with its own unwinding caches (DSO, DWFL, symbols).
+struct WorkerShard {
+  explicit WorkerShard(int idx)
+      : _idx(idx), _round_parity(0), _count_samples(0), _now_ns(0) {}
+
+  void push_sample(const UnwindOutput *output, uint64_t value, int pos);
+  // Keep track of events that modify the state of a process. Other shards
+  // replay them at the start of the next round.
+  void push_sideband(const perf_event_header *hdr, int pos);
+  void clear_samples() {
+    _locs.clear();
+    _samples.clear();
+  }
+
+  int _idx;
+  UnwindState _us;
+  std::vector<int> _pevent_idx; // indexes into the PEventHdr
+  std::vector<FunLoc> _locs;
+  std::vector<PendingSample> _samples;
+  // double buffered : written during round N, read by others during N + 1
+  std::vector<char> _sideband[2];
+  unsigned _round_parity;
+  uint32_t _count_samples; // avoid bouncing on backpopulates
+  int64_t _now_ns;         // time at the end of the last drain
+};
+
+/// WorkerShardPool
+/// Fork-join pool of persistent threads. The calling thread handles shard 0,
+/// so that N shards only spawn N - 1 threads.
+struct WorkerShardPool {
+  typedef std::function<DDRes(WorkerShard &)> RoundFun;
+  typedef std::function<DDRes(const UnwindOutput *output,
+                              SymbolHdr *symbol_hdr, uint64_t value, int pos)>
+      AggregateFun;
+
+  explicit WorkerShardPool(int nb_shards);
+  ~WorkerShardPool();
+
+  // Spawn threads and distribute the ring buffers
+  DDRes start(const PEventHdr *pevent_hdr);
+  // Run fun on every shard and wait for all of them
+  DDRes run(const RoundFun &fun);
+  // Hand the samples kept in the shards to fun, shard after shard, rebuilding
+  // each of them in output. Samples are cleared even on errors : they are
+  // never aggregated twice.
+  DDRes aggregate(UnwindOutput *output, const AggregateFun &fun);
+
+  int size() const { return _shards.size(); }
+
+  std::vector<std::unique_ptr<WorkerShard>> _shards;
+
+private:
+  static void *thread_entry(void *arg);
+  void run_shard(WorkerShard &shard);
+  void replay_sideband(WorkerShard &shard);
+
+  struct ThreadArg {
+    WorkerShardPool *pool;
+    int idx;
+  };
+
+  std::vector<pthread_t> _tids;
+  std::vector<ThreadArg> _thread_args;
+  std::vector<DDRes> _res;
+  // Rounds are published through a generation counter. Threads that were
+  // created report back through _pending.
+  pthread_mutex_t _mutex;
+  pthread_cond_t _start_cond;
+  pthread_cond_t _done_cond;
+  unsigned _round;
+  int _pending;
+  bool _stop;
+  const RoundFun *_fun;
+};
+
+namespace ddprof {
+// Process an event within a shard (samples are kept in the shard)
+DDRes worker_shard_process_event(const RecordView *view, int pos,
+                                 DDProfContext *ctx, WorkerShard *shard);
+
+// Aggregate the samples kept in the shards (from the calling thread)
+DDRes worker_shard_aggregate(DDProfContext *ctx);
+
+// Apply a side-band event recorded by another shard
+void worker_shard_replay_event(struct perf_event_header *hdr, int pos,
+                               WorkerShard *shard);
+} // namespace ddprof
@@ -14,9 +14,9 @@ extern "C" {
 namespace ddprof {
 
 namespace {
-Symbol symbol_from_pid(pid_t pid) {
-  std::string pid_str = string_format("pid_%d", pid);
-  return Symbol(std::string(), std::string(), 0, pid_str);
+Symbol symbol_from_pid(pid_t pid, SymbolTable &symbol_table) {
+  return Symbol(InternedString(), InternedString(), 0,
+                symbol_table.intern(string_format("pid_%d", pid)));
 }
 } // namespace
 
@@ -27,10 +27,9 @@ BaseFrameSymbolLookup::insert_bin_symbol(pid_t pid, SymbolTable &symbol_table,
   SymbolIdx_t symbol_idx = -1;
 
   DsoHdr::DsoFindRes find_res = dso_hdr.dso_find_first_std_executable(pid);
-  if (find_res.second && find_res.first->second._type == dso::kStandard) {
+  if (find_res.second && find_res.first->_type == dso::kStandard) {
     // todo : how to tie lifetime of DSO to this ?
-    symbol_idx =
-        dso_symbol_lookup.get_or_insert(find_res.first->second, symbol_table);
+    symbol_idx = dso_symbol_lookup.get_or_insert(*find_res.first, symbol_table);
     _bin_map.insert(std::pair<pid_t, SymbolIdx_t>(pid, symbol_idx));
   } else {
     LG_NTC("Unable to find base frame for pid %d", pid);
@@ -63,7 +62,7 @@ BaseFrameSymbolLookup::get_or_insert(pid_t pid, SymbolTable &symbol_table,
   // First time we fail on this pid : insert a pid info in symbol table
   if (symbol_idx == -1) {
     symbol_idx = symbol_table.size();
-    symbol_table.push_back(symbol_from_pid(pid));
+    symbol_table.push_back(symbol_from_pid(pid, symbol_table));
     _pid_map.emplace(pid, PidSymbol(symbol_idx));
   }
   return symbol_idx;
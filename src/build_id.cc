@@ -0,0 +1,134 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "build_id.hpp"
+
+extern "C" {
+#include "logger.h"
+}
+
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+namespace ddprof {
+
+namespace {
+// bounds of what we are willing to read
+constexpr unsigned k_max_phnum = 256;
+constexpr size_t k_max_note_sz = 64 * 1024;
+
+bool pread_all(int fd, void *buf, size_t sz, off_t offset) {
+  char *ptr = static_cast<char *>(buf);
+  while (sz) {
+    ssize_t res = pread(fd, ptr, sz, offset);
+    if (res == -1 && errno == EINTR) {
+      continue;
+    }
+    if (res <= 0) {
+      return false;
+    }
+    ptr += res;
+    sz -= res;
+    offset += res;
+  }
+  return true;
+}
+
+inline size_t align_up(size_t val, size_t align) {
+  return (val + align - 1) & ~(align - 1);
+}
+
+template <typename Ehdr, typename Phdr> BuildId read_build_id_fd(int fd) {
+  Ehdr ehdr;
+  if (!pread_all(fd, &ehdr, sizeof(ehdr), 0) ||
+      ehdr.e_phentsize != sizeof(Phdr) || ehdr.e_phnum > k_max_phnum) {
+    return BuildId();
+  }
+  std::vector<Phdr> phdrs(ehdr.e_phnum);
+  if (!pread_all(fd, phdrs.data(), phdrs.size() * sizeof(Phdr),
+                 ehdr.e_phoff)) {
+    return BuildId();
+  }
+  std::vector<char> notes;
+  for (const Phdr &phdr : phdrs) {
+    if (phdr.p_type != PT_NOTE || phdr.p_filesz > k_max_note_sz) {
+      continue;
+    }
+    notes.resize(phdr.p_filesz);
+    if (!pread_all(fd, notes.data(), notes.size(), phdr.p_offset)) {
+      continue;
+    }
+    BuildId build_id = build_id_from_notes(notes.data(), notes.size(),
+                                           phdr.p_align == 8 ? 8 : 4);
+    if (!build_id.empty()) {
+      return build_id;
+    }
+  }
+  return BuildId();
+}
+} // namespace
+
+BuildId format_build_id(const unsigned char *bits, size_t len) {
+  static const char k_hex[] = "0123456789abcdef";
+  BuildId res;
+  if (!bits) {
+    return res;
+  }
+  res.reserve(len * 2);
+  for (size_t i = 0; i < len; ++i) {
+    res += k_hex[bits[i] >> 4];
+    res += k_hex[bits[i] & 0xf];
+  }
+  return res;
+}
+
+BuildId build_id_from_notes(const char *notes, size_t sz, size_t align) {
+  // Elf32_Nhdr and Elf64_Nhdr are the same
+  size_t pos = 0;
+  while (sz - pos >= sizeof(Elf64_Nhdr)) {
+    Elf64_Nhdr nhdr;
+    memcpy(&nhdr, notes + pos, sizeof(nhdr));
+    size_t name_pos = pos + sizeof(nhdr);
+    size_t desc_pos = name_pos + align_up(nhdr.n_namesz, align);
+    if (desc_pos > sz || sz - desc_pos < nhdr.n_descsz) {
+      break;
+    }
+    if (nhdr.n_type == NT_GNU_BUILD_ID &&
+        nhdr.n_namesz == sizeof(ELF_NOTE_GNU) &&
+        memcmp(notes + name_pos, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0) {
+      return format_build_id(
+          reinterpret_cast<const unsigned char *>(notes + desc_pos),
+          nhdr.n_descsz);
+    }
+    pos = desc_pos + align_up(nhdr.n_descsz, align);
+  }
+  return BuildId();
+}
+
+BuildId read_build_id(const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    LG_DBG("[BUILD_ID] Unable to open %s", path);
+    return BuildId();
+  }
+  BuildId build_id;
+  unsigned char ident[EI_NIDENT];
+  if (pread_all(fd, ident, sizeof(ident), 0) &&
+      memcmp(ident, ELFMAG, SELFMAG) == 0) {
+    if (ident[EI_CLASS] == ELFCLASS64) {
+      build_id = read_build_id_fd<Elf64_Ehdr, Elf64_Phdr>(fd);
+    } else if (ident[EI_CLASS] == ELFCLASS32) {
+      build_id = read_build_id_fd<Elf32_Ehdr, Elf32_Phdr>(fd);
+    }
+  }
+  close(fd);
+  return build_id;
+}
+
+} // namespace ddprof
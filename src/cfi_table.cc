@@ -0,0 +1,759 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "cfi_table.hpp"
+
+extern "C" {
+#include <fcntl.h>
+#include <gelf.h>
+#include <unistd.h>
+
+#include "logger.h"
+}
+
+#include "defer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+namespace ddprof {
+
+namespace {
+
+// x86_64 DWARF register numbers
+const uint64_t k_dwarf_rbp = 6;
+const uint64_t k_dwarf_rsp = 7;
+
+// Pointer encodings (refer to the LSB specification of .eh_frame)
+const uint8_t k_pe_omit = 0xff;
+const uint8_t k_pe_format_mask = 0x0f;
+const uint8_t k_pe_application_mask = 0x70;
+const uint8_t k_pe_indirect = 0x80;
+enum PeFormat : uint8_t {
+  kPeAbsptr = 0x00,
+  kPeUleb128 = 0x01,
+  kPeUdata2 = 0x02,
+  kPeUdata4 = 0x03,
+  kPeUdata8 = 0x04,
+  kPeSleb128 = 0x09,
+  kPeSdata2 = 0x0a,
+  kPeSdata4 = 0x0b,
+  kPeSdata8 = 0x0c,
+};
+enum PeApplication : uint8_t {
+  kPeAbs = 0x00,
+  kPePcrel = 0x10,
+  kPeDatarel = 0x30,
+};
+
+// Call frame instructions
+enum CfaOp : uint8_t {
+  kCfaNop = 0x00,
+  kCfaSetLoc = 0x01,
+  kCfaAdvanceLoc1 = 0x02,
+  kCfaAdvanceLoc2 = 0x03,
+  kCfaAdvanceLoc4 = 0x04,
+  kCfaOffsetExtended = 0x05,
+  kCfaRestoreExtended = 0x06,
+  kCfaUndefined = 0x07,
+  kCfaSameValue = 0x08,
+  kCfaRegister = 0x09,
+  kCfaRememberState = 0x0a,
+  kCfaRestoreState = 0x0b,
+  kCfaDefCfa = 0x0c,
+  kCfaDefCfaRegister = 0x0d,
+  kCfaDefCfaOffset = 0x0e,
+  kCfaDefCfaExpression = 0x0f,
+  kCfaExpression = 0x10,
+  kCfaOffsetExtendedSf = 0x11,
+  kCfaDefCfaSf = 0x12,
+  kCfaDefCfaOffsetSf = 0x13,
+  kCfaValOffset = 0x14,
+  kCfaValOffsetSf = 0x15,
+  kCfaValExpression = 0x16,
+  kCfaGnuArgsSize = 0x2e,
+  kCfaGnuNegativeOffsetExtended = 0x2f,
+  // high 2 bits, with an operand in the low 6 bits
+  kCfaAdvanceLoc = 0x40,
+  kCfaOffset = 0x80,
+  kCfaRestore = 0xc0,
+};
+
+// Bounds checked reads within a section. Errors are sticky.
+class CfiReader {
+public:
+  CfiReader(const uint8_t *data, size_t size, ElfAddress_t section_addr)
+      : _data(data), _pos(0), _end(size), _section_addr(section_addr),
+        _error(false) {}
+
+  template <typename T> T read() {
+    T val = 0;
+    if (!check(sizeof(T))) {
+      return val;
+    }
+    memcpy(&val, _data + _pos, sizeof(T));
+    _pos += sizeof(T);
+    return val;
+  }
+
+  uint64_t uleb() {
+    uint64_t val = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+      byte = read<uint8_t>();
+      if (shift < 64) {
+        val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      }
+      shift += 7;
+    } while ((byte & 0x80) && !_error);
+    return val;
+  }
+
+  int64_t sleb() {
+    int64_t val = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+      byte = read<uint8_t>();
+      if (shift < 64) {
+        val |= static_cast<int64_t>(byte & 0x7f) << shift;
+      }
+      shift += 7;
+    } while ((byte & 0x80) && !_error);
+    if (shift < 64 && (byte & 0x40)) {
+      val |= -(static_cast<int64_t>(1) << shift); // sign extend
+    }
+    return val;
+  }
+
+  const char *cstr() {
+    const char *str = reinterpret_cast<const char *>(_data + _pos);
+    const void *nul = memchr(str, '\0', _end - _pos);
+    if (!nul) {
+      _error = true;
+      return "";
+    }
+    _pos = static_cast<const uint8_t *>(nul) - _data + 1;
+    return str;
+  }
+
+  // Read a pointer with the given encoding
+  uint64_t encoded(uint8_t encoding) {
+    if (encoding == k_pe_omit) {
+      return 0;
+    }
+    ElfAddress_t field_addr = _section_addr + _pos;
+    uint64_t val = 0;
+    switch (encoding & k_pe_format_mask) {
+    case kPeAbsptr:
+    case kPeUdata8:
+    case kPeSdata8:
+      val = read<uint64_t>();
+      break;
+    case kPeUleb128:
+      val = uleb();
+      break;
+    case kPeUdata2:
+      val = read<uint16_t>();
+      break;
+    case kPeUdata4:
+      val = read<uint32_t>();
+      break;
+    case kPeSleb128:
+      val = sleb();
+      break;
+    case kPeSdata2:
+      val = static_cast<int64_t>(read<int16_t>());
+      break;
+    case kPeSdata4:
+      val = static_cast<int64_t>(read<int32_t>());
+      break;
+    default:
+      _error = true;
+      return 0;
+    }
+    switch (encoding & k_pe_application_mask) {
+    case kPeAbs:
+      break;
+    case kPePcrel:
+      val += field_addr;
+      break;
+    default:
+      // text / data relative pointers are not used in .eh_frame on x86_64
+      _error = true;
+      return 0;
+    }
+    if (encoding & k_pe_indirect) {
+      _error = true; // would require reading the process memory
+    }
+    return val;
+  }
+
+  void skip(uint64_t len) {
+    if (check(len)) {
+      _pos += len;
+    }
+  }
+
+  bool check(uint64_t len) {
+    if (_error || len > _end - _pos) {
+      _error = true;
+      return false;
+    }
+    return true;
+  }
+
+  const uint8_t *_data;
+  size_t _pos;
+  size_t _end; // can be restricted to the current entry
+  ElfAddress_t _section_addr;
+  bool _error;
+};
+
+struct RegState {
+  cfi::RegRule rule;
+  int64_t offset;
+  bool unknown; // rule we can not represent
+};
+
+struct CfiState {
+  uint64_t cfa_reg;
+  int64_t cfa_offset;
+  bool cfa_unknown;
+  RegState rbp;
+  RegState ra;
+};
+
+struct Cie {
+  uint64_t code_align;
+  int64_t data_align;
+  uint64_t ra_reg;
+  uint8_t fde_encoding;
+  bool has_augmentation_data;
+  size_t instructions;     // offset of the initial instructions
+  size_t instructions_end; // end of the CIE
+};
+
+// Row with an absolute address, before the table is compacted
+struct RawRow {
+  ElfAddress_t addr;
+  CfiRow row;
+};
+
+bool parse_cie(CfiReader &reader, size_t entry_end, Cie &cie) {
+  uint8_t version = reader.read<uint8_t>();
+  if (version != 1 && version != 3) {
+    return false;
+  }
+  const char *augmentation = reader.cstr();
+  if (strstr(augmentation, "eh")) {
+    return false; // legacy GCC format
+  }
+  cie.code_align = reader.uleb();
+  cie.data_align = reader.sleb();
+  cie.ra_reg = version == 1 ? reader.read<uint8_t>() : reader.uleb();
+  cie.fde_encoding = kPeAbsptr;
+  cie.has_augmentation_data = augmentation[0] == 'z';
+  if (cie.has_augmentation_data) {
+    uint64_t len = reader.uleb();
+    if (!reader.check(len)) {
+      return false;
+    }
+    size_t data_end = reader._pos + len;
+    // Unknown augmentations are skipped thanks to the data length
+    for (const char *c = augmentation + 1; *c && reader._pos < data_end; ++c) {
+      if (*c == 'R') {
+        cie.fde_encoding = reader.read<uint8_t>();
+      } else if (*c == 'P') {
+        uint8_t personality_encoding = reader.read<uint8_t>();
+        reader.encoded(personality_encoding & ~k_pe_indirect);
+      } else if (*c == 'L') {
+        reader.read<uint8_t>();
+      } else if (*c != 'S' && *c != 'B') {
+        break;
+      }
+    }
+    reader._pos = data_end;
+  }
+  cie.instructions = reader._pos;
+  cie.instructions_end = entry_end;
+  return !reader._error;
+}
+
+void set_reg(CfiState &state, const Cie &cie, uint64_t reg, cfi::RegRule rule,
+             int64_t offset, bool unknown = false) {
+  RegState *reg_state = nullptr;
+  if (reg == k_dwarf_rbp) {
+    reg_state = &state.rbp;
+  } else if (reg == cie.ra_reg) {
+    reg_state = &state.ra;
+  } else {
+    return; // other registers are not needed to unwind
+  }
+  reg_state->rule = rule;
+  reg_state->offset = offset;
+  reg_state->unknown = unknown;
+}
+
+void restore_reg(CfiState &state, const CfiState &initial, const Cie &cie,
+                 uint64_t reg) {
+  if (reg == k_dwarf_rbp) {
+    state.rbp = initial.rbp;
+  } else if (reg == cie.ra_reg) {
+    state.ra = initial.ra;
+  }
+}
+
+bool fits_int16(int64_t val) {
+  return val >= std::numeric_limits<int16_t>::min() &&
+      val <= std::numeric_limits<int16_t>::max();
+}
+
+CfiRow make_row(const CfiState &state) {
+  CfiRow row = {};
+  row.cfa_rule = state.cfa_reg == k_dwarf_rsp ? cfi::kCfaRsp
+      : state.cfa_reg == k_dwarf_rbp          ? cfi::kCfaRbp
+                                              : cfi::kCfaUnknown;
+  row.cfa_offset = static_cast<int32_t>(state.cfa_offset);
+  row.rbp_rule = state.rbp.rule;
+  row.rbp_offset = static_cast<int16_t>(state.rbp.offset);
+  row.ra_rule = state.ra.rule;
+  row.ra_offset = static_cast<int16_t>(state.ra.offset);
+  // The return address can not keep its value in the caller
+  if (state.cfa_unknown || state.rbp.unknown || state.ra.unknown ||
+      state.cfa_offset != row.cfa_offset || !fits_int16(state.rbp.offset) ||
+      !fits_int16(state.ra.offset) || state.ra.rule == cfi::kRegSame) {
+    row.cfa_rule = cfi::kCfaUnknown;
+  }
+  return row;
+}
+
+bool same_rules(const CfiRow &lhs, const CfiRow &rhs) {
+  return lhs.cfa_rule == rhs.cfa_rule && lhs.cfa_offset == rhs.cfa_offset &&
+      lhs.rbp_rule == rhs.rbp_rule && lhs.rbp_offset == rhs.rbp_offset &&
+      lhs.ra_rule == rhs.ra_rule && lhs.ra_offset == rhs.ra_offset;
+}
+
+// Run call frame instructions starting at *loc. A row is emitted each time
+// the location advances, *loc is then the start of the current row.
+// rows is null for the initial instructions of CIEs.
+bool run_program(CfiReader &reader, size_t end, const Cie &cie,
+                 const CfiState &initial, CfiState &state, ElfAddress_t *loc,
+                 std::vector<RawRow> *rows) {
+  std::vector<CfiState> remembered;
+  auto advance_to = [&](ElfAddress_t new_loc) {
+    if (!rows || new_loc < *loc) {
+      return false;
+    }
+    if (new_loc != *loc) {
+      rows->push_back({*loc, make_row(state)});
+      *loc = new_loc;
+    }
+    return true;
+  };
+  auto advance = [&](uint64_t delta) {
+    return advance_to(*loc + delta * cie.code_align);
+  };
+
+  while (reader._pos < end && !reader._error) {
+    uint8_t op = reader.read<uint8_t>();
+    uint8_t operand = op & 0x3f;
+    switch (op & 0xc0) {
+    case kCfaAdvanceLoc:
+      if (!advance(operand)) {
+        return false;
+      }
+      continue;
+    case kCfaOffset:
+      set_reg(state, cie, operand, cfi::kRegOffset,
+              static_cast<int64_t>(reader.uleb()) * cie.data_align);
+      continue;
+    case kCfaRestore:
+      restore_reg(state, initial, cie, operand);
+      continue;
+    default:
+      break;
+    }
+    bool ok = true;
+    switch (op) {
+    case kCfaNop:
+      break;
+    case kCfaSetLoc:
+      ok = advance_to(reader.encoded(cie.fde_encoding));
+      break;
+    case kCfaAdvanceLoc1:
+      ok = advance(reader.read<uint8_t>());
+      break;
+    case kCfaAdvanceLoc2:
+      ok = advance(reader.read<uint16_t>());
+      break;
+    case kCfaAdvanceLoc4:
+      ok = advance(reader.read<uint32_t>());
+      break;
+    case kCfaOffsetExtended: {
+      uint64_t reg = reader.uleb();
+      set_reg(state, cie, reg, cfi::kRegOffset,
+              static_cast<int64_t>(reader.uleb()) * cie.data_align);
+      break;
+    }
+    case kCfaOffsetExtendedSf: {
+      uint64_t reg = reader.uleb();
+      set_reg(state, cie, reg, cfi::kRegOffset,
+              reader.sleb() * cie.data_align);
+      break;
+    }
+    case kCfaGnuNegativeOffsetExtended: {
+      uint64_t reg = reader.uleb();
+      set_reg(state, cie, reg, cfi::kRegOffset,
+              -static_cast<int64_t>(reader.uleb()) * cie.data_align);
+      break;
+    }
+    case kCfaRestoreExtended:
+      restore_reg(state, initial, cie, reader.uleb());
+      break;
+    case kCfaUndefined:
+      set_reg(state, cie, reader.uleb(), cfi::kRegUndef, 0);
+      break;
+    case kCfaSameValue:
+      set_reg(state, cie, reader.uleb(), cfi::kRegSame, 0);
+      break;
+    case kCfaRegister: {
+      uint64_t reg = reader.uleb();
+      reader.uleb();
+      set_reg(state, cie, reg, cfi::kRegSame, 0, true);
+      break;
+    }
+    case kCfaValOffset:
+    case kCfaValOffsetSf: {
+      uint64_t reg = reader.uleb();
+      if (op == kCfaValOffset) {
+        reader.uleb();
+      } else {
+        reader.sleb();
+      }
+      set_reg(state, cie, reg, cfi::kRegSame, 0, true);
+      break;
+    }
+    case kCfaExpression:
+    case kCfaValExpression: {
+      uint64_t reg = reader.uleb();
+      reader.skip(reader.uleb());
+      set_reg(state, cie, reg, cfi::kRegSame, 0, true);
+      break;
+    }
+    case kCfaRememberState:
+      remembered.push_back(state);
+      break;
+    case kCfaRestoreState:
+      if (remembered.empty()) {
+        return false;
+      }
+      state = remembered.back();
+      remembered.pop_back();
+      break;
+    case kCfaDefCfa:
+      state.cfa_reg = reader.uleb();
+      state.cfa_offset = static_cast<int64_t>(reader.uleb());
+      state.cfa_unknown = false;
+      break;
+    case kCfaDefCfaSf:
+      state.cfa_reg = reader.uleb();
+      state.cfa_offset = reader.sleb() * cie.data_align;
+      state.cfa_unknown = false;
+      break;
+    case kCfaDefCfaRegister:
+      state.cfa_reg = reader.uleb();
+      break;
+    case kCfaDefCfaOffset:
+      state.cfa_offset = static_cast<int64_t>(reader.uleb());
+      break;
+    case kCfaDefCfaOffsetSf:
+      state.cfa_offset = reader.sleb() * cie.data_align;
+      break;
+    case kCfaDefCfaExpression:
+      reader.skip(reader.uleb());
+      state.cfa_unknown = true;
+      break;
+    case kCfaGnuArgsSize:
+      reader.uleb();
+      break;
+    default:
+      ok = false;
+      break;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return !reader._error;
+}
+
+bool parse_fde(CfiReader &reader, size_t entry_end, const Cie &cie,
+               std::vector<RawRow> &raw_rows) {
+  ElfAddress_t pc_begin = reader.encoded(cie.fde_encoding);
+  // the range is a size : only the format of the encoding applies
+  uint64_t pc_range = reader.encoded(cie.fde_encoding & k_pe_format_mask);
+  if (cie.has_augmentation_data) {
+    reader.skip(reader.uleb());
+  }
+  if (reader._error || pc_range == 0) {
+    return false;
+  }
+
+  CfiState initial = {};
+  initial.ra.rule = cfi::kRegSame;
+  CfiReader cie_reader(reader._data, cie.instructions_end,
+                       reader._section_addr);
+  cie_reader._pos = cie.instructions;
+  ElfAddress_t loc = pc_begin;
+  if (!run_program(cie_reader, cie.instructions_end, cie, initial, initial,
+                   &loc, nullptr)) {
+    return false;
+  }
+  CfiState state = initial;
+  if (!run_program(reader, entry_end, cie, initial, state, &loc, &raw_rows)) {
+    return false;
+  }
+  ElfAddress_t pc_end = pc_begin + pc_range;
+  if (loc < pc_end) {
+    raw_rows.push_back({loc, make_row(state)});
+  }
+  // Marks the end of the function (overridden by a following function)
+  CfiRow end_row = {};
+  end_row.cfa_rule = cfi::kCfaUndef;
+  raw_rows.push_back({pc_end, end_row});
+  return true;
+}
+
+} // namespace
+
+bool CfiTable::parse_eh_frame(const uint8_t *data, size_t size,
+                              ElfAddress_t section_addr) {
+  CfiReader reader(data, size, section_addr);
+  std::unordered_map<size_t, Cie> cies;
+  std::vector<RawRow> raw_rows;
+
+  while (reader._pos < size) {
+    reader._end = size;
+    reader._error = false;
+    size_t entry_pos = reader._pos;
+    uint64_t length = reader.read<uint32_t>();
+    if (length == 0) {
+      break; // terminator
+    }
+    if (length == 0xffffffff) {
+      length = reader.read<uint64_t>();
+    }
+    size_t id_pos = reader._pos;
+    if (!reader.check(length)) {
+      break;
+    }
+    size_t entry_end = id_pos + length;
+    reader._end = entry_end;
+    uint32_t id = reader.read<uint32_t>();
+    if (id == 0) {
+      Cie cie;
+      if (parse_cie(reader, entry_end, cie)) {
+        cies[entry_pos] = cie;
+      }
+    } else {
+      // FDE : the id is the offset back to its CIE
+      auto it = cies.find(id_pos - id);
+      size_t nb_rows = raw_rows.size();
+      if (it == cies.end() ||
+          !parse_fde(reader, entry_end, it->second, raw_rows)) {
+        raw_rows.resize(nb_rows);
+      }
+    }
+    reader._pos = entry_end;
+  }
+  if (raw_rows.empty()) {
+    return false;
+  }
+
+  // Functions ending where another one starts : keep the function's row
+  std::stable_sort(raw_rows.begin(), raw_rows.end(),
+                   [](const RawRow &lhs, const RawRow &rhs) {
+                     if (lhs.addr != rhs.addr) {
+                       return lhs.addr < rhs.addr;
+                     }
+                     return lhs.row.cfa_rule != cfi::kCfaUndef &&
+                         rhs.row.cfa_rule == cfi::kCfaUndef;
+                   });
+  _base = raw_rows.front().addr;
+  if (raw_rows.back().addr - _base > std::numeric_limits<uint32_t>::max()) {
+    LG_WRN("[CFI] Table spans more than 4GB");
+    return false;
+  }
+  _rows.clear();
+  _rows.reserve(raw_rows.size());
+  ElfAddress_t prev_addr = 0;
+  for (const RawRow &raw_row : raw_rows) {
+    // first row wins for a given address, identical rows are merged
+    bool skip = !_rows.empty() &&
+        (raw_row.addr == prev_addr || same_rules(_rows.back(), raw_row.row));
+    prev_addr = raw_row.addr;
+    if (skip) {
+      continue;
+    }
+    CfiRow row = raw_row.row;
+    row.start = static_cast<uint32_t>(raw_row.addr - _base);
+    _rows.push_back(row);
+  }
+  _rows.shrink_to_fit();
+  return true;
+}
+
+void CfiTable::add_segment(Offset_t offset, ElfAddress_t addr, uint64_t size) {
+  _segments.push_back({offset, addr, size});
+}
+
+bool CfiTable::offset_to_addr(Offset_t offset, ElfAddress_t *addr) const {
+  for (const Segment &segment : _segments) {
+    if (offset >= segment.offset && offset < segment.offset + segment.size) {
+      *addr = offset - segment.offset + segment.addr;
+      return true;
+    }
+  }
+  return false;
+}
+
+const CfiRow *CfiTable::find(ElfAddress_t addr) const {
+  if (_rows.empty() || addr < _base ||
+      addr - _base > std::numeric_limits<uint32_t>::max()) {
+    return nullptr;
+  }
+  uint32_t start = static_cast<uint32_t>(addr - _base);
+  auto it = std::upper_bound(
+      _rows.begin(), _rows.end(), start,
+      [](uint32_t val, const CfiRow &row) { return val < row.start; });
+  if (it == _rows.begin()) {
+    return nullptr;
+  }
+  --it;
+  return it->cfa_rule == cfi::kCfaUndef ? nullptr : &*it;
+}
+
+bool CfiTable::load(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    LG_DBG("[CFI] Unable to open %s", path.c_str());
+    return false;
+  }
+  defer { close(fd); };
+  Elf *elf = elf_begin(fd, ELF_C_READ_MMAP, nullptr);
+  if (!elf) {
+    LG_DBG("[CFI] Invalid elf %s", path.c_str());
+    return false;
+  }
+  defer { elf_end(elf); };
+  return load(elf);
+}
+
+bool CfiTable::load(Elf *elf) {
+  size_t nb_phdr;
+  if (elf_getphdrnum(elf, &nb_phdr) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < nb_phdr; ++i) {
+    GElf_Phdr phdr;
+    if (gelf_getphdr(elf, i, &phdr) && phdr.p_type == PT_LOAD &&
+        (phdr.p_flags & PF_X)) {
+      add_segment(phdr.p_offset, phdr.p_vaddr, phdr.p_filesz);
+    }
+  }
+
+  size_t shstrndx;
+  if (elf_getshdrstrndx(elf, &shstrndx) != 0) {
+    return false;
+  }
+  Elf_Scn *scn = nullptr;
+  while ((scn = elf_nextscn(elf, scn)) != nullptr) {
+    GElf_Shdr shdr;
+    if (!gelf_getshdr(scn, &shdr) || shdr.sh_type != SHT_PROGBITS) {
+      continue;
+    }
+    const char *name = elf_strptr(elf, shstrndx, shdr.sh_name);
+    if (!name || strcmp(name, ".eh_frame") != 0) {
+      continue;
+    }
+    Elf_Data *data = elf_getdata(scn, nullptr);
+    if (!data || !data->d_buf) {
+      return false;
+    }
+    return parse_eh_frame(static_cast<const uint8_t *>(data->d_buf),
+                          data->d_size, shdr.sh_addr);
+  }
+  LG_DBG("[CFI] No .eh_frame section");
+  return false;
+}
+
+cfi::StepResult cfi_step(const CfiRow &row, const UnwindRegisters &regs,
+                         UnwindRegisters *caller, CfiReadFun read, void *arg) {
+  ProcessAddress_t cfa;
+  switch (row.cfa_rule) {
+  case cfi::kCfaRsp:
+    cfa = regs.esp + row.cfa_offset;
+    break;
+  case cfi::kCfaRbp:
+    cfa = regs.ebp + row.cfa_offset;
+    break;
+  default:
+    return cfi::kStepError;
+  }
+  if (row.ra_rule == cfi::kRegUndef) {
+    return cfi::kStepEnd;
+  }
+  ElfWord_t ra;
+  if (!read(cfa + row.ra_offset, &ra, arg)) {
+    return cfi::kStepError;
+  }
+  ElfWord_t rbp = regs.ebp;
+  if (row.rbp_rule == cfi::kRegOffset &&
+      !read(cfa + row.rbp_offset, &rbp, arg)) {
+    return cfi::kStepError;
+  }
+  if (ra == 0) {
+    return cfi::kStepEnd;
+  }
+  // The stack grows down : the caller's frame is above
+  if (cfa <= regs.esp) {
+    return cfi::kStepError;
+  }
+  caller->ebp = rbp;
+  caller->esp = cfa;
+  caller->eip = ra;
+  return cfi::kStepOk;
+}
+
+bool CfiTableHdr::find(FileInfoId_t file_info_id,
+                       const CfiTable **table) const {
+  auto it = _tables.find(file_info_id);
+  if (it == _tables.end()) {
+    return false;
+  }
+  *table = it->second.get();
+  return true;
+}
+
+const CfiTable *CfiTableHdr::get_or_insert(FileInfoId_t file_info_id,
+                                           Elf *elf) {
+  auto it = _tables.find(file_info_id);
+  if (it != _tables.end()) {
+    return it->second.get();
+  }
+  std::unique_ptr<CfiTable> table(new CfiTable());
+  if (!elf || !table->load(elf)) {
+    LG_DBG("[CFI] No unwind table for file %d", file_info_id);
+    table.reset();
+  }
+  const CfiTable *result = table.get();
+  _tables.emplace(file_info_id, std::move(table));
+  return result;
+}
+
+} // namespace ddprof
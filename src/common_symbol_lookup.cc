@@ -7,15 +7,18 @@
 
 namespace ddprof {
 
-Symbol symbol_from_common(SymbolErrors lookup_case) {
+Symbol symbol_from_common(SymbolErrors lookup_case,
+                          SymbolTable &symbol_table) {
   switch (lookup_case) {
   case SymbolErrors::truncated_stack:
-    return Symbol(std::string(), std::string("[truncated]"), 0, std::string());
+    return Symbol(InternedString(), symbol_table.intern("[truncated]"), 0,
+                  InternedString());
   case SymbolErrors::unknown_dso:
-    return Symbol(std::string(), std::string("[unknown_dso]"), 0,
-                  std::string());
+    return Symbol(InternedString(), symbol_table.intern("[unknown_dso]"), 0,
+                  InternedString());
   case SymbolErrors::dwfl_frame:
-    return Symbol(std::string(), std::string("[dwfl_frame]"), 0, std::string());
+    return Symbol(InternedString(), symbol_table.intern("[dwfl_frame]"), 0,
+                  InternedString());
 
   default:
     break;
@@ -31,7 +34,7 @@ SymbolIdx_t CommonSymbolLookup::get_or_insert(SymbolErrors lookup_case,
     symbol_idx = it->second;
   } else { // insert things
     symbol_idx = symbol_table.size();
-    symbol_table.push_back(symbol_from_common(lookup_case));
+    symbol_table.push_back(symbol_from_common(lookup_case, symbol_table));
     _map.insert(std::pair<SymbolErrors, SymbolIdx_t>(lookup_case, symbol_idx));
   }
   return symbol_idx;
@@ -10,6 +10,7 @@
 #include "ddprof_input.h"
 #include "logger.h"
 #include "logger_setup.h"
+#include "perf.h"
 
 #include <sys/sysinfo.h>
 
@@ -88,6 +89,82 @@ DDRes ddprof_context_set(DDProfInput *input, DDProfContext *ctx) {
 
   ctx->params.num_cpu = get_nprocs();
 
+  // Process the number of threads draining ring buffers (at most one per CPU)
+  ctx->params.worker_threads = 1;
+  if (input->worker_threads) {
+    char *ptr_threads = input->worker_threads;
+    int tmp_threads = strtol(input->worker_threads, &ptr_threads, 10);
+    if (ptr_threads != input->worker_threads && tmp_threads > 0)
+      ctx->params.worker_threads = tmp_threads;
+  }
+  if (ctx->params.worker_threads > ctx->params.num_cpu)
+    ctx->params.worker_threads = ctx->params.num_cpu;
+
+  // Process the size of the queue between the reader and the unwinder
+  ctx->params.sample_queue_mb = 0;
+  if (input->sample_queue_mb) {
+    char *ptr_queue = input->sample_queue_mb;
+    int tmp_queue = strtol(input->sample_queue_mb, &ptr_queue, 10);
+    if (ptr_queue != input->sample_queue_mb && tmp_queue > 0)
+      ctx->params.sample_queue_mb = tmp_queue;
+  }
+  if (ctx->params.sample_queue_mb && ctx->params.worker_threads > 1) {
+    LG_WRN("[INPUT] Ignoring sample queue as several worker threads are used");
+    ctx->params.sample_queue_mb = 0;
+  }
+
+  // Process the size of the ring buffers (rounded up to a power of 2 pages)
+  ctx->params.buf_size_shift = DEFAULT_BUFF_SIZE_SHIFT;
+  if (input->buffer_pages) {
+    char *ptr_pages = input->buffer_pages;
+    long tmp_pages = strtol(input->buffer_pages, &ptr_pages, 10);
+    if (ptr_pages != input->buffer_pages && tmp_pages > 0) {
+      int shift = MIN_BUFF_SIZE_SHIFT;
+      while (shift < MAX_BUFF_SIZE_SHIFT && (1L << shift) < tmp_pages)
+        ++shift;
+      ctx->params.buf_size_shift = shift;
+    }
+  }
+  // Process adaptive buffer sizing (default no)
+  ctx->params.adaptive_buffer = arg_yesno(input->adaptive_buffer, 1);
+
+  // Process the wakeup watermark (percentage of the ring buffers)
+  ctx->params.wakeup_watermark_pct = 0;
+  if (input->wakeup_watermark) {
+    char *ptr_wm = input->wakeup_watermark;
+    long tmp_wm = strtol(input->wakeup_watermark, &ptr_wm, 10);
+    if (ptr_wm != input->wakeup_watermark && tmp_wm > 0)
+      ctx->params.wakeup_watermark_pct = tmp_wm < 100 ? tmp_wm : 100;
+  }
+
+  // Process frame pointer unwinding (default no)
+  ctx->params.unwind_fp = arg_yesno(input->unwind_fp, 1);
+  if (input->unwind_fp_exclude && *input->unwind_fp_exclude) {
+    ctx->params.unwind_fp_exclude = strdup(input->unwind_fp_exclude);
+    if (!ctx->params.unwind_fp_exclude) {
+      DDRES_RETURN_ERROR_LOG(DD_WHAT_BADALLOC,
+                             "Unable to allocate string for unwind_fp_exclude");
+    }
+  }
+
+  // Process unwind tables (default no)
+  ctx->params.unwind_tables = arg_yesno(input->unwind_tables, 1);
+
+  // Process eager symbol tables (default no)
+  ctx->params.eager_symbols = arg_yesno(input->eager_symbols, 1);
+
+  // Process source line information (default yes)
+  ctx->params.line_info = !arg_yesno(input->line_info, 0);
+
+  // Process the symbol cache directory (default none)
+  if (input->symbol_cache_dir && *input->symbol_cache_dir) {
+    ctx->params.symbol_cache_dir = strdup(input->symbol_cache_dir);
+    if (!ctx->params.symbol_cache_dir) {
+      DDRES_RETURN_ERROR_LOG(DD_WHAT_BADALLOC,
+                             "Unable to allocate string for symbol_cache_dir");
+    }
+  }
+
   // Adjust target PID
   pid_t pid_tmp = 0;
   if (input->pid && (pid_tmp = strtol(input->pid, NULL, 10)))
@@ -209,6 +286,8 @@ void ddprof_context_free(DDProfContext *ctx) {
     exporter_input_free(&ctx->exp_input);
     free((char *)ctx->params.internal_stats);
     free((char *)ctx->params.tags);
+    free((char *)ctx->params.unwind_fp_exclude);
+    free((char *)ctx->params.symbol_cache_dir);
     memset(ctx, 0, sizeof(*ctx)); // also sets ctx->initialized = false;
   }
 }
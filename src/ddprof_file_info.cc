@@ -12,4 +12,8 @@ bool FileInfoInodeKey::operator==(const FileInfoInodeKey &o) const {
   return _inode == o._inode && _offset == o._offset && _sz == o._sz;
 }
 
+bool FileInfoBuildIdKey::operator==(const FileInfoBuildIdKey &o) const {
+  return _build_id == o._build_id && _offset == o._offset && _sz == o._sz;
+}
+
 } // namespace ddprof
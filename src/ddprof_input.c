@@ -135,6 +135,57 @@ char* help_str[DD_KLEN] = {
   [DD_PROFILING_INTERNAL_STATS] = 
   "    Enables statsd metrics for "MYNAME". Value should point to a statsd socket.\n"
   "    Example: /var/run/datadog-agent/statsd.sock\n",
+  [DD_PROFILING_NATIVE_WORKER_THREADS] =
+"    Number of threads draining the perf ring buffers.  Each thread handles a\n"
+"    subset of the CPUs with its own unwinding caches.  Useful in global mode\n"
+"    on hosts with many cores.  Capped to the number of CPUs (default: 1).\n",
+  [DD_PROFILING_NATIVE_SAMPLE_QUEUE_MB] =
+"    Size (in MB) of an in-process queue between the ring buffer reader and the\n"
+"    unwinder.  Samples are copied to the queue and unwound from a separate\n"
+"    thread, which frees the kernel buffers during bursts.  Disabled by default\n"
+"    and not compatible with several worker threads.\n",
+  [DD_PROFILING_NATIVE_BUFFER_PAGES] =
+"    Number of pages of each perf ring buffer (one per CPU and per watcher).\n"
+"    Rounded up to a power of 2, between 16 and 4096 (default: 64).  Larger\n"
+"    buffers use more locked memory but reduce lost events during bursts.\n",
+  [DD_PROFILING_NATIVE_ADAPTIVE_BUFFER] =
+"    Whether to resize the perf ring buffers when the worker is refreshed.\n"
+"    Buffers grow when events were lost and shrink back (down to the\n"
+"    configured number of pages) when they stay mostly empty (default: no).\n",
+  [DD_PROFILING_NATIVE_WAKEUP_WATERMARK] =
+"    Percentage of a ring buffer that has to be filled before the worker is\n"
+"    woken up, instead of waking up on every event.  Perf events are then\n"
+"    watched through a persistent epoll set.  Buffers are still drained every\n"
+"    100ms.  Useful with high sampling rates or many CPUs (example: 25).\n",
+  [DD_PROFILING_NATIVE_UNWIND_FP] =
+"    Whether to unwind by following frame pointers, which is much cheaper for\n"
+"    code built with -fno-omit-frame-pointer.  DWARF unwinding takes over\n"
+"    when the frame chain leaves the captured stack or reaches a library\n"
+"    built without frame pointers (default: no).\n",
+  [DD_PROFILING_NATIVE_UNWIND_FP_EXCLUDE] =
+"    Comma separated list of libraries or executables (paths, or parts of\n"
+"    them) built without frame pointers.  Frames in these files are always\n"
+"    unwound with DWARF (example: libc.so,libstdc++).\n",
+  [DD_PROFILING_NATIVE_UNWIND_TABLES] =
+"    Whether to unwind with compact tables built once per binary from its\n"
+"    .eh_frame section, instead of evaluating DWARF rules for every frame.\n"
+"    Frames using rules the tables can not express are unwound with\n"
+"    libdwfl (default: no).\n",
+  [DD_PROFILING_NATIVE_SYMBOL_CACHE_DIR] =
+"    Directory where the symbols of binaries are persisted, one file per\n"
+"    build-id and file size.  Workers load the symbols resolved by previous\n"
+"    workers instead of resolving them again after each restart.  The\n"
+"    directory can be shared by several profilers (default: none).\n",
+  [DD_PROFILING_NATIVE_EAGER_SYMBOLS] =
+"    Whether to load the function symbols of a binary at once, the first\n"
+"    time it is symbolized, instead of resolving addresses one at a time\n"
+"    through libdwfl.  Line numbers are not resolved in this mode\n"
+"    (default: no).\n",
+  [DD_PROFILING_NATIVE_LINE_INFO] =
+"    Whether to resolve the source file and line of symbols.  Reading line\n"
+"    tables is often the most expensive part of symbolization for binaries\n"
+"    with full debug information.  When disabled, the file of the mapping\n"
+"    is reported instead (default: yes).\n",
 };
 // clang-format on
 
@@ -8,6 +8,7 @@ extern "C" {
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <sys/time.h>
 #include <time.h>
 #include <x86intrin.h>
@@ -16,6 +17,7 @@ extern "C" {
 #include "ddprof_stats.h"
 #include "logger.h"
 #include "perf.h"
+#include "perf_ringbuffer.h"
 #include "pevent_lib.h"
 #include "pprof/ddprof_pprof.h"
 #include "procutils.h"
@@ -27,9 +29,13 @@ extern "C" {
 #include "exporter/ddprof_exporter.h"
 #include "tags.hpp"
 #include "unwind.hpp"
+#include "unwind_fp.hpp"
+#include "unwind_pipeline.hpp"
 #include "unwind_state.hpp"
+#include "worker_shard.hpp"
 
 #include <cassert>
+#include <unordered_set>
 
 #ifdef DBG_JEMALLOC
 #  include <jemalloc/jemalloc.h>
@@ -44,17 +50,54 @@ static const DDPROF_STATS s_cycled_stats[] = {STATS_UNWIND_TICKS,
                                               STATS_EVENT_LOST,
                                               STATS_SAMPLE_COUNT,
                                               STATS_DSO_UNHANDLED_SECTIONS,
-                                              STATS_CPU_TIME};
+                                              STATS_CPU_TIME,
+                                              STATS_SAMPLE_QUEUE_DROPS,
+                                              STATS_WORKER_WAITS,
+                                              STATS_WORKER_WAIT_TIMEOUTS,
+                                              STATS_RB_FILL_Q1,
+                                              STATS_RB_FILL_Q2,
+                                              STATS_RB_FILL_Q3,
+                                              STATS_RB_FILL_Q4};
 
 #define cycled_stats_sz (sizeof(s_cycled_stats) / sizeof(DDPROF_STATS))
 
 static const unsigned s_nb_samples_per_backpopulate = 200;
 
+// Adaptive ring buffers : a cycle is lossy when more than 1 event out of 1000
+// was lost, and busy when a ring buffer was filled above a quarter
+static const long s_lost_events_per_mille = 1;
+static const uint64_t s_busy_fill_ratio = 4;
+
+// Apply fun to every unwinding state of the worker
+template <typename Func>
+static void for_each_unwind_state(DDProfContext *ctx, Func fun) {
+  fun(ctx->worker_ctx.us);
+  WorkerShardPool *pool = ctx->worker_ctx.shard_pool;
+  if (pool) {
+    for (std::unique_ptr<WorkerShard> &shard : pool->_shards) {
+      fun(&shard->_us);
+    }
+  }
+}
+
+static void worker_configure_unwind(DDProfContext *ctx) {
+  for_each_unwind_state(ctx, [ctx](UnwindState *us) {
+    unwind_fp_config(us, ctx->params.unwind_fp,
+                     ctx->params.unwind_fp_exclude);
+    us->cfi_unwind = ctx->params.unwind_tables;
+    us->symbol_hdr._dwfl_symbol_lookup_v2.set_disk_cache_dir(
+        ctx->params.symbol_cache_dir);
+    us->symbol_hdr._dwfl_symbol_lookup_v2.set_eager_symbols(
+        ctx->params.eager_symbols);
+    us->symbol_hdr._dwfl_symbol_lookup_v2.set_line_info(ctx->params.line_info);
+  });
+}
+
 /// Human readable runtime information
-static void print_diagnostics(const DsoHdr &dso_hdr) {
+static void print_diagnostics(DDProfContext *ctx) {
   LG_PRINT("Printing internal diagnostics");
   ddprof_stats_print();
-  dso_hdr._stats.log();
+  for_each_unwind_state(ctx, [](UnwindState *us) { us->dso_hdr._stats.log(); });
 #ifdef DBG_JEMALLOC
   // jemalloc stats
   malloc_stats_print(NULL, NULL, "");
@@ -62,7 +105,8 @@ static void print_diagnostics(const DsoHdr &dso_hdr) {
 }
 
 static inline int64_t now_nanos() {
-  static struct timeval tv = {};
+  // not static : called from the shard threads
+  struct timeval tv = {};
   gettimeofday(&tv, NULL);
   return (tv.tv_sec * 1000000 + tv.tv_usec) * 1000;
 }
@@ -88,18 +132,31 @@ DDRes worker_library_init(DDProfContext *ctx) {
     ctx->worker_ctx.exp_tid = {0};
 
     ctx->worker_ctx.us = new UnwindState();
+    ctx->worker_ctx.shard_pool = nullptr;
+    ctx->worker_ctx.pipeline = nullptr;
 
     PEventHdr *pevent_hdr = &ctx->worker_ctx.pevent_hdr;
 
+    // Buffer size can be overriden by the previous worker (adaptive mode)
+    if (!ctx->worker_ctx.buf_size_shift) {
+      ctx->worker_ctx.buf_size_shift = ctx->params.buf_size_shift;
+    }
+    ctx->worker_ctx.buf_lossy_cycles = 0;
+    ctx->worker_ctx.buf_busy_cycles = 0;
+    int buf_size_shift = ctx->worker_ctx.buf_size_shift;
+
     // If we're here, then we are a child spawned during the startup operation.
     // That means we need to iterate through the perf_event_open() handles and
     // get the mmaps
-    if (!IsDDResOK(pevent_mmap(pevent_hdr, true))) {
+    if (!IsDDResOK(pevent_mmap(pevent_hdr, buf_size_shift, true,
+                               &ctx->worker_ctx.buf_size_shift))) {
       LG_NTC("Retrying attachment without user override");
-      DDRES_CHECK_FWD(pevent_mmap(pevent_hdr, false));
+      DDRES_CHECK_FWD(pevent_mmap(pevent_hdr, buf_size_shift, false,
+                                  &ctx->worker_ctx.buf_size_shift));
     }
     // Initialize the unwind state and library
     unwind_init();
+    worker_configure_unwind(ctx);
     ctx->worker_ctx.user_tags =
         new UserTags(ctx->params.tags, ctx->params.num_cpu);
 
@@ -115,6 +172,12 @@ DDRes worker_library_init(DDProfContext *ctx) {
 
 DDRes worker_library_free(DDProfContext *ctx) {
   try {
+    // Threads are joined before we release the ring buffers
+    delete ctx->worker_ctx.shard_pool;
+    ctx->worker_ctx.shard_pool = nullptr;
+    delete ctx->worker_ctx.pipeline;
+    ctx->worker_ctx.pipeline = nullptr;
+
     delete ctx->worker_ctx.user_tags;
     ctx->worker_ctx.user_tags = nullptr;
 
@@ -129,33 +192,65 @@ DDRes worker_library_free(DDProfContext *ctx) {
 }
 
 /// Retrieve cpu / memory info
-static DDRes worker_update_stats(ProcStatus *procstat, const DsoHdr *dso_hdr) {
+static DDRes worker_update_stats(DDProfContext *ctx) {
   // Update the procstats, but first snapshot the utime so we can compute the
   // diff for the utime metric
+  ProcStatus *procstat = &ctx->worker_ctx.proc_status;
   long utime_old = procstat->utime;
   DDRES_CHECK_FWD(proc_read(procstat));
 
   ddprof_stats_set(STATS_PROCFS_RSS, get_page_size() * procstat->rss);
   ddprof_stats_set(STATS_PROCFS_UTIME, procstat->utime - utime_old);
-  ddprof_stats_set(STATS_DSO_UNHANDLED_SECTIONS,
-                   dso_hdr->_stats.sum_event_metric(DsoStats::kUnhandledDso));
-  ddprof_stats_set(STATS_DSO_NEW_DSO,
-                   dso_hdr->_stats.sum_event_metric(DsoStats::kNewDso));
-  ddprof_stats_set(STATS_DSO_SIZE, dso_hdr->get_nb_dso());
-  ddprof_stats_set(STATS_DSO_MAPPED, dso_hdr->get_nb_mapped_dso());
+
+  // DSO and frame cache metrics are summed over shards
+  long unhandled_dso = 0, new_dso = 0, nb_dso = 0, nb_mapped_dso = 0;
+  long frame_cache_hits = 0, frame_cache_misses = 0;
+  // shards see the same processes : pids are counted once
+  std::unordered_set<pid_t> pids_live, pids_dead;
+  for_each_unwind_state(ctx, [&](UnwindState *us) {
+    const DsoHdr &dso_hdr = us->dso_hdr;
+    unhandled_dso += dso_hdr._stats.sum_event_metric(DsoStats::kUnhandledDso);
+    new_dso += dso_hdr._stats.sum_event_metric(DsoStats::kNewDso);
+    nb_dso += dso_hdr.get_nb_dso();
+    nb_mapped_dso += dso_hdr.get_nb_mapped_dso();
+    frame_cache_hits += us->frame_cache._stats._hits;
+    frame_cache_misses += us->frame_cache._stats._misses;
+    for (const auto &el : dso_hdr._map) {
+      if (!us->pid_lifecycle.is_exited(el.first)) {
+        pids_live.insert(el.first);
+      }
+    }
+    pids_dead.insert(us->pid_lifecycle._released.begin(),
+                     us->pid_lifecycle._released.end());
+  });
+  ddprof_stats_set(STATS_DSO_UNHANDLED_SECTIONS, unhandled_dso);
+  ddprof_stats_set(STATS_DSO_NEW_DSO, new_dso);
+  ddprof_stats_set(STATS_DSO_SIZE, nb_dso);
+  ddprof_stats_set(STATS_DSO_MAPPED, nb_mapped_dso);
+  ddprof_stats_set(STATS_PID_LIVE, pids_live.size());
+  ddprof_stats_set(STATS_PID_DEAD, pids_dead.size());
+  ddprof_stats_set(STATS_FRAME_CACHE_HITS, frame_cache_hits);
+  ddprof_stats_set(STATS_FRAME_CACHE_MISSES, frame_cache_misses);
+  if (ctx->worker_ctx.pipeline) {
+    ctx->worker_ctx.pipeline->cycle_stats();
+  }
   return ddres_init();
 }
 
 /************************* perf_event_open() helpers **************************/
 /// Entry point for sample aggregation
-DDRes ddprof_pr_sample(DDProfContext *ctx, perf_event_sample *sample, int pos) {
+/// When processed within a shard, the unwinding output is kept aside until the
+/// shards are joined.
+static DDRes ddprof_pr_sample(DDProfContext *ctx, UnwindState *us,
+                              WorkerShard *shard, perf_event_sample *sample,
+                              int pos) {
   // Before we do anything else, copy the perf_event_header into a sample
-  struct UnwindState *us = ctx->worker_ctx.us;
   ddprof_stats_add(STATS_SAMPLE_COUNT, 1, NULL);
 
   // copy the sample context into the unwind structure
   unwind_init_sample(us, sample->regs, sample->pid, sample->size_stack,
-                     sample->data_stack);
+                     sample->data_stack, sample->size_stack_head,
+                     sample->data_stack_wrap);
 
   // If this is a SW_TASK_CLOCK-type event, then aggregate the time
   if (ctx->watchers[pos].config == PERF_COUNT_SW_TASK_CLOCK)
@@ -165,22 +260,26 @@ DDRes ddprof_pr_sample(DDProfContext *ctx, perf_event_sample *sample, int pos) {
 
   // Aggregate if unwinding went well (todo : fatal error propagation)
   if (!IsDDResFatal(res)) {
+    if (shard) {
+      shard->push_sample(&us->output, sample->period, pos);
+    } else {
 #ifndef DDPROF_NATIVE_LIB
-    // in lib mode we don't aggregate (protect to avoid link failures)
-    int i_export = ctx->worker_ctx.i_current_pprof;
-    DDProfPProf *pprof = ctx->worker_ctx.pprof[i_export];
-    DDRES_CHECK_FWD(pprof_aggregate(&us->output, &us->symbol_hdr,
-                                    sample->period, pos, pprof));
+      // in lib mode we don't aggregate (protect to avoid link failures)
+      int i_export = ctx->worker_ctx.i_current_pprof;
+      DDProfPProf *pprof = ctx->worker_ctx.pprof[i_export];
+      DDRES_CHECK_FWD(pprof_aggregate(&us->output, &us->symbol_hdr,
+                                      sample->period, pos, pprof));
 #else
-    // Call the user's stack handler
-    if (ctx->stack_handler) {
-      if (!ctx->stack_handler->apply(&us->output, ctx,
-                                     ctx->stack_handler->callback_ctx, pos)) {
-        DDRES_RETURN_ERROR_LOG(DD_WHAT_STACK_HANDLE,
-                               "Stack handler returning errors");
+      // Call the user's stack handler
+      if (ctx->stack_handler) {
+        if (!ctx->stack_handler->apply(&us->output, ctx,
+                                       ctx->stack_handler->callback_ctx, pos)) {
+          DDRES_RETURN_ERROR_LOG(DD_WHAT_STACK_HANDLE,
+                                 "Stack handler returning errors");
+        }
       }
-    }
 #endif
+    }
   }
   DDRES_CHECK_FWD(ddprof_stats_add(STATS_UNWIND_TICKS,
                                    __rdtsc() - this_ticks_unwind, NULL));
@@ -188,6 +287,66 @@ DDRes ddprof_pr_sample(DDProfContext *ctx, perf_event_sample *sample, int pos) {
   return ddres_init();
 }
 
+// Fill levels of the ring buffers seen by the drain loop : summed over all
+// buffers in the stats, and logged per buffer
+static void worker_publish_buffer_fill(DDProfContext *ctx) {
+  uint64_t total[PEVENT_FILL_BUCKETS] = {};
+  PEventHdr *pevent_hdr = &ctx->worker_ctx.pevent_hdr;
+  for (size_t k = 0; k < pevent_hdr->size; ++k) {
+    const PEvent *pe = &pevent_hdr->pes[k];
+    if (!pe->rb.region) {
+      continue; // redirected to another ring buffer
+    }
+    for (int b = 0; b < PEVENT_FILL_BUCKETS; ++b) {
+      total[b] += pe->fill_hist[b];
+    }
+    LG_DBG("Ring buffer fill <%d> cpu %d: %u %u %u %u", pe->pos, pe->cpu,
+           pe->fill_hist[0], pe->fill_hist[1], pe->fill_hist[2],
+           pe->fill_hist[3]);
+  }
+  for (int b = 0; b < PEVENT_FILL_BUCKETS; ++b) {
+    ddprof_stats_set(STATS_RB_FILL_Q1 + b, total[b]);
+  }
+}
+
+/// Classify the cycle according to lost events and ring buffer usage
+static void worker_update_buffer_usage(DDProfContext *ctx) {
+  long lost = 0, events = 0;
+  ddprof_stats_get(STATS_EVENT_LOST, &lost);
+  ddprof_stats_get(STATS_EVENT_COUNT, &events);
+
+  bool busy = false;
+  PEventHdr *pevent_hdr = &ctx->worker_ctx.pevent_hdr;
+  for (size_t k = 0; k < pevent_hdr->size; ++k) {
+    PEvent *pe = &pevent_hdr->pes[k];
+    uint64_t data_size = pe->rb.size - pe->rb.meta_size;
+    if (pe->max_fill * s_busy_fill_ratio > data_size) {
+      busy = true;
+    }
+    pe->max_fill = 0;
+    memset(pe->fill_hist, 0, sizeof(pe->fill_hist));
+  }
+
+  if (lost * 1000 > events * s_lost_events_per_mille) {
+    ++ctx->worker_ctx.buf_lossy_cycles;
+  } else if (busy) {
+    ++ctx->worker_ctx.buf_busy_cycles;
+  }
+}
+
+int ddprof_worker_next_buf_size_shift(const DDProfContext *ctx) {
+  const DDProfWorkerContext &worker_ctx = ctx->worker_ctx;
+  // starts from the size that was mapped (smaller if the mapping failed)
+  int shift = pevent_next_buf_size_shift(
+      worker_ctx.buf_size_shift, ctx->params.buf_size_shift,
+      worker_ctx.buf_lossy_cycles, worker_ctx.buf_busy_cycles);
+  if (shift != worker_ctx.buf_size_shift) {
+    LG_NTC("Resizing ring buffers from %d to %d pages",
+           1 << worker_ctx.buf_size_shift, 1 << shift);
+  }
+  return shift;
+}
+
 static void ddprof_reset_worker_stats() {
   for (unsigned i = 0; i < cycled_stats_sz; ++i) {
     ddprof_stats_clear(s_cycled_stats[i]);
@@ -218,12 +377,22 @@ void *ddprof_worker_export_thread(void *arg) {
 DDRes ddprof_worker_cycle(DDProfContext *ctx, int64_t now,
                           bool synchronous_export) {
 
+  // The unwinder thread should not touch the profile or the caches from now on
+  if (ctx->worker_ctx.pipeline) {
+    DDRES_CHECK_FWD(ctx->worker_ctx.pipeline->quiesce());
+  }
+
+  // Pids released now are reported as dead in this cycle's stats
+  for_each_unwind_state(
+      ctx, [now](UnwindState *us) { unwind_release_exited(us, now); });
+
   // Scrape procfs for process usage statistics
-  DDRES_CHECK_FWD(worker_update_stats(&ctx->worker_ctx.proc_status,
-                                      &ctx->worker_ctx.us->dso_hdr));
+  DDRES_CHECK_FWD(worker_update_stats(ctx));
+
+  worker_publish_buffer_fill(ctx);
 
   // And emit diagnostic output (if it's enabled)
-  print_diagnostics(ctx->worker_ctx.us->dso_hdr);
+  print_diagnostics(ctx);
   if (IsDDResNotOK(ddprof_stats_send(ctx->params.internal_stats))) {
     LG_WRN("Unable to utilize to statsd socket.  Suppressing future stats.");
     free((void *)ctx->params.internal_stats);
@@ -275,7 +444,8 @@ DDRes ddprof_worker_cycle(DDProfContext *ctx, int64_t now,
   ctx->worker_ctx.count_worker += 1;
 
   // allow new backpopulates
-  ctx->worker_ctx.us->dso_hdr.reset_backpopulate_state();
+  for_each_unwind_state(
+      ctx, [](UnwindState *us) { us->dso_hdr.reset_backpopulate_state(); });
 
   // Update the time last sent
   ctx->worker_ctx.send_nanos += export_time_convert(ctx->params.upload_period);
@@ -288,7 +458,10 @@ DDRes ddprof_worker_cycle(DDProfContext *ctx, int64_t now,
     LG_WRN("Timer skew detected; frequent warnings may suggest system issue");
     export_time_set(ctx);
   }
-  unwind_cycle(ctx->worker_ctx.us);
+  for_each_unwind_state(ctx, [](UnwindState *us) { unwind_cycle(us); });
+
+  // Lost events are checked before the stats are reset
+  worker_update_buffer_usage(ctx);
 
   // Reset stats relevant to a single cycle
   ddprof_reset_worker_stats();
@@ -296,45 +469,48 @@ DDRes ddprof_worker_cycle(DDProfContext *ctx, int64_t now,
   return ddres_init();
 }
 
-void ddprof_pr_mmap(DDProfContext *ctx, perf_event_mmap *map, int pos) {
+static void ddprof_pr_mmap(UnwindState *us, perf_event_mmap *map, int pos) {
   if (!(map->header.misc & PERF_RECORD_MISC_MMAP_DATA)) {
     LG_DBG("<%d>(MAP)%d: %s (%lx/%lx/%lx)", pos, map->pid, map->filename,
            map->addr, map->len, map->pgoff);
     ddprof::Dso new_dso(map->pid, map->addr, map->addr + map->len - 1,
-                        map->pgoff, std::string(map->filename));
-    ctx->worker_ctx.us->dso_hdr.insert_erase_overlap(std::move(new_dso));
+                        map->pgoff,
+                        us->dso_hdr.intern_filename(map->filename));
+    us->dso_hdr.insert_erase_overlap(std::move(new_dso));
   }
 }
 
-void ddprof_pr_lost(DDProfContext *, perf_event_lost *lost, int) {
+static void ddprof_pr_lost(perf_event_lost *lost, int) {
   ddprof_stats_add(STATS_EVENT_LOST, lost->lost, NULL);
 }
 
-void ddprof_pr_comm(DDProfContext *ctx, perf_event_comm *comm, int pos) {
+static void ddprof_pr_comm(UnwindState *us, perf_event_comm *comm, int pos) {
   // Change in process name (assuming exec) : clear all associated dso
   if (comm->header.misc & PERF_RECORD_MISC_COMM_EXEC) {
     LG_DBG("<%d>(COMM)%d -> %s", pos, comm->pid, comm->comm);
-    unwind_pid_free(ctx->worker_ctx.us, comm->pid);
+    unwind_pid_free(us, comm->pid);
   }
 }
 
-void ddprof_pr_fork(DDProfContext *ctx, perf_event_fork *frk, int pos) {
+static void ddprof_pr_fork(UnwindState *us, perf_event_fork *frk, int pos) {
   LG_DBG("<%d>(FORK)%d -> %d/%d", pos, frk->ppid, frk->pid, frk->tid);
   if (frk->ppid != frk->pid) {
-    // Clear everything and populate at next error or with coming samples
-    unwind_pid_free(ctx->worker_ctx.us, frk->pid);
+    // The child starts with the mappings of its parent (procfs does not need
+    // to be parsed again), later mmap events update them
+    unwind_pid_fork(us, frk->ppid, frk->pid);
   }
 }
 
-void ddprof_pr_exit(DDProfContext *ctx, perf_event_exit *ext, int pos) {
+static void ddprof_pr_exit(UnwindState *us, perf_event_exit *ext, int pos) {
   // On Linux, it seems that the thread group leader is the one whose task ID
   // matches the process ID of the group.  Moreover, it seems that it is the
   // overwhelming convention that this thread is closed after the other threads
   // (upheld by both pthreads and runtimes).
-  // We do not clear the PID at this time because we currently cleanup anyway.
-  (void)ctx;
+  // Structures of the PID are released after a grace period, as samples of
+  // the process can still be in flight.
   if (ext->pid == ext->tid) {
     LG_DBG("<%d>(EXIT)%d", pos, ext->pid);
+    unwind_pid_exit(us, ext->pid, now_nanos());
   } else {
     LG_DBG("<%d>(EXIT)%d/%d", pos, ext->pid, ext->tid);
   }
@@ -393,6 +569,18 @@ DDRes ddprof_worker_init(DDProfContext *ctx) {
                                          ctx->watchers, ctx->num_watchers));
     DDRES_CHECK_FWD(pprof_create_profile(ctx->worker_ctx.pprof[1],
                                          ctx->watchers, ctx->num_watchers));
+    if (ctx->params.worker_threads > 1) {
+      // Ring buffers are mapped : distribute them between threads
+      ctx->worker_ctx.shard_pool =
+          new WorkerShardPool(ctx->params.worker_threads);
+      worker_configure_unwind(ctx);
+      DDRES_CHECK_FWD(
+          ctx->worker_ctx.shard_pool->start(&ctx->worker_ctx.pevent_hdr));
+    } else if (ctx->params.sample_queue_mb) {
+      ctx->worker_ctx.pipeline = new UnwindPipeline();
+      DDRES_CHECK_FWD(ctx->worker_ctx.pipeline->start(
+          ctx, static_cast<uint64_t>(ctx->params.sample_queue_mb) << 20));
+    }
   }
   CatchExcept2DDRes();
   return ddres_init();
@@ -439,52 +627,131 @@ struct perf_event_hdr_wpid : perf_event_header {
   uint32_t pid, tid;
 };
 
-DDRes ddprof_worker_process_event(struct perf_event_header *hdr, int pos,
-                                  DDProfContext *ctx) {
+// Only samples can wrap around the ring buffer (refer to rb_seek_view)
+static DDRes worker_process_event(const RecordView *view, int pos,
+                                  DDProfContext *ctx, WorkerShard *shard) {
   // global try catch to avoid leaking exceptions to main loop
   try {
+    struct perf_event_header *hdr = view->hdr;
+    UnwindState *us = shard ? &shard->_us : ctx->worker_ctx.us;
     ddprof_stats_add(STATS_EVENT_COUNT, 1, NULL);
     struct perf_event_hdr_wpid *wpid = static_cast<perf_event_hdr_wpid *>(hdr);
     switch (hdr->type) {
     /* Cases where the target type has a PID */
     case PERF_RECORD_SAMPLE:
       if (wpid->pid) {
-        perf_event_sample *sample = hdr2samp(hdr, DEFAULT_SAMPLE_TYPE);
-        DDRES_CHECK_FWD(ddprof_pr_sample(ctx, sample, pos));
+        perf_event_sample *sample = view2samp(view, DEFAULT_SAMPLE_TYPE);
+        DDRES_CHECK_FWD(ddprof_pr_sample(ctx, us, shard, sample, pos));
       }
       break;
     case PERF_RECORD_MMAP:
       if (wpid->pid)
-        ddprof_pr_mmap(ctx, (perf_event_mmap *)hdr, pos);
+        ddprof_pr_mmap(us, (perf_event_mmap *)hdr, pos);
       break;
     case PERF_RECORD_COMM:
       if (wpid->pid)
-        ddprof_pr_comm(ctx, (perf_event_comm *)hdr, pos);
+        ddprof_pr_comm(us, (perf_event_comm *)hdr, pos);
       break;
     case PERF_RECORD_EXIT:
       if (wpid->pid)
-        ddprof_pr_exit(ctx, (perf_event_exit *)hdr, pos);
+        ddprof_pr_exit(us, (perf_event_exit *)hdr, pos);
       break;
     case PERF_RECORD_FORK:
       if (wpid->pid)
-        ddprof_pr_fork(ctx, (perf_event_fork *)hdr, pos);
+        ddprof_pr_fork(us, (perf_event_fork *)hdr, pos);
       break;
 
     /* Cases where the target type might not have a PID */
     case PERF_RECORD_LOST:
-      ddprof_pr_lost(ctx, (perf_event_lost *)hdr, pos);
+      ddprof_pr_lost((perf_event_lost *)hdr, pos);
       break;
     default:
       break;
     }
 
+    // Other shards need to know about changes in the address space
+    if (shard && wpid->pid &&
+        (hdr->type == PERF_RECORD_MMAP || hdr->type == PERF_RECORD_COMM ||
+         hdr->type == PERF_RECORD_FORK ||
+         (hdr->type == PERF_RECORD_EXIT &&
+          ((perf_event_exit *)hdr)->pid == ((perf_event_exit *)hdr)->tid))) {
+      shard->push_sideband(hdr, pos);
+    }
+
     // backpopulate if needed
-    if (++ctx->worker_ctx.count_samples > s_nb_samples_per_backpopulate) {
+    uint32_t *count_samples =
+        shard ? &shard->_count_samples : &ctx->worker_ctx.count_samples;
+    if (++(*count_samples) > s_nb_samples_per_backpopulate) {
       // allow new backpopulates and reset counter
-      ctx->worker_ctx.us->dso_hdr.reset_backpopulate_state();
-      ctx->worker_ctx.count_samples = 0;
+      us->dso_hdr.reset_backpopulate_state();
+      unwind_release_exited(us, now_nanos());
+      *count_samples = 0;
     }
   }
   CatchExcept2DDRes();
   return ddres_init();
 }
+
+DDRes ddprof_worker_process_event(struct perf_event_header *hdr, int pos,
+                                  DDProfContext *ctx) {
+  RecordView view;
+  record_view_init(&view, hdr);
+  return worker_process_event(&view, pos, ctx, nullptr);
+}
+
+DDRes ddprof_worker_process_view(const RecordView *view, int pos,
+                                 DDProfContext *ctx) {
+  return worker_process_event(view, pos, ctx, nullptr);
+}
+
+namespace ddprof {
+DDRes worker_shard_process_event(const RecordView *view, int pos,
+                                 DDProfContext *ctx, WorkerShard *shard) {
+  return worker_process_event(view, pos, ctx, shard);
+}
+
+DDRes worker_shard_aggregate(DDProfContext *ctx) {
+#ifndef DDPROF_NATIVE_LIB
+  WorkerShardPool *pool = ctx->worker_ctx.shard_pool;
+  if (!pool) {
+    return ddres_init();
+  }
+  DDProfPProf *pprof = ctx->worker_ctx.pprof[ctx->worker_ctx.i_current_pprof];
+  // The main unwinding state is idle when shards are used
+  return pool->aggregate(
+      &ctx->worker_ctx.us->output,
+      [pprof](const UnwindOutput *output, SymbolHdr *symbol_hdr,
+              uint64_t value, int pos) {
+        return pprof_aggregate(output, symbol_hdr, value, pos, pprof);
+      });
+#else
+  (void)ctx;
+  return ddres_init();
+#endif
+}
+
+void worker_shard_replay_event(struct perf_event_header *hdr, int pos,
+                               WorkerShard *shard) {
+  switch (hdr->type) {
+  case PERF_RECORD_MMAP:
+    ddprof_pr_mmap(&shard->_us, (perf_event_mmap *)hdr, pos);
+    break;
+  case PERF_RECORD_COMM:
+    ddprof_pr_comm(&shard->_us, (perf_event_comm *)hdr, pos);
+    break;
+  case PERF_RECORD_FORK: {
+    perf_event_fork *frk = (perf_event_fork *)hdr;
+    LG_DBG("<%d>(FORK REPLAY)%d -> %d/%d", pos, frk->ppid, frk->pid, frk->tid);
+    if (frk->ppid != frk->pid) {
+      unwind_pid_fork_replayed(&shard->_us, frk->ppid, frk->pid);
+    }
+    break;
+  }
+  case PERF_RECORD_EXIT:
+    ddprof_pr_exit(&shard->_us, (perf_event_exit *)hdr, pos);
+    break;
+  default:
+    break;
+  }
+}
+} // namespace ddprof
@@ -12,58 +12,74 @@ extern "C" {
 
 #include "string_format.hpp"
 
+#include <string.h>
+
 namespace ddprof {
 
-static const std::string s_vdso_str = "[vdso]";
-static const std::string s_vsyscall_str = "[vsyscall]";
-static const std::string s_stack_str = "[stack]";
-static const std::string s_heap_str = "[heap]";
+static const char s_vdso_str[] = "[vdso]";
+static const char s_vsyscall_str[] = "[vsyscall]";
+static const char s_stack_str[] = "[stack]";
+static const char s_heap_str[] = "[heap]";
 // anon and empty are the same (one comes from perf, the other from proc maps)
-static const std::string s_anon_str = "//anon";
-static const std::string s_jsa_str = ".jsa";
+static const char s_anon_str[] = "//anon";
+static const char s_jsa_str[] = ".jsa";
 // Example of these include : anon_inode:[perf_event]
-static const std::string s_anon_inode_str = "anon_inode";
+static const char s_anon_inode_str[] = "anon_inode";
 // Example socket:[123456]
-static const std::string s_socket_str = "socket";
+static const char s_socket_str[] = "socket";
 // null elements
-static const std::string s_dev_zero_str = "/dev/zero";
-static const std::string s_dev_null_str = "/dev/null";
+static const char s_dev_zero_str[] = "/dev/zero";
+static const char s_dev_null_str[] = "/dev/null";
+
+template <size_t N>
+static bool starts_with(const char *str, const char (&prefix)[N]) {
+  // strncmp stops at the end of str
+  return strncmp(str, prefix, N - 1) == 0;
+}
+
+template <size_t N>
+static bool ends_with(const char *str, size_t len, const char (&suffix)[N]) {
+  return len >= N - 1 && memcmp(str + len - (N - 1), suffix, N - 1) == 0;
+}
+
+namespace dso {
+DsoType dso_type_from_path(const char *path, size_t len) {
+  if (starts_with(path, s_vdso_str)) {
+    return kVdso;
+  } else if (starts_with(path, s_vsyscall_str)) {
+    return kVsysCall;
+  } else if (starts_with(path, s_stack_str)) {
+    return kStack;
+  } else if (starts_with(path, s_heap_str)) {
+    return kHeap;
+    // Safeguard against other types of files we would not handle
+  } else if (!len || starts_with(path, s_anon_str) ||
+             starts_with(path, s_anon_inode_str) ||
+             starts_with(path, s_dev_zero_str) ||
+             starts_with(path, s_dev_null_str) ||
+             // ends with .jsa
+             (len > sizeof(s_jsa_str) && ends_with(path, len, s_jsa_str))) {
+    return kAnon;
+  } else if (starts_with(path, s_socket_str)) {
+    return kSocket;
+  } else if (path[0] == '[') {
+    return kUndef;
+  }
+  return kStandard;
+}
+} // namespace dso
+
 // invalid element
 Dso::Dso()
     : _pid(-1), _start(), _end(), _pgoff(), _filename(), _type(dso::kUndef),
-      _executable(false), _id(k_file_info_error) {}
+      _executable(false), _id(k_file_info_error), _fp_status(dso::kFpUnknown) {}
 
 Dso::Dso(pid_t pid, ElfAddress_t start, ElfAddress_t end, ElfAddress_t pgoff,
-         std::string &&filename, bool executable)
+         InternedString filename, bool executable)
     : _pid(pid), _start(start), _end(end), _pgoff(pgoff), _filename(filename),
-      _type(dso::kStandard), _executable(executable), _id(k_file_info_undef) {
-  // note that substr manages the case where len str < len vdso_str
-  if (_filename.substr(0, s_vdso_str.length()) == s_vdso_str) {
-    _type = dso::kVdso;
-  } else if (_filename.substr(0, s_vsyscall_str.length()) == s_vsyscall_str) {
-    _type = dso::kVsysCall;
-  } else if (_filename.substr(0, s_stack_str.length()) == s_stack_str) {
-    _type = dso::kStack;
-  } else if (_filename.substr(0, s_heap_str.length()) == s_heap_str) {
-    _type = dso::kHeap;
-    // Safeguard against other types of files we would not handle
-  } else if (_filename.empty() ||
-             _filename.substr(0, s_anon_str.length()) == s_anon_str ||
-             _filename.substr(0, s_anon_inode_str.length()) ==
-                 s_anon_inode_str ||
-             _filename.substr(0, s_dev_zero_str.length()) == s_dev_zero_str ||
-             _filename.substr(0, s_dev_null_str.length()) == s_dev_null_str ||
-             // ends with .jsa
-             ((_filename.length() > s_jsa_str.length() + 1) &&
-              _filename.substr(_filename.length() - s_jsa_str.length(),
-                               _filename.length()) == s_jsa_str)) {
-    _type = dso::kAnon;
-  } else if (_filename.substr(0, s_socket_str.length()) == s_socket_str) {
-    _type = dso::kSocket;
-  } else if (_filename[0] == '[') {
-    _type = dso::kUndef;
-  }
-}
+      _type(dso::dso_type_from_path(filename.c_str(), filename.length())),
+      _executable(executable), _id(k_file_info_undef),
+      _fp_status(dso::kFpUnknown) {}
 
 std::string Dso::to_string() const {
   return string_format("PID[%d] %lx-%lx %lx (%s)(T-%s)(%c)(ID#%d)", _pid,
@@ -73,7 +89,7 @@ std::string Dso::to_string() const {
 
 std::string Dso::format_filename() const {
   if (_type == dso::kStandard) {
-    return _filename;
+    return _filename.str();
   } else {
     return dso::dso_type_str(_type);
   }
@@ -22,6 +22,7 @@ using DsoFindRes = DsoHdr::DsoFindRes;
 using DsoRange = DsoHdr::DsoRange;
 
 namespace {
+#ifndef NDEBUG
 static FILE *procfs_map_open(int pid, const char *path_to_proc = "") {
   char buf[1024] = {0};
   auto n = snprintf(buf, 1024, "%s/proc/%d/maps", path_to_proc, pid);
@@ -42,7 +43,6 @@ struct ProcFileHolder {
   FILE *_mpf;
 };
 
-#ifndef NDEBUG
 static bool ip_in_procline(char *line, uint64_t ip) {
   static const char spec[] = "%lx-%lx %4c %lx %*x:%*x %*d%n";
   uint64_t m_start = 0;
@@ -118,7 +118,9 @@ uint64_t DsoStats::sum_event_metric(DsoEventType dso_event) const {
 /**********/
 /* DsoHdr */
 /**********/
-DsoHdr::DsoHdr() {
+DsoHdr::DsoHdr()
+    : _generation(0), _generation_pid(-1), _generation_ptr(nullptr),
+      _read_ranges{}, _read_range_next(0) {
   // keep dso_id 0 as a reserved value
   // Test different places for existence of /proc
   if (check_file_type("/host/proc", S_IFDIR)) {
@@ -133,8 +135,8 @@ DsoFindRes DsoHdr::dso_find_first_std_executable(pid_t pid) {
   const DsoMap &map = _map[pid];
   DsoMapConstIt it = map.lower_bound(0);
   // look for the first executable standard region
-  while (it != map.end() && !it->second._executable &&
-         it->second._type != dso::kStandard) {
+  while (it != map.end() && !it->_executable &&
+         it->_type != dso::kStandard) {
     ++it;
   }
   if (it == map.end()) {
@@ -146,22 +148,12 @@ DsoFindRes DsoHdr::dso_find_first_std_executable(pid_t pid) {
 DsoFindRes DsoHdr::dso_find_closest(const DsoMap &map, pid_t pid,
                                     ElfAddress_t addr) {
   bool is_within = false;
-  // First element not less than (can match a start addr)
-  DsoMapConstIt it = map.lower_bound(addr);
-  if (it != map.end()) {
-    is_within = it->second.is_within(pid, addr);
-    if (is_within) { // exact match
-      return std::make_pair<DsoMapConstIt, bool>(std::move(it),
-                                                 std::move(is_within));
-    }
-  }
-  // previous element is more likely to contain our addr
-  if (it != map.begin()) {
-    --it;
-  } else { // map is empty
+  DsoMapConstIt it = map.find_closest(addr, &is_within);
+  if (it == map.end()) {
     return find_res_not_found(map);
   }
-  is_within = it->second.is_within(pid, addr);
+  // only the matching DSO is read
+  is_within = is_within && it->_pid == pid;
   return std::make_pair<DsoMapConstIt, bool>(std::move(it),
                                              std::move(is_within));
 }
@@ -195,7 +187,7 @@ DsoRange DsoHdr::get_intersection(DsoMap &map, const Dso &dso) {
     // Stop when :
     // - start of the list
     // - end is before start
-    if (first_el->second._end < dso._start) {
+    if (first_el->_end < dso._start) {
       break;
     }
   }
@@ -205,14 +197,14 @@ DsoRange DsoHdr::get_intersection(DsoMap &map, const Dso &dso) {
 
   // Loop accross the possible range keeping track of first and last
   while (first_el != map.end()) {
-    if (dso.intersects(first_el->second)) {
+    if (dso.intersects(*first_el)) {
       if (start == map.end()) {
         start = first_el;
       }
       end = first_el;
     }
     // if we are past the dso (both different pid and start past the end)
-    if (first_el->second._start > dso._end) {
+    if (first_el->_start > dso._end) {
       break;
     }
     ++first_el;
@@ -237,7 +229,7 @@ DsoFindRes DsoHdr::dso_find_adjust_same(DsoMap &map, const Dso &dso) {
   // comparator only looks at start ptr
   if (it != map.end()) {
     // if it is the same or smaller, we keep the current dso
-    found_same = it->second.adjust_same(dso);
+    found_same = map.adjust_same(it, dso);
   }
   return std::make_pair<DsoFindRes::first_type, DsoFindRes::second_type>(
       std::move(it), std::move(found_same));
@@ -268,6 +260,25 @@ FileInfoId_t DsoHdr::update_id_and_path(const Dso &dso) {
   FileInfoInodeKey key(file_info._inode, dso._pgoff, file_info._size);
   auto it = _file_info_inode_map.find(key);
   if (it == _file_info_inode_map.end()) {
+    // build-id is read once per file
+    BuildId build_id = read_build_id(file_info._path.c_str());
+    if (!build_id.empty()) {
+      FileInfoBuildIdKey build_id_key(build_id, dso._pgoff, file_info._size);
+      auto build_id_it = _file_info_build_id_map.find(build_id_key);
+      if (build_id_it != _file_info_build_id_map.end()) {
+        // same binary through another inode : reuse its id and caches
+        dso._id = build_id_it->second;
+        _file_info_inode_map.emplace(std::move(key), dso._id);
+        LG_DBG("Shared file %d - %s - %s", dso._id, file_info._path.c_str(),
+               build_id.c_str());
+        // update with latest location
+        _file_info_vector[dso._id]._info = file_info;
+        _file_info_vector[dso._id]._errored = false;
+        return dso._id;
+      }
+      _file_info_build_id_map.emplace(std::move(build_id_key),
+                                      _file_info_vector.size());
+    }
     dso._id = _file_info_vector.size();
     _file_info_inode_map.emplace(std::move(key), dso._id);
 #ifdef DEBUG
@@ -275,6 +286,7 @@ FileInfoId_t DsoHdr::update_id_and_path(const Dso &dso) {
            file_info._size);
 #endif
     _file_info_vector.emplace_back(std::move(file_info), dso._id);
+    _file_info_vector.back()._build_id = std::move(build_id);
   } else { // already exists
     dso._id = it->second;
     // update with latest location
@@ -291,6 +303,7 @@ bool DsoHdr::erase_overlap(const Dso &dso) {
   DsoRange range = get_intersection(map, dso);
   if (range.first != map.end()) {
     erase_range(map, range);
+    invalidate_generation(dso._pid);
     return true;
   }
   return false;
@@ -308,12 +321,12 @@ DsoFindRes DsoHdr::insert_erase_overlap(DsoMap &map, Dso &&dso) {
 
   if (range.first != map.end()) {
     erase_range(map, range);
+    invalidate_generation(dso._pid);
   }
   _stats.incr_metric(DsoStats::kNewDso, dso._type);
   LG_DBG("[DSO] : Insert %s", dso.to_string().c_str());
   // warning rvalue : do not use dso after this line
-  return map.insert(std::make_pair<ProcessAddress_t, Dso>(
-      ProcessAddress_t(dso._start), std::move(dso)));
+  return map.insert(std::move(dso));
 }
 
 DsoFindRes DsoHdr::insert_erase_overlap(Dso &&dso) {
@@ -353,13 +366,45 @@ DsoFindRes DsoHdr::dso_find_or_backpopulate(pid_t pid, ElfAddress_t addr) {
 // addr : in the virtual mem of the pid specified
 DsoFindRes DsoHdr::pid_read_dso(int pid, void *buf, size_t sz, uint64_t addr) {
   assert(buf);
+  ReadRange range;
+  DsoFindRes find_res = find_read_range(pid, addr, sz, range);
+  if (find_res.second) {
+    memcpy(buf, range._src + (addr - range._start), sz);
+  }
+  return find_res;
+}
+
+bool DsoHdr::pid_read(pid_t pid, void *buf, size_t sz, ProcessAddress_t addr) {
+  assert(buf);
+  uint64_t generation = get_generation(pid);
+  for (const ReadRange &range : _read_ranges) {
+    if (range._generation == generation && range._pid == pid &&
+        addr >= range._start && addr + sz <= range._end) {
+      memcpy(buf, range._src + (addr - range._start), sz);
+      return true;
+    }
+  }
+  ReadRange range;
+  if (!find_read_range(pid, addr, sz, range).second) {
+    return false;
+  }
+  memcpy(buf, range._src + (addr - range._start), sz);
+  // backpopulating can change the generation
+  range._generation = get_generation(pid);
+  _read_ranges[_read_range_next] = range;
+  _read_range_next = (_read_range_next + 1) % k_nb_read_ranges;
+  return true;
+}
+
+DsoFindRes DsoHdr::find_read_range(int pid, uint64_t addr, size_t sz,
+                                   ReadRange &range) {
   assert(sz > 0);
 
   DsoFindRes find_res = dso_find_or_backpopulate(pid, addr);
   if (!find_res.second) {
     return find_res;
   }
-  const Dso &dso = find_res.first->second;
+  const Dso &dso = *find_res.first;
   if (!dso_handled_type_read_dso(dso)) {
     // We can not mmap if we do not have a file
     LG_DBG("[DSO] Read DSO : Unhandled DSO %s", dso.to_string().c_str());
@@ -384,9 +429,11 @@ DsoFindRes DsoHdr::pid_read_dso(int pid, void *buf, size_t sz, uint64_t addr) {
     return find_res;
   }
 
-  Offset_t file_region_offset = (addr - dso._start);
-
-  if (file_region_offset > region->get_sz()) {
+  // The region can be smaller than the mapping (file shorter than the
+  // mapping)
+  ProcessAddress_t end =
+      dso._start + std::min<uint64_t>(dso._end - dso._start, region->get_sz());
+  if (addr + sz > end) {
     LG_NTC("[DSO] Attempt to read past the dso file");
     find_res.second = false;
     return find_res;
@@ -394,11 +441,12 @@ DsoFindRes DsoHdr::pid_read_dso(int pid, void *buf, size_t sz, uint64_t addr) {
 
   // At this point, we've
   //  Found a segment with matching parameters
-  //  Adjusted addr to be a segment-offset
   //  Confirmed that the segment has the capacity to support our read
-  // So let's read it!
-  unsigned char *src = (unsigned char *)region->get_region();
-  memcpy(buf, src + file_region_offset, sz);
+  range._pid = pid;
+  range._generation = 0;
+  range._start = dso._start;
+  range._end = end;
+  range._src = static_cast<const char *>(region->get_region());
   return find_res;
 }
 
@@ -430,7 +478,57 @@ const RegionHolder *DsoHdr::find_or_insert_region(const Dso &dso) {
   }
 }
 
-void DsoHdr::pid_free(int pid) { _map.erase(pid); }
+void DsoHdr::pid_free(int pid) {
+  _map.erase(pid);
+  _backpopulate_state_map.erase(pid);
+  // next lookup assigns a new generation
+  _generation_map.erase(pid);
+  if (_generation_pid == pid) {
+    _generation_pid = -1;
+    _generation_ptr = nullptr;
+  }
+}
+
+int DsoHdr::pid_fork(pid_t ppid, pid_t pid) {
+  auto child_it = _map.find(pid);
+  if (child_it != _map.end() && !child_it->second.empty()) {
+    // fork replayed after events of the child : its dsos are more recent
+    return 0;
+  }
+  auto it = _map.find(ppid);
+  if (it == _map.end() || it->second.empty()) {
+    // backpopulate on the first lookup
+    return 0;
+  }
+  // references to elements are stable when inserting the child's map
+  const DsoMap &parent_map = it->second;
+  DsoMap &map = _map[pid];
+  for (const Dso &dso : parent_map) {
+    // file ids are kept : files do not need to be looked up again
+    map.insert(Dso(dso, pid));
+  }
+  LG_DBG("[DSO] Fork %d -> %d, inherit %lu DSOs", ppid, pid, map.size());
+  return map.size();
+}
+
+uint64_t DsoHdr::get_generation(pid_t pid) {
+  if (pid != _generation_pid) {
+    uint64_t &generation = _generation_map[pid];
+    if (!generation) {
+      generation = ++_generation;
+    }
+    _generation_pid = pid;
+    _generation_ptr = &generation; // stable : unordered_map nodes do not move
+  }
+  return *_generation_ptr;
+}
+
+void DsoHdr::invalidate_generation(pid_t pid) {
+  auto it = _generation_map.find(pid);
+  if (it != _generation_map.end()) {
+    it->second = ++_generation;
+  }
+}
 
 bool DsoHdr::pid_backpopulate(pid_t pid, int &nb_elts_added) {
   return pid_backpopulate(_map[pid], pid, nb_elts_added);
@@ -441,72 +539,51 @@ bool DsoHdr::pid_backpopulate(pid_t pid, int &nb_elts_added) {
 // elements
 bool DsoHdr::pid_backpopulate(DsoMap &map, pid_t pid, int &nb_elts_added) {
   nb_elts_added = 0;
-  ProcFileHolder proc_file_holder(pid, _path_to_proc);
   LG_DBG("[DSO] Backpopulating PID %d", pid);
-  FILE *mpf = proc_file_holder._mpf;
-  if (!mpf) {
+  if (!_maps_reader.read(pid, _path_to_proc)) {
     LG_DBG("[DSO] Failed to open procfs for %d", pid);
     if (!process_is_alive(pid))
       LG_DBG("[DSO] Process nonexistant");
     return false;
   }
 
-  char *buf = NULL;
-  size_t sz_buf = 0;
-
-  while (-1 != getline(&buf, &sz_buf, mpf)) {
-    Dso dso = dso_from_procline(pid, buf);
-    if (dso._pid == -1) { // invalid dso
+  ProcMapsEntry entry;
+  while (_maps_reader.next(entry)) {
+    if (!is_relevant_mapping(entry)) {
       continue;
     }
-    if ((insert_erase_overlap(map, std::move(dso))).second) {
+    if ((insert_erase_overlap(map, dso_from_maps_entry(pid, entry))).second) {
       ++nb_elts_added;
     }
   }
-  free(buf);
   return true;
 }
 
+bool DsoHdr::is_relevant_mapping(const ProcMapsEntry &entry) {
+  if (entry._executable) {
+    return true;
+  }
+  // Data mappings not backed by files (heaps of JVMs account for most of the
+  // mappings) are neither unwound through nor read from
+  dso::DsoType type = dso::dso_type_from_path(entry._path, entry._path_len);
+  return type != dso::kAnon && type != dso::kUndef && type != dso::kSocket;
+}
+
 Dso DsoHdr::dso_from_procline(int pid, char *line) {
-  // clang-format off
-  // Example of format
-  /*
-    55d78839f000-55d7883a1000 r--p 00000000 fe:01 3287864                    /usr/local/bin/BadBoggleSolver_run
-    55d7883a1000-55d7883a5000 r-xp 00002000 fe:01 3287864                    /usr/local/bin/BadBoggleSolver_run
-    ...
-    55d78a12b000-55d78a165000 rw-p 00000000 00:00 0                          [heap]
-    ...
-    7f531437b000-7f531439e000 r-xp 00001000 fe:01 3932979                    /usr/lib/x86_64-linux-gnu/ld-2.31.so
-    7f531439e000-7f53143a6000 r--p 00024000 fe:01 3932979                    /usr/lib/x86_64-linux-gnu/ld-2.31.so
-    7f53143a8000-7f53143a9000 rw-p 0002d000 fe:01 3932979                    /usr/lib/x86_64-linux-gnu/ld-2.31.so
-    7f53143a9000-7f53143aa000 rw-p 00000000 00:00 0
-    7ffcd6c68000-7ffcd6c89000 rw-p 00000000 00:00 0                          [stack]
-    7ffcd6ce2000-7ffcd6ce6000 r--p 00000000 00:00 0                          [vvar]
-    7ffcd6ce6000-7ffcd6ce8000 r-xp 00000000 00:00 0                          [vdso]
-    ffffffffff600000-ffffffffff601000 r-xp 00000000 00:00 0                  [vsyscall]
-  */
-  // clang-format on
-  static const char spec[] = "%lx-%lx %4c %lx %*x:%*x %*d%n";
-  uint64_t m_start = 0;
-  uint64_t m_end = 0;
-  uint64_t m_off = 0;
-  char m_mode[4] = {0};
-  int m_p = 0;
+  ProcMapsEntry entry;
   // Check for formatting errors
-  if (4 != sscanf(line, spec, &m_start, &m_end, m_mode, &m_off, &m_p)) {
+  if (!ProcMapsReader::parse_line(line, line + strlen(line), entry)) {
     LG_ERR("[DSO] Failed to scan mapfile line");
     throw DDException(DD_SEVERROR, DD_WHAT_DSO);
   }
+  return dso_from_maps_entry(pid, entry);
+}
 
-  // Make sure the name index points to a valid char
-  char *p = &line[m_p], *q;
-  while (isspace(*p))
-    p++;
-  if ((q = strchr(p, '\n')))
-    *q = '\0';
-
+Dso DsoHdr::dso_from_maps_entry(pid_t pid, const ProcMapsEntry &entry) {
   // Should we store non exec dso ?
-  return Dso(pid, m_start, m_end - 1, m_off, std::string(p), 'x' == m_mode[2]);
+  return Dso(pid, entry._start, entry._end - 1, entry._offset,
+             _filenames.intern(entry._path, entry._path_len),
+             entry._executable);
 }
 
 FileInfo DsoHdr::find_file_info(const Dso &dso) {
@@ -517,7 +594,7 @@ FileInfo DsoHdr::find_file_info(const Dso &dso) {
   // Example : /proc/<pid>/root/usr/local/bin/exe_file
   //   or      /host/proc/<pid>/root/usr/local/bin/exe_file
   std::string proc_path = _path_to_proc + "/proc/" + std::to_string(dso._pid) +
-      "/root" + dso._filename;
+      "/root" + dso._filename.c_str();
   bool file_found = get_file_inode(proc_path.c_str(), &inode, &size);
   if (file_found) {
     return FileInfo(proc_path, size, inode);
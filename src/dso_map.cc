@@ -0,0 +1,167 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "dso_map.hpp"
+
+#include <algorithm>
+
+namespace ddprof {
+
+size_t DsoMap::Level::lower_bound(ProcessAddress_t addr) const {
+  return std::lower_bound(_starts.begin(), _starts.end(), addr) -
+      _starts.begin();
+}
+
+size_t DsoMap::Level::upper_bound(ProcessAddress_t addr) const {
+  return std::upper_bound(_starts.begin(), _starts.end(), addr) -
+      _starts.begin();
+}
+
+void DsoMap::Level::insert(size_t pos, const Entry &entry) {
+  _starts.insert(_starts.begin() + pos, entry._dso->_start);
+  _entries.insert(_entries.begin() + pos, entry);
+}
+
+void DsoMap::Level::erase(size_t first, size_t last) {
+  _starts.erase(_starts.begin() + first, _starts.begin() + last);
+  _entries.erase(_entries.begin() + first, _entries.begin() + last);
+}
+
+void DsoMap::Level::clear() {
+  _starts.clear();
+  _entries.clear();
+}
+
+void DsoMap::clear() {
+  _main.clear();
+  _staged.clear();
+  _slots.clear();
+  _free_slots.clear();
+}
+
+DsoMap::iterator DsoMap::lower_bound(ProcessAddress_t addr) {
+  return iterator(this, _main.lower_bound(addr), _staged.lower_bound(addr));
+}
+
+DsoMap::const_iterator DsoMap::lower_bound(ProcessAddress_t addr) const {
+  return const_iterator(this, _main.lower_bound(addr),
+                        _staged.lower_bound(addr));
+}
+
+DsoMap::const_iterator DsoMap::upper_bound(ProcessAddress_t addr) const {
+  return const_iterator(this, _main.upper_bound(addr),
+                        _staged.upper_bound(addr));
+}
+
+DsoMap::iterator DsoMap::find(ProcessAddress_t addr) {
+  iterator it = lower_bound(addr);
+  if (it != end() && it->_start != addr) {
+    return end();
+  }
+  return it;
+}
+
+DsoMap::const_iterator DsoMap::find_closest(ProcessAddress_t addr,
+                                            bool *is_within) const {
+  size_t main_pos = _main.upper_bound(addr);
+  size_t staged_pos = _staged.upper_bound(addr);
+  if (main_pos == 0 && staged_pos == 0) {
+    *is_within = false;
+    return end();
+  }
+  // the closest is the last entry of the two levels before addr
+  const_iterator it(this, main_pos, staged_pos);
+  --it;
+  *is_within = addr <= it.entry()._end;
+  return it;
+}
+
+std::pair<DsoMap::iterator, bool> DsoMap::insert(Dso &&dso) {
+  size_t main_pos = _main.size();
+  size_t staged_pos = _staged.size();
+  bool append = (_main._starts.empty() || _main._starts.back() < dso._start) &&
+      (_staged._starts.empty() || _staged._starts.back() < dso._start);
+  if (!append) {
+    main_pos = _main.lower_bound(dso._start);
+    staged_pos = _staged.lower_bound(dso._start);
+    iterator it(this, main_pos, staged_pos);
+    if (it != end() && it->_start == dso._start) {
+      return std::make_pair(it, false);
+    }
+  }
+  Dso *slot;
+  if (_free_slots.empty()) {
+    _slots.push_back(std::move(dso));
+    slot = &_slots.back();
+  } else {
+    slot = _free_slots.back();
+    _free_slots.pop_back();
+    *slot = std::move(dso);
+  }
+  Entry entry{slot->_end, slot};
+  if (append) {
+    _main.insert(main_pos, entry);
+    return std::make_pair(iterator(this, main_pos, staged_pos), true);
+  }
+  _staged.insert(staged_pos, entry);
+  if (_staged.size() * _staged.size() > _main.size()) {
+    merge_staged();
+    // entries before the new one (from both levels) are now in main
+    return std::make_pair(iterator(this, main_pos + staged_pos, 0), true);
+  }
+  return std::make_pair(iterator(this, main_pos, staged_pos), true);
+}
+
+void DsoMap::merge_staged() {
+  size_t main_size = _main.size();
+  size_t staged_size = _staged.size();
+  _main._starts.resize(main_size + staged_size);
+  _main._entries.resize(main_size + staged_size);
+  // merge from the back : each entry moves once
+  size_t i = main_size;
+  size_t j = staged_size;
+  size_t pos = main_size + staged_size;
+  while (j != 0) {
+    --pos;
+    if (i != 0 && _main._starts[i - 1] > _staged._starts[j - 1]) {
+      --i;
+      _main._starts[pos] = _main._starts[i];
+      _main._entries[pos] = _main._entries[i];
+    } else {
+      --j;
+      _main._starts[pos] = _staged._starts[j];
+      _main._entries[pos] = _staged._entries[j];
+    }
+  }
+  _staged.clear();
+}
+
+bool DsoMap::adjust_same(iterator it, const Dso &dso) {
+  bool found_same = it->adjust_same(dso);
+  entry(it)._end = it->_end;
+  return found_same;
+}
+
+DsoMap::iterator DsoMap::erase(const_iterator it) {
+  return erase(it, std::next(it));
+}
+
+DsoMap::iterator DsoMap::erase(const_iterator first, const_iterator last) {
+  for (const_iterator it = first; it != last; ++it) {
+    Dso *slot = it.entry()._dso;
+    *slot = Dso(); // release the filename
+    _free_slots.push_back(slot);
+  }
+  if (_free_slots.size() == _slots.size()) {
+    _slots.clear();
+    _free_slots.clear();
+  }
+  // the range is contiguous in both levels
+  _main.erase(first._main, last._main);
+  _staged.erase(first._staged, last._staged);
+  return iterator(this, first._main, first._staged);
+}
+
+} // namespace ddprof
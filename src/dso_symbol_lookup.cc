@@ -18,15 +18,19 @@ namespace ddprof {
 
 namespace {
 
-Symbol symbol_from_unhandled_dso(const Dso &dso) {
-  return Symbol(std::string(), std::string(), 0, dso::dso_type_str(dso._type));
+Symbol symbol_from_unhandled_dso(const Dso &dso, SymbolTable &symbol_table) {
+  return Symbol(InternedString(), InternedString(), 0,
+                symbol_table.intern(dso::dso_type_str(dso._type)));
 }
 
-Symbol symbol_from_dso(ElfAddress_t normalized_addr, const Dso &dso) {
+Symbol symbol_from_dso(ElfAddress_t normalized_addr, const Dso &dso,
+                       SymbolTable &symbol_table) {
   // address that means something for our user (addr)
-  std::string dso_dbg_str =
-      normalized_addr ? string_format("[%p:file]", normalized_addr) : "";
-  return Symbol(dso_dbg_str, dso_dbg_str, 0, dso.format_filename());
+  InternedString dso_dbg_str = normalized_addr
+      ? symbol_table.intern(string_format("[%p:file]", normalized_addr))
+      : InternedString();
+  return Symbol(dso_dbg_str, dso_dbg_str, 0,
+                symbol_table.intern(dso.format_filename()));
 }
 } // namespace
 
@@ -40,7 +44,7 @@ DsoSymbolLookup::get_or_insert_unhandled_type(const Dso &dso,
     symbol_idx = it->second;
   } else {
     symbol_idx = symbol_table.size();
-    symbol_table.push_back(symbol_from_unhandled_dso(dso));
+    symbol_table.push_back(symbol_from_unhandled_dso(dso, symbol_table));
     _map_unhandled_dso.insert(
         std::pair<dso::DsoType, SymbolIdx_t>(dso._type, symbol_idx));
   }
@@ -63,7 +67,8 @@ SymbolIdx_t DsoSymbolLookup::get_or_insert(ElfAddress_t addr, const Dso &dso,
     symbol_idx = it->second;
   } else { // insert things
     symbol_idx = symbol_table.size();
-    symbol_table.push_back(symbol_from_dso(normalized_addr, dso));
+    symbol_table.push_back(
+        symbol_from_dso(normalized_addr, dso, symbol_table));
     addr_lookup.insert(
         std::pair<FileAddress_t, SymbolIdx_t>(normalized_addr, symbol_idx));
   }
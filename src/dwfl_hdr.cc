@@ -20,10 +20,11 @@ extern "C" {
 namespace ddprof {
 
 DwflWrapper::DwflWrapper()
-    : _dwfl(nullptr), _attached(false), _inconsistent(false) {
+    : _dwfl(nullptr), _attached(false), _inconsistent(false),
+      _elf_cache(nullptr) {
   // for split debug, we can fill the debuginfo_path
   static const Dwfl_Callbacks proc_callbacks = {
-      .find_elf = dwfl_linux_proc_find_elf,
+      .find_elf = find_cached_elf,
       .find_debuginfo = dwfl_standard_find_debuginfo,
       .section_address = nullptr,
       .debuginfo_path = nullptr,
@@ -58,6 +59,7 @@ DwflWrapper &DwflHdr::get_or_insert(pid_t pid) {
     // insert new dwfl for this pid
     auto pair = _dwfl_map.emplace(pid, DwflWrapper());
     assert(pair.second); // expect insertion to be OK
+    pair.first->second._elf_cache = &_elf_cache;
     return pair.first->second;
   }
   return it->second;
@@ -68,7 +70,8 @@ DDRes DwflWrapper::register_mod(ProcessAddress_t pc, const Dso &dso,
   bool &mod_added = _mod_added[fileInfoValue.get_id()];
   if (!mod_added) {
     // first time we see this binary for this pid
-    DDProfMod ddprof_mod = update_module(_dwfl, pc, dso, fileInfoValue);
+    DDProfMod ddprof_mod =
+        update_module(_dwfl, pc, dso, fileInfoValue, _elf_cache);
     if (!ddprof_mod._mod) {
       LG_WRN("Unable to register mod %s - %d", dso.to_string().c_str(),
              ddprof_mod._status);
@@ -97,6 +100,18 @@ void DwflHdr::clear_unvisited() {
 
   // clear the list of visited for next cycle
   _visited_pid.clear();
+
+  // release the files no remaining module points to (unwinding and symbol
+  // tables copy what they need when they are built)
+  std::unordered_set<FileInfoId_t> referenced;
+  for (const auto &el : _dwfl_map) {
+    for (const auto &mod : el.second._mod_added) {
+      if (mod.second) {
+        referenced.insert(mod.first);
+      }
+    }
+  }
+  _elf_cache.evict_unreferenced(referenced);
 }
 
 int DwflHdr::get_nb_mod() const {
@@ -111,6 +126,7 @@ int DwflHdr::get_nb_mod() const {
 
 void DwflHdr::display_stats() const {
   LG_NTC("DWFL_HDR  | %10s | %d", "NB MODS", get_nb_mod());
+  LG_NTC("DWFL_HDR  | %10s | %lu", "NB ELF", _elf_cache.size());
 }
 
 void DwflHdr::clear_pid(pid_t pid) { _dwfl_map.erase(pid); }
@@ -19,8 +19,46 @@ static const char *get_filename(const char *full_path) {
   return right_slash + 1;
 }
 
+// Report the module without opening the file : dwfl asks for the Elf handle
+// through find_cached_elf, when it is first needed.
+static Dwfl_Module *report_cached_module(Dwfl *dwfl, const char *dso_name,
+                                         const Dso &dso,
+                                         const FileInfoValue &fileInfoValue,
+                                         ElfCache &elf_cache) {
+  const ElfCacheEntry *entry =
+      elf_cache.get_or_insert(fileInfoValue.get_id(), fileInfoValue.get_path());
+  if (!entry) {
+    return nullptr;
+  }
+  // Same range as dwfl_report_elf (the file is mapped from base)
+  ProcessAddress_t base = dso._start - dso._pgoff;
+  ProcessAddress_t bias = base - entry->_vaddr;
+  Dwfl_Module *mod =
+      dwfl_report_module(dwfl, dso_name, base, bias + entry->_end_vaddr);
+  if (mod) {
+    void **userdata;
+    dwfl_module_info(mod, &userdata, 0, 0, 0, 0, 0, 0);
+    *userdata = const_cast<ElfCacheEntry *>(entry);
+  }
+  return mod;
+}
+
+int find_cached_elf(Dwfl_Module *mod, void **userdata, const char *modname,
+                    Dwarf_Addr base, char **file_name, Elf **elfp) {
+  const ElfCacheEntry *entry = static_cast<const ElfCacheEntry *>(*userdata);
+  if (!entry) {
+    return dwfl_linux_proc_find_elf(mod, userdata, modname, base, file_name,
+                                    elfp);
+  }
+  // Takes a reference on the shared handle (released by dwfl_end)
+  *elfp = elf_begin(-1, ELF_C_READ_MMAP, entry->_elf);
+  *file_name = strdup(entry->_path.c_str());
+  return -1;
+}
+
 DDProfMod update_module(Dwfl *dwfl, ProcessAddress_t pc, const Dso &dso,
-                        const FileInfoValue &fileInfoValue) {
+                        const FileInfoValue &fileInfoValue,
+                        ElfCache *elf_cache) {
   if (!dwfl)
     return DDProfMod();
 
@@ -71,8 +109,13 @@ DDProfMod update_module(Dwfl *dwfl, ProcessAddress_t pc, const Dso &dso,
     if (!filepath.empty()) {
       const char *dso_name = strrchr(filepath.c_str(), '/') + 1;
       dwfl_errno(); // erase previous error
-      ddprof_mod._mod = dwfl_report_elf(dwfl, dso_name, filepath.c_str(), -1,
-                                        dso._start - dso._pgoff, false);
+      if (elf_cache) {
+        ddprof_mod._mod = report_cached_module(dwfl, dso_name, dso,
+                                               fileInfoValue, *elf_cache);
+      } else {
+        ddprof_mod._mod = dwfl_report_elf(dwfl, dso_name, filepath.c_str(),
+                                          -1, dso._start - dso._pgoff, false);
+      }
     }
   }
 
@@ -5,8 +5,6 @@
 
 #include "dwfl_symbol.hpp"
 
-#include <llvm/Demangle/Demangle.h>
-
 extern "C" {
 #include "dwfl_internals.h"
 #include "logger.h"
@@ -15,9 +13,11 @@ extern "C" {
 
 namespace ddprof {
 
-// compute the info using dwarf and demangle APIs
+// compute the info using dwarf APIs (names are demangled at export time)
 bool symbol_get_from_dwfl(Dwfl_Module *mod, ProcessAddress_t process_pc,
-                          Symbol &symbol, GElf_Sym &elf_sym, Offset_t &lbias) {
+                          SymbolTable &table, Symbol &symbol,
+                          GElf_Sym &elf_sym, Offset_t &lbias,
+                          bool line_info) {
   // sym not used in the rest of the process : not storing it
   GElf_Word lshndxp;
   Elf *lelfp;
@@ -27,8 +27,7 @@ bool symbol_get_from_dwfl(Dwfl_Module *mod, ProcessAddress_t process_pc,
       mod, process_pc, &loffset, &elf_sym, &lshndxp, &lelfp, &lbias);
 
   if (lsymname) {
-    symbol._symname = std::string(lsymname);
-    symbol._demangle_name = llvm::demangle(symbol._symname);
+    symbol._symname = table.intern(lsymname);
     symbol_success = true;
   }
 
@@ -36,20 +35,22 @@ bool symbol_get_from_dwfl(Dwfl_Module *mod, ProcessAddress_t process_pc,
 // A small mechanism to create a trace around the expected function
 #ifdef FLAG_SYMBOL
   static const std::string look_for_symb = "runtime.asmcgocall.abi0";
-  if (symbol._demangle_name.find(look_for_symb) != std::string::npos) {
+  if (strstr(symbol._symname.c_str(), look_for_symb.c_str())) {
     LG_NFO("DGB:: GOING THROUGH EXPECTED FUNC: %s", look_for_symb.c_str());
   }
 #endif
+  symbol._lineno = 0;
+  if (!line_info) {
+    return symbol_success;
+  }
   Dwfl_Line *line = dwfl_module_getsrc(mod, process_pc);
   // srcpath
   int linep;
   const char *localsrcpath =
       dwfl_lineinfo(line, &process_pc, static_cast<int *>(&linep), 0, 0, 0);
   if (localsrcpath) {
-    symbol._srcpath = std::string(localsrcpath);
+    symbol._srcpath = table.intern(localsrcpath);
     symbol._lineno = static_cast<uint32_t>(linep);
-  } else {
-    symbol._lineno = 0;
   }
   return symbol_success;
 }
@@ -17,11 +17,13 @@ extern "C" {
 #include "dwfl_hdr.hpp"
 #include "dwfl_module.hpp"
 #include "dwfl_symbol.hpp"
+#include "elf_cache.hpp"
 #include "string_format.hpp"
 
 namespace ddprof {
 
-DwflSymbolLookup_V2::DwflSymbolLookup_V2() : _lookup_setting(K_CACHE_ON) {
+DwflSymbolLookup_V2::DwflSymbolLookup_V2()
+    : _lookup_setting(K_CACHE_ON), _eager_symbols(false), _line_info(true) {
   if (const char *env_p = std::getenv("DDPROF_CACHE_SETTING")) {
     if (strcmp(env_p, "VALIDATE") == 0) {
       // Allows to compare the accuracy of the cache
@@ -58,7 +60,26 @@ SymbolIdx_t DwflSymbolLookup_V2::get_or_insert(
   LG_DBG("Looking for : %lx = (%lx - %lx) / (offset : %lx) / dso:%s", region_pc,
          process_pc, dso._start, dso._pgoff, dso._filename.c_str());
 #endif
-  DwflSymbolMap &map = _file_info_map[file_info.get_id()];
+  if (_eager_symbols) {
+    SymbolIdx_t symbol_idx;
+    if (find_eager(dwfl_wrapper, table, process_pc, dso, file_info,
+                   symbol_idx)) {
+      ++_stats._hit;
+      ++_stats._elf_table_hits;
+      return symbol_idx;
+    }
+    // not covered by the symbol table (or no table) : use dwfl
+  }
+
+  auto map_it = _file_info_map.find(file_info.get_id());
+  if (map_it == _file_info_map.end()) {
+    map_it = _file_info_map.emplace(file_info.get_id(), DwflSymbolMap()).first;
+    // first lookup in this file : reuse the symbols of previous workers
+    if (_disk_cache.enabled()) {
+      load_disk_cache(table, dso, file_info, map_it->second);
+    }
+  }
+  DwflSymbolMap &map = map_it->second;
   DwflSymbolMapFindRes find_res = find_closest(map, region_pc);
   if (find_res.second) { // already found the correct symbol
 #ifdef DEBUG
@@ -71,7 +92,8 @@ SymbolIdx_t DwflSymbolLookup_V2::get_or_insert(
     // symbols
     if (_lookup_setting == K_CACHE_VALIDATE) {
       DDProfMod ddprof_mod =
-          update_module(dwfl_wrapper._dwfl, process_pc, dso, file_info);
+          update_module(dwfl_wrapper._dwfl, process_pc, dso, file_info,
+                        dwfl_wrapper._elf_cache);
       if (symbol_lookup_check(ddprof_mod._mod, process_pc,
                               table[find_res.first->second.get_symbol_idx()])) {
         ++_stats._errors;
@@ -123,16 +145,16 @@ DwflSymbolLookup_V2::insert(DwflWrapper &dwfl_wrapper, SymbolTable &table,
   GElf_Sym elf_sym;
   Offset_t lbias;
   // Looking up Mod here is a waist (pending refactoring)
-  DDProfMod ddprof_mod =
-      update_module(dwfl_wrapper._dwfl, process_pc, dso, file_info);
+  DDProfMod ddprof_mod = update_module(dwfl_wrapper._dwfl, process_pc, dso,
+                                       file_info, dwfl_wrapper._elf_cache);
   if (!ddprof_mod._mod) {
     dwfl_wrapper._inconsistent = ddprof_mod._status == DDProfMod::kInconsistent;
   }
 
   RegionAddress_t region_pc = process_pc - dso._start;
 
-  if (!symbol_get_from_dwfl(ddprof_mod._mod, process_pc, symbol, elf_sym,
-                            lbias)) {
+  if (!symbol_get_from_dwfl(ddprof_mod._mod, process_pc, table, symbol,
+                            elf_sym, lbias, _line_info)) {
     ++_stats._no_dwfl_symbols;
     // Override with info from dso
     // Avoid bouncing on these requests and insert an element
@@ -162,7 +184,7 @@ DwflSymbolLookup_V2::insert(DwflWrapper &dwfl_wrapper, SymbolTable &table,
     // if it is the same -> extend the end to current pc
     // Note: I have never hit this. Perhaps it can be removed (TBD)
     SymbolIdx_t previous_symb = find_res.first->second.get_symbol_idx();
-    if (symbol._demangle_name == table[previous_symb]._demangle_name) {
+    if (symbol._symname == table[previous_symb]._symname) {
       find_res.first->second.set_end(region_pc);
 #ifdef DEBUG
       LG_DBG("Reuse previously matched %lx,%lx -> %s,%d,%d",
@@ -175,28 +197,26 @@ DwflSymbolLookup_V2::insert(DwflWrapper &dwfl_wrapper, SymbolTable &table,
 
   RegionAddress_t start_sym;
   RegionAddress_t end_sym;
-  // All paths bellow will insert symbol in the table
-  SymbolIdx_t symbol_idx = table.size();
-  if (symbol._srcpath.empty()) {
-    // override with info from dso (this slightly mixes mappings and sources)
-    // But it helps a lot at Datadog (as mappings are ignored for now in UI)
-    symbol._srcpath = dso.format_filename();
-  }
-
   if (!compute_elf_range(region_pc, ddprof_mod._low_addr, dso._pgoff, elf_sym,
                          lbias, start_sym, end_sym)) {
     // elf section does not add up to something that makes sense
     // insert this PC without considering elf section
     start_sym = region_pc;
     end_sym = region_pc + 1;
-#ifdef DEBUG
-    LG_DBG("Insert: %lx,%lx -> %s,%d,%d / shndx=%d", start_sym, end_sym,
-           symbol._symname.c_str(), file_info.get_id(), symbol_idx,
-           elf_sym.st_shndx);
-#endif
-    map.emplace(start_sym, DwflSymbolVal_V2(end_sym, symbol_idx));
-    table.push_back(std::move(symbol));
-    return symbol_idx;
+  }
+  // persisted as file offsets, without the source path of the mapping.
+  // Symbols without line info would hide lines from later workers.
+  if (_line_info) {
+    _disk_cache.append(file_info.get_id(), start_sym + dso._pgoff,
+                       end_sym + dso._pgoff, symbol);
+  }
+
+  // All paths bellow will insert symbol in the table
+  SymbolIdx_t symbol_idx = table.size();
+  if (symbol._srcpath.empty()) {
+    // override with info from dso (this slightly mixes mappings and sources)
+    // But it helps a lot at Datadog (as mappings are ignored for now in UI)
+    symbol._srcpath = table.intern(dso.format_filename());
   }
 
 #ifdef DEBUG
@@ -209,6 +229,81 @@ DwflSymbolLookup_V2::insert(DwflWrapper &dwfl_wrapper, SymbolTable &table,
   return symbol_idx;
 }
 
+bool DwflSymbolLookup_V2::find_eager(DwflWrapper &dwfl_wrapper,
+                                     SymbolTable &table,
+                                     ProcessAddress_t process_pc,
+                                     const Dso &dso,
+                                     const FileInfoValue &file_info,
+                                     SymbolIdx_t &symbol_idx) {
+  auto it = _elf_symbols_map.find(file_info.get_id());
+  if (it == _elf_symbols_map.end()) {
+    ElfSymbols elf_symbols;
+    // the file is opened once for dwfl and the tables
+    const ElfCacheEntry *entry = dwfl_wrapper._elf_cache
+        ? dwfl_wrapper._elf_cache->get_or_insert(file_info.get_id(),
+                                                 file_info.get_path())
+        : nullptr;
+    elf_symbols._table.reset(new ElfSymbolTable());
+    if (!entry || !elf_symbols._table->load(entry->_elf)) {
+      LG_DBG("[ELF_SYMB] No symbol table for file %d", file_info.get_id());
+      elf_symbols._table.reset();
+    } else {
+      elf_symbols._symbol_idx.resize(elf_symbols._table->size(), -1);
+    }
+    it = _elf_symbols_map.emplace(file_info.get_id(), std::move(elf_symbols))
+             .first;
+  }
+  ElfSymbols &elf_symbols = it->second;
+  ElfAddress_t elf_addr;
+  if (!elf_symbols._table ||
+      !elf_symbols._table->offset_to_addr(
+          process_pc - dso._start + dso._pgoff, &elf_addr)) {
+    return false;
+  }
+  int elf_symbol_idx = elf_symbols._table->find(elf_addr);
+  if (elf_symbol_idx == -1) {
+    return false;
+  }
+  SymbolIdx_t &cached_idx = elf_symbols._symbol_idx[elf_symbol_idx];
+  if (cached_idx == -1) {
+    // line numbers are not read in this mode
+    const char *name = elf_symbols._table->name(elf_symbol_idx);
+    cached_idx = table.size();
+    table.push_back(Symbol(table.intern(name), InternedString(), 0,
+                           table.intern(dso.format_filename())));
+  }
+  symbol_idx = cached_idx;
+  return true;
+}
+
+void DwflSymbolLookup_V2::load_disk_cache(SymbolTable &table, const Dso &dso,
+                                          const FileInfoValue &file_info,
+                                          DwflSymbolMap &map) {
+  std::vector<SymbolCacheEntry> entries;
+  // the map is keyed by addresses within the mapping
+  Offset_t dso_size = dso._end - dso._start + 1;
+  _disk_cache.open(file_info.get_id(), file_info.get_build_id(),
+                   file_info.get_size(), dso._pgoff, dso._pgoff + dso_size,
+                   table, entries);
+  if (entries.empty()) {
+    return;
+  }
+  InternedString dso_srcpath = table.intern(dso.format_filename());
+  for (SymbolCacheEntry &entry : entries) {
+    SymbolIdx_t symbol_idx = table.size();
+    if (entry._symbol._srcpath.empty()) {
+      entry._symbol._srcpath = dso_srcpath;
+    }
+    // several workers can have appended the same symbol
+    if (map.emplace(entry._start - dso._pgoff,
+                    DwflSymbolVal_V2(entry._end - dso._pgoff, symbol_idx))
+            .second) {
+      table.push_back(std::move(entry._symbol));
+      ++_stats._disk_loaded;
+    }
+  }
+}
+
 bool DwflSymbolLookup_V2::symbol_lookup_check(Dwfl_Module *mod,
                                               Dwarf_Addr process_pc,
                                               const Symbol &symbol) {
@@ -261,6 +356,13 @@ void DwflSymbolLookupStats::display(unsigned nb_elts) const {
       LG_NTC("DWFL_SYMB | %10s | [%d/%d] = %d", "Not found", _no_dwfl_symbols,
              _calls, (_no_dwfl_symbols * k_cent_precision) / _calls);
     }
+    if (_elf_table_hits) {
+      LG_NTC("DWFL_SYMB | %10s | [%d/%d]", "Elf tables", _elf_table_hits,
+             _calls);
+    }
+    if (_disk_loaded) {
+      LG_NTC("DWFL_SYMB | %10s | %d", "Disk cache", _disk_loaded);
+    }
     LG_NTC("DWFL_SYMB | %10s | %d", "Size ", nb_elts);
   } else {
     LG_NTC("DWFL_SYMB NO CALLS");
@@ -271,6 +373,8 @@ void DwflSymbolLookupStats::reset() {
   _hit = 0;
   _calls = 0;
   _errors = 0;
+  _disk_loaded = 0;
+  _elf_table_hits = 0;
 }
 
 bool DwflSymbolLookup_V2::dwfl_symbol_is_within(
@@ -18,9 +18,9 @@ bool set_initial_registers(Dwfl_Thread *thread, void *arg) {
   Dwarf_Word regs[17] = {0};
 
   // Only 3 registers are used in the unwinding
-  regs[6] = us->initial_regs.ebp;
-  regs[7] = us->initial_regs.esp;
-  regs[16] = us->initial_regs.eip;
+  regs[6] = us->dwarf_regs.ebp;
+  regs[7] = us->dwarf_regs.esp;
+  regs[16] = us->dwarf_regs.eip;
 
   return dwfl_thread_state_registers(thread, 0, 17, regs);
 }
@@ -0,0 +1,85 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "elf_cache.hpp"
+
+extern "C" {
+#include <fcntl.h>
+#include <gelf.h>
+#include <unistd.h>
+
+#include "logger.h"
+}
+
+namespace ddprof {
+
+ElfCacheEntry::~ElfCacheEntry() {
+  if (_elf) {
+    elf_end(_elf);
+  }
+}
+
+// Address range of the loadable segments (as computed by dwfl_report_elf)
+static bool read_load_range(Elf *elf, ElfCacheEntry &entry) {
+  size_t nb_phdr;
+  if (elf_getphdrnum(elf, &nb_phdr) != 0) {
+    return false;
+  }
+  bool found = false;
+  for (size_t i = 0; i < nb_phdr; ++i) {
+    GElf_Phdr phdr;
+    if (!gelf_getphdr(elf, i, &phdr) || phdr.p_type != PT_LOAD) {
+      continue;
+    }
+    if (!found) {
+      entry._vaddr = phdr.p_vaddr & -phdr.p_align;
+      found = true;
+    }
+    entry._end_vaddr = phdr.p_vaddr + phdr.p_memsz;
+  }
+  return found;
+}
+
+const ElfCacheEntry *ElfCache::get_or_insert(FileInfoId_t file_info_id,
+                                             const std::string &path) {
+  auto it = _entries.find(file_info_id);
+  if (it != _entries.end()) {
+    return it->second.get();
+  }
+  std::unique_ptr<ElfCacheEntry> entry(new ElfCacheEntry());
+  entry->_path = path;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd != -1) {
+    entry->_elf = elf_begin(fd, ELF_C_READ_MMAP, nullptr);
+    // The image is mapped : detach the handle from the file descriptor
+    if (entry->_elf && elf_cntl(entry->_elf, ELF_C_FDREAD) != 0) {
+      elf_end(entry->_elf);
+      entry->_elf = nullptr;
+    }
+    close(fd);
+  }
+  if (!entry->_elf || elf_kind(entry->_elf) != ELF_K_ELF ||
+      !read_load_range(entry->_elf, *entry)) {
+    LG_DBG("[ELF] Unable to read %s", path.c_str());
+    entry.reset();
+  }
+  const ElfCacheEntry *result = entry.get();
+  _entries.emplace(file_info_id, std::move(entry));
+  return result;
+}
+
+void ElfCache::evict_unreferenced(
+    const std::unordered_set<FileInfoId_t> &referenced) {
+  for (auto it = _entries.begin(); it != _entries.end();) {
+    // failed files are kept (they hold no resources)
+    if (it->second && referenced.find(it->first) == referenced.end()) {
+      it = _entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+} // namespace ddprof
@@ -0,0 +1,168 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "elf_symbol_table.hpp"
+
+extern "C" {
+#include <fcntl.h>
+#include <gelf.h>
+#include <unistd.h>
+
+#include "logger.h"
+}
+
+#include "defer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+namespace ddprof {
+
+void ElfSymbolTable::add_symbol(ElfAddress_t start, uint64_t size,
+                                const char *name) {
+  size_t name_len = strlen(name);
+  if (_names.size() + name_len + 1 > std::numeric_limits<uint32_t>::max()) {
+    return;
+  }
+  uint32_t size_32 = static_cast<uint32_t>(
+      std::min<uint64_t>(size, std::numeric_limits<uint32_t>::max()));
+  _entries.push_back(
+      ElfSymbolEntry{start, size_32, static_cast<uint32_t>(_names.size())});
+  _names.insert(_names.end(), name, name + name_len + 1);
+}
+
+void ElfSymbolTable::sort() {
+  // for aliases (same start), keep the largest
+  std::sort(_entries.begin(), _entries.end(),
+            [](const ElfSymbolEntry &lhs, const ElfSymbolEntry &rhs) {
+              return lhs._start < rhs._start ||
+                  (lhs._start == rhs._start && lhs._size > rhs._size);
+            });
+  _entries.erase(std::unique(_entries.begin(), _entries.end(),
+                             [](const ElfSymbolEntry &lhs,
+                                const ElfSymbolEntry &rhs) {
+                               return lhs._start == rhs._start;
+                             }),
+                 _entries.end());
+  for (size_t i = 0; i + 1 < _entries.size(); ++i) {
+    if (!_entries[i]._size) {
+      _entries[i]._size = static_cast<uint32_t>(std::min<uint64_t>(
+          _entries[i + 1]._start - _entries[i]._start,
+          std::numeric_limits<uint32_t>::max()));
+    }
+  }
+  _entries.shrink_to_fit();
+  _names.shrink_to_fit();
+}
+
+void ElfSymbolTable::add_segment(Offset_t offset, ElfAddress_t addr,
+                                 uint64_t size) {
+  _segments.push_back({offset, addr, size});
+}
+
+bool ElfSymbolTable::offset_to_addr(Offset_t offset,
+                                    ElfAddress_t *addr) const {
+  for (const Segment &segment : _segments) {
+    if (offset >= segment.offset && offset < segment.offset + segment.size) {
+      *addr = offset - segment.offset + segment.addr;
+      return true;
+    }
+  }
+  return false;
+}
+
+int ElfSymbolTable::find(ElfAddress_t addr) const {
+  if (_entries.empty() || addr < _entries[0]._start) {
+    return -1;
+  }
+  // branchless : the loop only depends on the size
+  const ElfSymbolEntry *base = _entries.data();
+  size_t nb_elts = _entries.size();
+  while (nb_elts > 1) {
+    size_t half = nb_elts / 2;
+    base = base[half]._start <= addr ? base + half : base;
+    nb_elts -= half;
+  }
+  if (addr - base->_start >= base->_size) {
+    return -1;
+  }
+  return static_cast<int>(base - _entries.data());
+}
+
+bool ElfSymbolTable::load(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    LG_DBG("[ELF_SYMB] Unable to open %s", path.c_str());
+    return false;
+  }
+  defer { close(fd); };
+  Elf *elf = elf_begin(fd, ELF_C_READ_MMAP, nullptr);
+  if (!elf) {
+    LG_DBG("[ELF_SYMB] Invalid elf %s", path.c_str());
+    return false;
+  }
+  defer { elf_end(elf); };
+  return load(elf);
+}
+
+bool ElfSymbolTable::load(Elf *elf) {
+  size_t nb_phdr;
+  if (elf_getphdrnum(elf, &nb_phdr) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < nb_phdr; ++i) {
+    GElf_Phdr phdr;
+    if (gelf_getphdr(elf, i, &phdr) && phdr.p_type == PT_LOAD &&
+        (phdr.p_flags & PF_X)) {
+      add_segment(phdr.p_offset, phdr.p_vaddr, phdr.p_filesz);
+    }
+  }
+  // .dynsym only holds exported symbols : used when the file is stripped
+  if (!load_symbols(elf, SHT_SYMTAB) || _entries.empty()) {
+    load_symbols(elf, SHT_DYNSYM);
+  }
+  if (_entries.empty()) {
+    LG_DBG("[ELF_SYMB] No symbols");
+    return false;
+  }
+  sort();
+  return true;
+}
+
+bool ElfSymbolTable::load_symbols(Elf *elf, uint32_t section_type) {
+  Elf_Scn *scn = nullptr;
+  while ((scn = elf_nextscn(elf, scn)) != nullptr) {
+    GElf_Shdr shdr;
+    if (!gelf_getshdr(scn, &shdr) || shdr.sh_type != section_type ||
+        !shdr.sh_entsize) {
+      continue;
+    }
+    Elf_Data *data = elf_getdata(scn, nullptr);
+    if (!data) {
+      return false;
+    }
+    size_t nb_syms = shdr.sh_size / shdr.sh_entsize;
+    for (size_t i = 0; i < nb_syms; ++i) {
+      GElf_Sym sym;
+      if (!gelf_getsym(data, i, &sym)) {
+        continue;
+      }
+      int type = GELF_ST_TYPE(sym.st_info);
+      if ((type != STT_FUNC && type != STT_GNU_IFUNC) ||
+          sym.st_shndx == SHN_UNDEF || !sym.st_value) {
+        continue;
+      }
+      const char *name = elf_strptr(elf, shdr.sh_link, sym.st_name);
+      if (name && *name) {
+        add_symbol(sym.st_value, sym.st_size, name);
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+} // namespace ddprof
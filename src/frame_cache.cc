@@ -0,0 +1,62 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "frame_cache.hpp"
+
+extern "C" {
+#include "logger.h"
+}
+
+namespace ddprof {
+
+// 4096 entries of 32 bytes : fits in L2 caches
+static const unsigned k_frame_cache_bits = 12;
+
+void FrameCacheStats::display() const {
+  uint64_t calls = _hits + _misses;
+  if (calls) {
+    LG_NTC("FRAME_CACHE | %10s | %lu / %lu (%.1f%%)", "HITS", _hits, calls,
+           (100.0 * _hits) / calls);
+  }
+}
+
+FrameCache::FrameCache() : _entries(1 << k_frame_cache_bits) {}
+
+unsigned FrameCache::index(pid_t pid, ProcessAddress_t pc) {
+  uint64_t key = pc ^ (static_cast<uint64_t>(pid) << 32);
+  // multiplicative hashing : high bits depend on all bits of the key
+  return (key * 0x9e3779b97f4a7c15ULL) >> (64 - k_frame_cache_bits);
+}
+
+bool FrameCache::find(pid_t pid, ProcessAddress_t pc, uint64_t generation,
+                      SymbolIdx_t *symbol_idx, MapInfoIdx_t *map_info_idx) {
+  const Entry &entry = _entries[index(pid, pc)];
+  if (entry.pc != pc || entry.pid != pid || entry.generation != generation) {
+    ++_stats._misses;
+    return false;
+  }
+  ++_stats._hits;
+  *symbol_idx = entry.symbol_idx;
+  *map_info_idx = entry.map_info_idx;
+  return true;
+}
+
+void FrameCache::insert(pid_t pid, ProcessAddress_t pc, uint64_t generation,
+                        SymbolIdx_t symbol_idx, MapInfoIdx_t map_info_idx) {
+  Entry &entry = _entries[index(pid, pc)];
+  entry.pc = pc;
+  entry.generation = generation;
+  entry.pid = pid;
+  entry.symbol_idx = symbol_idx;
+  entry.map_info_idx = map_info_idx;
+}
+
+void FrameCache::clear() {
+  for (Entry &entry : _entries) {
+    entry = Entry();
+  }
+}
+
+} // namespace ddprof
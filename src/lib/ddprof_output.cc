@@ -17,9 +17,8 @@ namespace ddprof {
 
 const Symbol &get_symbol(const DDProfContext *ctx,
                          const UnwindOutput *unwind_output, unsigned loc_idx) {
-  const SymbolTable &symbol_table =
-      ctx->worker_ctx.us->symbol_hdr._symbol_table;
-  return symbol_table[unwind_output->locs[loc_idx]._symbol_idx];
+  SymbolTable &symbol_table = ctx->worker_ctx.us->symbol_hdr._symbol_table;
+  return symbol_table.demangled(unwind_output->locs[loc_idx]._symbol_idx);
 }
 
 const MapInfo &get_mapinfo(const DDProfContext *ctx,
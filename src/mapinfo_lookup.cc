@@ -7,22 +7,24 @@
 
 #include "ddres.h"
 
+#include <string.h>
+
 namespace ddprof {
 
 MapInfoIdx_t MapInfoLookup::get_or_insert(pid_t pid,
                                           MapInfoTable &mapinfo_table,
-                                          const Dso &dso) {
+                                          const Dso &dso,
+                                          const BuildId &build_id) {
   MapInfoAddrMap &addr_map = _mapinfo_pidmap[pid];
   auto it = addr_map.find(dso._start);
 
   if (it == addr_map.end()) { // create a mapinfo from dso element
-    size_t pos = dso._filename.rfind('/');
-    std::string sname_str = (pos == std::string::npos)
-        ? dso._filename
-        : dso._filename.substr(pos + 1);
+    const char *sname = strrchr(dso._filename.c_str(), '/');
+    sname = sname ? sname + 1 : dso._filename.c_str();
     MapInfoIdx_t map_info_idx = mapinfo_table.size();
-    mapinfo_table.emplace_back(dso._start, dso._end, dso._pgoff,
-                               std::move(sname_str));
+    mapinfo_table.push_back(MapInfo(dso._start, dso._end, dso._pgoff,
+                                    mapinfo_table.intern(sname),
+                                    mapinfo_table.intern(build_id)));
     addr_map.emplace(dso._start, map_info_idx);
     return map_info_idx;
   } else {
@@ -22,8 +22,6 @@
 
 #define DEFAULT_PAGE_SIZE 4096 // Concerned about hugepages?
 
-#define DEFAULT_BUFF_SIZE_SHIFT 6
-
 static long s_page_size = 0;
 
 struct perf_event_attr g_dd_native_attr = {
@@ -60,7 +58,8 @@ int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int gfd,
   return syscall(__NR_perf_event_open, attr, pid, cpu, gfd, flags);
 }
 
-int perfopen(pid_t pid, const PerfOption *opt, int cpu, bool extras) {
+int perfopen(pid_t pid, const PerfOption *opt, int cpu, bool extras,
+             uint32_t wakeup_watermark) {
   struct perf_event_attr attr = g_dd_native_attr;
   attr.type = opt->type;
   attr.config = opt->config;
@@ -82,6 +81,12 @@ int perfopen(pid_t pid, const PerfOption *opt, int cpu, bool extras) {
     attr.comm = 1;
   }
 
+  // Batch wakeups : only notify once the buffer holds enough data
+  if (wakeup_watermark) {
+    attr.watermark = 1;
+    attr.wakeup_watermark = wakeup_watermark;
+  }
+
   int fd = perf_event_open(&attr, pid, cpu, -1, PERF_FLAG_FD_CLOEXEC);
   if (-1 == fd && EACCES == errno) {
     return -1;
@@ -122,8 +127,8 @@ void *perfown_sz(int fd, size_t size_of_buffer) {
 
 // returns region, size is updated with the mmaped size
 // On failure, returns NULL
-void *perfown(int fd, size_t *size) {
-  *size = perf_mmap_size(DEFAULT_BUFF_SIZE_SHIFT);
+void *perfown(int fd, int buf_size_shift, size_t *size) {
+  *size = perf_mmap_size(buf_size_shift);
   return perfown_sz(fd, *size);
 }
 
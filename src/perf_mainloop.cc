@@ -11,6 +11,7 @@
 #include <poll.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/mman.h>
 #include <sys/signalfd.h>
 #include <sys/socket.h>
@@ -21,15 +22,23 @@
 
 extern "C" {
 #include "ddprof_context_lib.h"
+#include "ddprof_stats.h"
 #include "ddprof_worker.h"
 #include "ddres.h"
 #include "logger.h"
 #include "perf.h"
+#include "perf_ringbuffer.h"
 #include "pevent.h"
+#include "pevent_lib.h"
+#include "producer_linearizer.h"
 #include "unwind.h"
 }
 
 #include "defer.hpp"
+#include "unwind_pipeline.hpp"
+#include "worker_shard.hpp"
+
+#include <vector>
 
 #define rmb() __asm__ volatile("lfence" ::: "memory")
 
@@ -37,7 +46,8 @@ static pid_t g_child_pid = 0;
 static bool g_termination_requested = false;
 
 static inline int64_t now_nanos() {
-  static struct timeval tv = {};
+  // not static : called from the draining threads
+  struct timeval tv = {};
   gettimeofday(&tv, NULL);
   return (tv.tv_sec * 1000000 + tv.tv_usec) * 1000;
 }
@@ -116,13 +126,17 @@ DDRes spawn_workers(MLWorkerFlags *flags, bool *is_worker) {
 
 static void pollfd_setup(const PEventHdr *pevent_hdr, struct pollfd *pfd,
                          int *pfd_len) {
-  *pfd_len = pevent_hdr->size;
+  *pfd_len = 0;
   const PEvent *pes = pevent_hdr->pes;
   // Setup poll() to watch perf_event file descriptors
-  for (int i = 0; i < *pfd_len; ++i) {
-    // NOTE: if fd is negative, it will be ignored
-    pfd[i].fd = pes[i].fd;
-    pfd[i].events = POLLIN | POLLERR | POLLHUP;
+  // Events redirected to another ring buffer are woken up with its owner
+  for (size_t i = 0; i < pevent_hdr->size; ++i) {
+    if (!pes[i].rb.region) {
+      continue;
+    }
+    pfd[*pfd_len].fd = pes[i].fd;
+    pfd[*pfd_len].events = POLLIN | POLLERR | POLLHUP;
+    ++(*pfd_len);
   }
 }
 
@@ -142,46 +156,270 @@ static DDRes signalfd_setup(pollfd *pfd) {
   return {};
 }
 
-static inline DDRes worker_process_ring_buffers(PEvent *pes, int pe_len,
+// Persistent epoll set over the poll descriptors (perf feeds and signal fd).
+// The position in pfd is kept as event data.
+static DDRes epoll_setup(const pollfd *pfd, int pfd_len, int *epfd) {
+  *epfd = epoll_create1(EPOLL_CLOEXEC);
+  DDRES_CHECK_ERRNO(*epfd, DD_WHAT_WORKERLOOP_INIT, "Could not create epoll");
+  for (int i = 0; i < pfd_len; ++i) {
+    if (pfd[i].fd < 0) {
+      continue;
+    }
+    // errors and hang ups are always reported
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    DDRES_CHECK_ERRNO(epoll_ctl(*epfd, EPOLL_CTL_ADD, pfd[i].fd, &ev),
+                      DD_WHAT_WORKERLOOP_INIT,
+                      "Could not add fd=%d to epoll (idx#%d)", pfd[i].fd, i);
+  }
+  return {};
+}
+
+// Wait for perf events, using the epoll set if there is one.
+// stop is set on termination signal, or if the kernel closed a perf feed.
+static DDRes worker_wait(int epfd, pollfd *pfd, int pfd_len, int signal_pos,
+                         std::vector<epoll_event> &events, bool *stop) {
+  ddprof_stats_add(STATS_WORKER_WAITS, 1, NULL);
+  int n;
+  if (epfd == -1) {
+    n = poll(pfd, pfd_len, PSAMPLE_DEFAULT_WAKEUP_MS);
+  } else {
+    n = epoll_wait(epfd, events.data(), events.size(),
+                   PSAMPLE_DEFAULT_WAKEUP_MS);
+  }
+
+  // If there was an issue, return and let the caller check errno
+  if (-1 == n && errno == EINTR) {
+    return {};
+  }
+  DDRES_CHECK_ERRNO(n, DD_WHAT_POLLERROR, "poll failed");
+  if (!n) {
+    ddprof_stats_add(STATS_WORKER_WAIT_TIMEOUTS, 1, NULL);
+    return {};
+  }
+
+  if (epfd == -1) {
+    if (pfd[signal_pos].revents & POLLIN) {
+      LG_NFO("Received termination signal");
+      *stop = true;
+    }
+    // If one of the perf_event_open() feeds was closed by the kernel, shut
+    // down profiling
+    if (std::any_of(pfd, pfd + pfd_len, [](pollfd &x) {
+          return x.revents & (POLLHUP | POLLERR);
+        })) {
+      *stop = true;
+    }
+    return {};
+  }
+
+  for (int i = 0; i < n; ++i) {
+    if (static_cast<int>(events[i].data.u32) == signal_pos) {
+      LG_NFO("Received termination signal");
+      *stop = true;
+    } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+      *stop = true;
+    }
+  }
+  return {};
+}
+
+static inline DDRes worker_dispatch_event(const RecordView *view, int pos,
+                                          DDProfContext *ctx,
+                                          WorkerShard *shard) {
+  if (shard) {
+    return ddprof::worker_shard_process_event(view, pos, ctx, shard);
+  }
+  if (ctx->worker_ctx.pipeline) {
+    // copy to the queue, unwinding happens in a separate thread
+    return ctx->worker_ctx.pipeline->push_event(view, pos);
+  }
+  return ddprof_worker_process_view(view, pos, ctx);
+}
+
+// Per pass, a ring buffer yields at most this many events or bytes : a busy
+// CPU can not use the whole time budget while other buffers overflow, and
+// the records held for reordering are bounded
+static const int s_drain_max_events = 64;
+static const uint64_t s_drain_max_bytes = 256 * 1024;
+
+static inline void record_fill(PEvent *pe, uint64_t fill) {
+  if (fill > pe->max_fill) {
+    pe->max_fill = fill;
+  }
+  uint64_t data_size = pe->rb.mask + 1;
+  uint64_t bucket = fill * PEVENT_FILL_BUCKETS / data_size;
+  ++pe->fill_hist[std::min<uint64_t>(bucket, PEVENT_FILL_BUCKETS - 1)];
+}
+
+// Drain state of a ring buffer within a pass
+struct RbCursor {
+  int pe_idx;      // index in pes
+  uint64_t head;   // data_head read at the start of the pass
+  uint64_t start;  // data_tail at the start of the pass
+  uint64_t tail;   // offset of the next record
+  int nb_events;   // events processed in the pass
+  RecordView view; // next record
+};
+
+// Orders the next records of the ring buffers by timestamp
+struct RecordMerger {
+  ProducerLinearizer pl = {};
+  ~RecordMerger() { ProducerLinearizer_free(&pl); }
+};
+
+static inline void rb_cursor_push(RbCursor &cursor, uint64_t slot, PEvent *pes,
+                                  ProducerLinearizer *pl) {
+  rb_seek_view(&pes[cursor.pe_idx].rb, cursor.tail, DEFAULT_SAMPLE_TYPE,
+               &cursor.view);
+  ProducerLinearizer_push(pl, slot,
+                          hdr_time(cursor.view.hdr, DEFAULT_SAMPLE_TYPE));
+}
+
+static inline bool rb_cursor_over_budget(const RbCursor &cursor) {
+  return cursor.nb_events >= s_drain_max_events ||
+      cursor.tail - cursor.start >= s_drain_max_bytes;
+}
+
+// A buffer in the last quarter of its fill histogram is close to losing
+// events : it is drained before ordering is considered
+static inline bool rb_fill_urgent(const PEvent *pe, uint64_t fill) {
+  uint64_t data_size = pe->rb.mask + 1;
+  return fill * PEVENT_FILL_BUCKETS >= data_size * (PEVENT_FILL_BUCKETS - 1);
+}
+
+// Process the current record of the cursor and move to the next one
+static inline DDRes rb_cursor_dispatch(RbCursor &cursor, PEvent *pes,
+                                       DDProfContext *ctx,
+                                       WorkerShard *shard) {
+  ++cursor.nb_events;
+
+  // Attempt to dispatch the event
+  // Samples are read in place, even when they wrap around the buffer
+  struct perf_event_header *hdr = cursor.view.hdr;
+  PEvent *pe = &pes[cursor.pe_idx];
+  int pos = pe->pos;
+  if (pe->shared_rb) {
+    // Find the watcher of the record
+    pos = pevent_pos_from_id(&ctx->worker_ctx.pevent_hdr,
+                             hdr_id(hdr, DEFAULT_SAMPLE_TYPE), pos);
+  }
+  DDRes res = worker_dispatch_event(&cursor.view, pos, ctx, shard);
+
+  // We've processed the current event, so we can advance the ringbuffer
+  cursor.tail += hdr->size;
+  return res;
+}
+
+// Drain the ring buffers listed in pe_idx. Events are processed within the
+// given shard, or directly by the worker if it is null.
+// Buffers are drained in passes : each of them yields a bounded amount of
+// events per pass. Fill level has priority over ordering : buffers above the
+// high watermark (last fill quarter) are drained first, fullest first.
+// The events of the other buffers are merged in timestamp order (so that
+// mmap / fork events are processed before the samples of other CPUs that
+// depend on them). The per buffer budget bounds the reorder window.
+static inline DDRes worker_process_ring_buffers(PEvent *pes,
+                                                const std::vector<int> &pe_idx,
                                                 DDProfContext *ctx,
+                                                WorkerShard *shard,
                                                 int64_t *now_ns) {
   // While there are events to process, iterate through them
   // while limiting time spent in loop to at most PSAMPLE_DEFAULT_WAKEUP_MS
   int64_t loop_start_ns = now_nanos();
   int64_t local_now_ns = loop_start_ns;
 
+  // Buffers with pending events in the current pass
+  static thread_local std::vector<RbCursor> cursors;
+  static thread_local std::vector<RbCursor> urgent_cursors;
+  static thread_local RecordMerger merger;
+  ProducerLinearizer *pl = &merger.pl;
+  if (pl->sz < pe_idx.size()) {
+    ProducerLinearizer_free(pl);
+    if (!ProducerLinearizer_init(pl, pe_idx.size())) {
+      DDRES_RETURN_ERROR_LOG(DD_WHAT_BADALLOC,
+                             "Unable to allocate record merger");
+    }
+  }
+
   bool events;
   do {
     events = false;
-    for (int i = 0; i < pe_len; ++i) {
+    cursors.clear();
+    urgent_cursors.clear();
+    for (int i : pe_idx) {
       RingBuffer *rb = &pes[i].rb;
 
       // Memory-ordering safe access of ringbuffer elements:
       // https://github.com/torvalds/linux/blob/v5.16/tools/include/linux/ring_buffer.h#L59
       uint64_t head = __atomic_load_n(&rb->region->data_head, __ATOMIC_ACQUIRE);
       uint64_t tail = rb->region->data_tail;
+      record_fill(&pes[i], head - tail);
+      if (head == tail) {
+        continue;
+      }
+      if (rb_fill_urgent(&pes[i], head - tail)) {
+        urgent_cursors.push_back({i, head, tail, tail, 0, {}});
+      } else {
+        cursors.push_back({i, head, tail, tail, 0, {}});
+      }
+    }
 
-      while (tail != head) {
+    DDRes res = {};
+    // Fullest buffers are the closest to losing events
+    std::sort(urgent_cursors.begin(), urgent_cursors.end(),
+              [](const RbCursor &lhs, const RbCursor &rhs) {
+                return lhs.head - lhs.start > rhs.head - rhs.start;
+              });
+    for (RbCursor &cursor : urgent_cursors) {
+      while (cursor.tail != cursor.head && !rb_cursor_over_budget(cursor)) {
         events = true;
-
-        // Attempt to dispatch the event
-        struct perf_event_header *hdr = rb_seek(rb, tail);
-        DDRes res = ddprof_worker_process_event(hdr, pes[i].pos, ctx);
-
-        // We've processed the current event, so we can advance the ringbuffer
-        tail += hdr->size;
-
-        // Check for processing error
+        rb_seek_view(&pes[cursor.pe_idx].rb, cursor.tail, DEFAULT_SAMPLE_TYPE,
+                     &cursor.view);
+        res = rb_cursor_dispatch(cursor, pes, ctx, shard);
         if (IsDDResNotOK(res)) {
-          __atomic_store_n(&rb->region->data_tail, tail, __ATOMIC_RELEASE);
-          return res;
+          break;
         }
       }
+      if (IsDDResNotOK(res)) {
+        break;
+      }
+    }
 
-      if (events) {
-        __atomic_store_n(&rb->region->data_tail, tail, __ATOMIC_RELEASE);
+    if (IsDDResOK(res)) {
+      for (uint64_t k = 0; k < cursors.size(); ++k) {
+        rb_cursor_push(cursors[k], k, pes, pl);
       }
     }
+    uint64_t k;
+    while (ProducerLinearizer_pop(pl, &k)) {
+      RbCursor &cursor = cursors[k];
+      // Remaining records are more recent than this one : the pass is over
+      if (rb_cursor_over_budget(cursor)) {
+        break;
+      }
+      events = true;
+      res = rb_cursor_dispatch(cursor, pes, ctx, shard);
+
+      // Check for processing error
+      if (IsDDResNotOK(res)) {
+        break;
+      }
+      if (cursor.tail != cursor.head) {
+        rb_cursor_push(cursor, k, pes, pl);
+      }
+    }
+    // Leave the merger empty for the next pass
+    while (ProducerLinearizer_pop(pl, &k)) {}
+
+    for (const std::vector<RbCursor> *pass : {&urgent_cursors, &cursors}) {
+      for (const RbCursor &cursor : *pass) {
+        __atomic_store_n(&pes[cursor.pe_idx].rb.region->data_tail, cursor.tail,
+                         __ATOMIC_RELEASE);
+      }
+    }
+    DDRES_CHECK_FWD(res);
 
     local_now_ns = now_nanos();
   } while (events &&
@@ -192,50 +430,82 @@ static inline DDRes worker_process_ring_buffers(PEvent *pes, int pe_len,
   return {};
 }
 
+static DDRes worker_process_shards(PEvent *pes, DDProfContext *ctx,
+                                   int64_t *now_ns) {
+  WorkerShardPool *pool = ctx->worker_ctx.shard_pool;
+  DDRes res = pool->run([&](WorkerShard &shard) {
+    return worker_process_ring_buffers(pes, shard._pevent_idx, ctx, &shard,
+                                       &shard._now_ns);
+  });
+  // Whatever the result, samples are aggregated from this thread
+  DDRES_CHECK_FWD(ddprof::worker_shard_aggregate(ctx));
+  DDRES_CHECK_FWD(res);
+  *now_ns = 0;
+  for (const std::unique_ptr<WorkerShard> &shard : pool->_shards) {
+    *now_ns = std::max(*now_ns, shard->_now_ns);
+  }
+  return {};
+}
+
 static DDRes worker_loop(DDProfContext *ctx, const WorkerAttr *attr,
                          bool *restart_worker) {
 
+  // Perform user-provided initialization (maps the ring buffers)
+  defer { attr->finish_fun(ctx); };
+  DDRES_CHECK_FWD(attr->init_fun(ctx));
+
   // Setup poll() to watch perf_event file descriptors
   int pe_len = ctx->worker_ctx.pevent_hdr.size;
   // one extra slot in pfd to accomodate for signal fd
-  struct pollfd pfd[MAX_NB_WATCHERS + 1];
+  std::vector<pollfd> pfd_storage(pe_len + 1);
+  pollfd *pfd = pfd_storage.data();
   int pfd_len = 0;
   pollfd_setup(&ctx->worker_ctx.pevent_hdr, pfd, &pfd_len);
 
   DDRES_CHECK_FWD(signalfd_setup(&pfd[pfd_len]));
   int signal_pos = pfd_len++;
 
-  // Perform user-provided initialization
-  defer { attr->finish_fun(ctx); };
-  DDRES_CHECK_FWD(attr->init_fun(ctx));
-
-  // Worker poll loop
-  while (true) {
-    int n = poll(pfd, pfd_len, PSAMPLE_DEFAULT_WAKEUP_MS);
+  // With batched wakeups, a persistent epoll set avoids passing every fd to
+  // the kernel on each wait
+  int epfd = -1;
+  defer {
+    if (epfd != -1) {
+      close(epfd);
+    }
+  };
+  std::vector<epoll_event> events;
+  if (ctx->params.wakeup_watermark_pct) {
+    DDRES_CHECK_FWD(epoll_setup(pfd, pfd_len, &epfd));
+    events.resize(pfd_len);
+  }
 
-    // If there was an issue, return and let the caller check errno
-    if (-1 == n && errno == EINTR) {
-      continue;
+  // Only drain the events owning a ring buffer
+  std::vector<int> pe_idx;
+  for (int i = 0; i < pe_len; ++i) {
+    if (ctx->worker_ctx.pevent_hdr.pes[i].rb.region) {
+      pe_idx.push_back(i);
     }
-    DDRES_CHECK_ERRNO(n, DD_WHAT_POLLERROR, "poll failed");
+  }
 
-    if (pfd[signal_pos].revents & POLLIN) {
-      LG_NFO("Received termination signal");
+  // Worker poll loop
+  while (true) {
+    bool stop = false;
+    DDRES_CHECK_FWD(
+        worker_wait(epfd, pfd, pfd_len, signal_pos, events, &stop));
+    if (stop) {
       break;
     }
 
     // Convenience structs
     PEvent *pes = ctx->worker_ctx.pevent_hdr.pes;
 
-    // If one of the perf_event_open() feeds was closed by the kernel, shut down
-    // profiling
-    if (std::any_of(pfd, pfd + pe_len,
-                    [&](pollfd &x) { return x.revents & POLLHUP; })) {
-      break;
-    }
-
     int64_t now_ns = 0;
-    DDRES_CHECK_FWD(worker_process_ring_buffers(pes, pe_len, ctx, &now_ns));
+    if (ctx->worker_ctx.shard_pool) {
+      DDRES_CHECK_FWD(worker_process_shards(pes, ctx, &now_ns));
+    } else {
+      DDRES_CHECK_FWD(
+          worker_process_ring_buffers(pes, pe_idx, ctx, nullptr, &now_ns));
+    }
     DDRES_CHECK_FWD(ddprof_worker_maybe_export(ctx, now_ns, restart_worker));
 
     if (*restart_worker) {
@@ -254,6 +524,7 @@ static void worker(DDProfContext *ctx, const WorkerAttr *attr,
   bool restart_worker = false;
   flags->restart_worker = false;
   flags->errors = true;
+  ctx->worker_ctx.buf_size_shift = flags->buf_size_shift;
 
   DDRes res = worker_loop(ctx, attr, &restart_worker);
   if (IsDDResFatal(res)) {
@@ -266,6 +537,9 @@ static void worker(DDProfContext *ctx, const WorkerAttr *attr,
     LG_NFO("Shutting down worker gracefully");
     flags->restart_worker = restart_worker;
     flags->errors = false;
+    if (ctx->params.adaptive_buffer) {
+      flags->buf_size_shift = ddprof_worker_next_buf_size_shift(ctx);
+    }
   }
 }
 
@@ -7,6 +7,7 @@
 
 #include <stdlib.h>
 
+#include "arraysize.h"
 #include "logger.h"
 
 bool rb_init(RingBuffer *rb, struct perf_event_mmap_page *page, size_t size) {
@@ -35,6 +36,12 @@ bool rb_init(RingBuffer *rb, struct perf_event_mmap_page *page, size_t size) {
   return true;
 }
 
+void record_view_init(RecordView *view, struct perf_event_header *hdr) {
+  view->hdr = hdr;
+  view->wrap = NULL;
+  view->split = hdr->size;
+}
+
 void rb_clear(RingBuffer *rb) { memset(rb, 0, sizeof(*rb)); }
 void rb_free(RingBuffer *rb) {
   if (rb->wrbuf)
@@ -68,6 +75,30 @@ struct perf_event_header *rb_seek(RingBuffer *rb, uint64_t offset) {
   return ret;
 }
 
+void rb_seek_view(RingBuffer *rb, uint64_t offset, uint64_t mask,
+                  RecordView *view) {
+  rb->offset = (unsigned long)offset & (rb->mask);
+  struct perf_event_header *hdr =
+      (struct perf_event_header *)(rb->start + rb->offset);
+  uint64_t left_sz = rb->size - rb->meta_size - rb->offset;
+  if (left_sz >= hdr->size) {
+    record_view_init(view, hdr);
+    return;
+  }
+
+  // The stack is most of the sample : keep it in place if the fields before it
+  // are contiguous
+  uint64_t stack_offset = sample_stack_offset(mask);
+  if (hdr->type == PERF_RECORD_SAMPLE && stack_offset &&
+      left_sz >= stack_offset) {
+    view->hdr = hdr;
+    view->wrap = rb->start;
+    view->split = left_sz;
+    return;
+  }
+  record_view_init(view, rb_seek(rb, offset));
+}
+
 // This union is an implementation trick to make splitting apart an 8-byte
 // aligned block into two 4-byte blocks easier
 typedef union flipper {
@@ -190,9 +221,48 @@ bool samp2hdr(struct perf_event_header *hdr, perf_event_sample *sample,
   return true;
 }
 
+// Folded at compile time when val is a constant
+inline static int get_bits(uint64_t val) { return __builtin_popcountll(val); }
+
+uint64_t sample_stack_offset(uint64_t mask) {
+  if (!(mask & PERF_SAMPLE_STACK_USER))
+    return 0;
+  // Fields of variable size
+  if (mask &
+      (PERF_SAMPLE_READ | PERF_SAMPLE_CALLCHAIN | PERF_SAMPLE_RAW |
+       PERF_SAMPLE_BRANCH_STACK))
+    return 0;
+  uint64_t nb_words = get_bits(
+      mask &
+      (PERF_SAMPLE_IDENTIFIER | PERF_SAMPLE_IP | PERF_SAMPLE_TID |
+       PERF_SAMPLE_TIME | PERF_SAMPLE_ADDR | PERF_SAMPLE_ID |
+       PERF_SAMPLE_STREAM_ID | PERF_SAMPLE_CPU | PERF_SAMPLE_PERIOD));
+  if (mask & PERF_SAMPLE_REGS_USER)
+    nb_words += 1 + PERF_REGS_COUNT;
+  // size of the stack
+  nb_words += 1;
+  return sizeof(struct perf_event_header) + nb_words * sizeof(uint64_t);
+}
+
 perf_event_sample *hdr2samp(struct perf_event_header *hdr, uint64_t mask) {
-  static perf_event_sample sample = {0};
-  memset(&sample, 0, sizeof(sample));
+  RecordView view;
+  record_view_init(&view, hdr);
+  return view2samp(&view, mask);
+}
+
+// Decoders are written for any mask, then instantiated with the masks we
+// configure : as mask is a constant there, the field checks and offsets are
+// resolved at compile time.
+#define DECODER_INLINE static inline __attribute__((always_inline))
+
+// Only the user stack can be split (refer to rb_seek_view)
+DECODER_INLINE perf_event_sample *view2samp_impl(const RecordView *view,
+                                                 uint64_t mask) {
+  // thread local : ring buffers can be drained from several threads
+  // Fields absent from the mask are zeroed one by one : with a constant mask
+  // this only clears what the decoder does not write.
+  static __thread perf_event_sample sample = {0};
+  struct perf_event_header *hdr = view->hdr;
 
   sample.header = *hdr;
 
@@ -200,49 +270,82 @@ perf_event_sample *hdr2samp(struct perf_event_header *hdr, uint64_t mask) {
 
   if (PERF_SAMPLE_IDENTIFIER & mask) {
     sample.sample_id = *buf++;
+  } else {
+    sample.sample_id = 0;
   }
   if (PERF_SAMPLE_IP & mask) {
     sample.ip = *buf++;
+  } else {
+    sample.ip = 0;
   }
   if (PERF_SAMPLE_TID & mask) {
     sample.pid = ((flipper *)buf)->half[0];
     sample.tid = ((flipper *)buf)->half[1];
     buf++;
+  } else {
+    sample.pid = 0;
+    sample.tid = 0;
   }
   if (PERF_SAMPLE_TIME & mask) {
     sample.time = *buf++;
+  } else {
+    sample.time = 0;
   }
   if (PERF_SAMPLE_ADDR & mask) {
     sample.addr = *buf++;
+  } else {
+    sample.addr = 0;
   }
   if (PERF_SAMPLE_ID & mask) {
     sample.id = *buf++;
+  } else {
+    sample.id = 0;
   }
   if (PERF_SAMPLE_STREAM_ID & mask) {
     sample.stream_id = *buf++;
+  } else {
+    sample.stream_id = 0;
   }
   if (PERF_SAMPLE_CPU & mask) {
     sample.cpu = ((flipper *)buf)->half[0];
     sample.res = ((flipper *)buf)->half[1];
     buf++;
+  } else {
+    sample.cpu = 0;
+    sample.res = 0;
   }
   if (PERF_SAMPLE_PERIOD & mask) {
     sample.period = *buf++;
+  } else {
+    sample.period = 0;
   }
   if (PERF_SAMPLE_READ & mask) {
     sample.v = (struct read_format *)buf++;
+  } else {
+    sample.v = NULL;
   }
   if (PERF_SAMPLE_CALLCHAIN & mask) {
     sample.nr = *buf++;
     sample.ips = buf;
     buf += sample.nr;
+  } else {
+    sample.nr = 0;
+    sample.ips = NULL;
   }
+  // Not decoded
+  sample.size_raw = 0;
+  sample.data_raw = NULL;
+  sample.bnr = 0;
+  sample.lbr = NULL;
   if (PERF_SAMPLE_RAW & mask) {}
   if (PERF_SAMPLE_BRANCH_STACK & mask) {}
   if (PERF_SAMPLE_REGS_USER & mask) {
     sample.abi = *buf++;
     sample.regs = buf;
     buf += PERF_REGS_COUNT;
+  } else {
+    sample.abi = 0;
+    sample.regs = NULL;
   }
   if (PERF_SAMPLE_STACK_USER & mask) {
     uint64_t size_stack = *buf++;
@@ -250,24 +353,61 @@ perf_event_sample *hdr2samp(struct perf_event_header *hdr, uint64_t mask) {
     // Empirically, it seems that the size of the static stack is either 0 or
     // the amount requested in the call to `perf_event_open()`.  We don't check
     // for that, since there isn't much we'd be able to do anyway.
+    sample.data_stack_wrap = NULL;
     if (size_stack == 0) {
       sample.size_stack = 0;
+      sample.size_stack_head = 0;
       sample.dyn_size_stack = 0;
       sample.data_stack = NULL;
     } else {
       uint64_t dynsz_stack = 0;
-      sample.data_stack = (char *)buf;
-      buf += ((size_stack + 0x7UL) & ~0x7UL) / 8; // align (/8 as it is uint64)
+      uint64_t stack_offset = (char *)buf - (char *)hdr;
+      uint64_t aligned_sz = (size_stack + 0x7UL) & ~0x7UL;
+      uint64_t *dynsz_ptr = NULL;
+      if (!view->wrap ||
+          stack_offset + aligned_sz + sizeof(uint64_t) <= view->split) {
+        sample.data_stack = (char *)buf;
+        sample.size_stack_head = size_stack;
+        dynsz_ptr = buf + aligned_sz / 8; // (/8 as it is uint64)
+      } else if (stack_offset >= view->split) {
+        // The whole stack is after the wrap
+        sample.data_stack = (char *)view->wrap + stack_offset - view->split;
+        sample.size_stack_head = size_stack;
+        dynsz_ptr = (uint64_t *)(sample.data_stack + aligned_sz);
+      } else {
+        sample.data_stack = (char *)buf;
+        sample.size_stack_head = view->split - stack_offset;
+        sample.data_stack_wrap = (char *)view->wrap;
+        dynsz_ptr = (uint64_t *)(view->wrap + stack_offset + aligned_sz -
+                                 view->split);
+      }
 
       // If the size was specified, we also have a dyn_size
-      dynsz_stack = *buf++;
+      dynsz_stack = *dynsz_ptr;
 
       // If the dyn_size is too big, zero out the stack size since it is likely
       // an error
       sample.size_stack = size_stack < dynsz_stack ? 0 : dynsz_stack;
       sample.dyn_size_stack = dynsz_stack; // for debugging
+      if (sample.size_stack <= sample.size_stack_head) {
+        // The captured part of the stack is contiguous
+        sample.size_stack_head = sample.size_stack;
+        sample.data_stack_wrap = NULL;
+      }
     }
+  } else {
+    sample.size_stack = 0;
+    sample.data_stack = NULL;
+    sample.size_stack_head = 0;
+    sample.data_stack_wrap = NULL;
+    sample.dyn_size_stack = 0;
   }
+  // Not decoded
+  sample.weight = 0;
+  sample.data_src = 0;
+  sample.transaction = 0;
+  sample.abi_intr = 0;
+  sample.regs_intr = NULL;
   if (PERF_SAMPLE_WEIGHT & mask) {}
   if (PERF_SAMPLE_DATA_SRC & mask) {}
   if (PERF_SAMPLE_TRANSACTION & mask) {}
@@ -281,16 +421,8 @@ perf_event_sample *hdr2samp(struct perf_event_header *hdr, uint64_t mask) {
   return &sample;
 }
 
-inline static int get_bits(uint64_t val) {
-  int count = 0;
-  while (val) {
-    count += val & 1;
-    val >>= 1;
-  }
-  return count;
-}
-
-uint64_t hdr_time(struct perf_event_header *hdr, uint64_t mask) {
+DECODER_INLINE uint64_t hdr_time_impl(struct perf_event_header *hdr,
+                                      uint64_t mask) {
   if (!(mask & PERF_SAMPLE_TIME))
     return 0;
 
@@ -330,3 +462,65 @@ uint64_t hdr_time(struct perf_event_header *hdr, uint64_t mask) {
 
   return 0;
 }
+
+perf_event_sample *view2samp_generic(const RecordView *view, uint64_t mask) {
+  return view2samp_impl(view, mask);
+}
+
+uint64_t hdr_time_generic(struct perf_event_header *hdr, uint64_t mask) {
+  return hdr_time_impl(hdr, mask);
+}
+
+static perf_event_sample *view2samp_default(const RecordView *view) {
+  return view2samp_impl(view, DEFAULT_SAMPLE_TYPE);
+}
+
+static uint64_t hdr_time_default(struct perf_event_header *hdr) {
+  return hdr_time_impl(hdr, DEFAULT_SAMPLE_TYPE);
+}
+
+// Masks with a specialized decoder (add an entry for new sample types)
+typedef struct SampleDecoder {
+  uint64_t mask;
+  perf_event_sample *(*view2samp)(const RecordView *view);
+  uint64_t (*hdr_time)(struct perf_event_header *hdr);
+} SampleDecoder;
+
+static const SampleDecoder s_sample_decoders[] = {
+    {DEFAULT_SAMPLE_TYPE, view2samp_default, hdr_time_default},
+};
+
+static const SampleDecoder *sample_decoder(uint64_t mask) {
+  for (size_t i = 0; i < ARRAY_SIZE(s_sample_decoders); ++i) {
+    if (s_sample_decoders[i].mask == mask)
+      return &s_sample_decoders[i];
+  }
+  return NULL;
+}
+
+perf_event_sample *view2samp(const RecordView *view, uint64_t mask) {
+  const SampleDecoder *decoder = sample_decoder(mask);
+  if (decoder)
+    return decoder->view2samp(view);
+  return view2samp_impl(view, mask);
+}
+
+uint64_t hdr_time(struct perf_event_header *hdr, uint64_t mask) {
+  const SampleDecoder *decoder = sample_decoder(mask);
+  if (decoder)
+    return decoder->hdr_time(hdr);
+  return hdr_time_impl(hdr, mask);
+}
+
+uint64_t hdr_id(struct perf_event_header *hdr, uint64_t mask) {
+  if (!(mask & PERF_SAMPLE_IDENTIFIER))
+    return 0;
+
+  // The identifier is the first field of samples, and the last one of the
+  // sample_id struct of other records
+  if (hdr->type == PERF_RECORD_SAMPLE)
+    return *(uint64_t *)&hdr[1];
+  if (hdr->size < sizeof(*hdr) + sizeof(uint64_t))
+    return 0;
+  return *(uint64_t *)((uint8_t *)hdr + hdr->size - sizeof(uint64_t));
+}
@@ -12,57 +12,165 @@
 #include <assert.h>
 #include <errno.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
 void pevent_init(PEventHdr *pevent_hdr) {
   memset(pevent_hdr, 0, sizeof(PEventHdr));
-  pevent_hdr->max_size = MAX_NB_WATCHERS;
-  for (int k = 0; k < pevent_hdr->max_size; ++k)
+}
+
+// Storage is contiguous and aligned on cache lines, as it is scanned by the
+// drain loop
+static DDRes pevent_alloc(PEventHdr *pevent_hdr, size_t nb_pevents) {
+  if (nb_pevents <= pevent_hdr->max_size)
+    return ddres_init();
+  free(pevent_hdr->pes);
+  pevent_hdr->pes = NULL;
+  pevent_hdr->max_size = 0;
+  void *pes = NULL;
+  if (posix_memalign(&pes, PEVENT_ALIGNMENT, nb_pevents * sizeof(PEvent))) {
+    DDRES_RETURN_ERROR_LOG(DD_WHAT_BADALLOC,
+                           "Unable to allocate %lu perf events", nb_pevents);
+  }
+  memset(pes, 0, nb_pevents * sizeof(PEvent));
+  pevent_hdr->pes = (PEvent *)pes;
+  pevent_hdr->max_size = nb_pevents;
+  for (size_t k = 0; k < nb_pevents; ++k)
     pevent_hdr->pes[k].fd = -1;
+  return ddres_init();
+}
+
+static int pevent_buf_size_shift(const DDProfContext *ctx) {
+  return ctx->params.buf_size_shift ? ctx->params.buf_size_shift
+                                    : DEFAULT_BUFF_SIZE_SHIFT;
+}
+
+static int pevent_id_cmp(const void *lhs, const void *rhs) {
+  uint64_t lhs_id = ((const PEventId *)lhs)->id;
+  uint64_t rhs_id = ((const PEventId *)rhs)->id;
+  return lhs_id < rhs_id ? -1 : lhs_id > rhs_id;
+}
+
+// Identifiers are needed to redirect several events to the same ring buffer
+static void pevent_read_ids(PEventHdr *pevent_hdr) {
+  free(pevent_hdr->ids);
+  pevent_hdr->nb_ids = 0;
+  pevent_hdr->ids = malloc(pevent_hdr->size * sizeof(PEventId));
+  if (!pevent_hdr->ids)
+    return;
+  for (size_t k = 0; k < pevent_hdr->size; ++k) {
+    PEventId *pe_id = &pevent_hdr->ids[k];
+    if (ioctl(pevent_hdr->pes[k].fd, PERF_EVENT_IOC_ID, &pe_id->id) == -1) {
+      LG_NTC("Unable to read perf event identifiers (%s)", strerror(errno));
+      free(pevent_hdr->ids);
+      pevent_hdr->ids = NULL;
+      return;
+    }
+    pe_id->pos = pevent_hdr->pes[k].pos;
+  }
+  qsort(pevent_hdr->ids, pevent_hdr->size, sizeof(PEventId), pevent_id_cmp);
+  pevent_hdr->nb_ids = pevent_hdr->size;
+}
+
+int pevent_pos_from_id(const PEventHdr *pevent_hdr, uint64_t id,
+                       int default_pos) {
+  size_t lo = 0;
+  size_t hi = pevent_hdr->nb_ids;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (pevent_hdr->ids[mid].id < id)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < pevent_hdr->nb_ids && pevent_hdr->ids[lo].id == id)
+    return pevent_hdr->ids[lo].pos;
+  return default_pos;
 }
 
 DDRes pevent_open(DDProfContext *ctx, pid_t pid, int num_cpu,
                   PEventHdr *pevent_hdr) {
-  PEvent *pes = pevent_hdr->pes;
   assert(pevent_hdr->size == 0); // check for previous init
+  DDRES_CHECK_FWD(pevent_alloc(pevent_hdr, ctx->num_watchers * num_cpu));
+  PEvent *pes = pevent_hdr->pes;
+
+  // Watermark is relative to the configured size of the buffers (the kernel
+  // clamps it to the size of smaller buffers we fall back to)
+  uint32_t wakeup_watermark = 0;
+  if (ctx->params.wakeup_watermark_pct) {
+    uint64_t data_size = (1UL << pevent_buf_size_shift(ctx)) * get_page_size();
+    wakeup_watermark = data_size * ctx->params.wakeup_watermark_pct / 100;
+  }
   for (int i = 0; i < ctx->num_watchers; ++i) {
     for (int j = 0; j < num_cpu; ++j) {
       int k = pevent_hdr->size++;
 
       pes[k].pos = i;
-      pes[k].fd = perfopen(pid, &ctx->watchers[i], j, true);
+      pes[k].cpu = j;
+      pes[k].fd =
+          perfopen(pid, &ctx->watchers[i], j, true, wakeup_watermark);
       if (pes[k].fd == -1) {
         DDRES_RETURN_ERROR_LOG(DD_WHAT_PERFOPEN,
                                "Error calling perfopen on watcher %d.%d (%s)",
                                i, j, strerror(errno));
       }
-      if (pevent_hdr->size >= pevent_hdr->max_size) {
-        LG_WRN("Reached max number of watchers (%lu)", pevent_hdr->max_size);
-        return ddres_init();
-      }
     }
   }
+  pevent_read_ids(pevent_hdr);
   return ddres_init();
 }
 
-DDRes pevent_mmap(PEventHdr *pevent_hdr, bool use_override) {
+// Index of the event owning the ring buffer of this CPU (-1 if none yet)
+static int pevent_cpu_owner(const PEventHdr *pevent_hdr, int k) {
+  const PEvent *pes = pevent_hdr->pes;
+  for (int l = 0; l < k; ++l) {
+    if (pes[l].cpu == pes[k].cpu && pes[l].rb.region)
+      return l;
+  }
+  return -1;
+}
+
+DDRes pevent_mmap(PEventHdr *pevent_hdr, int buf_size_shift,
+                  bool use_override, int *mapped_shift) {
   // Switch user if needed (when root switch to nobody user)
   UIDInfo info;
   if (use_override)
     DDRES_CHECK_FWD(user_override(&info));
 
   PEvent *pes = pevent_hdr->pes;
+  bool can_share = pevent_hdr->nb_ids == pevent_hdr->size;
+  *mapped_shift = buf_size_shift;
   for (int k = 0; k < pevent_hdr->size; ++k) {
     if (pes[k].fd != -1) {
+      // Write to the ring buffer of the first event of the same CPU
+      int owner = can_share ? pevent_cpu_owner(pevent_hdr, k) : -1;
+      if (owner != -1 &&
+          ioctl(pes[k].fd, PERF_EVENT_IOC_SET_OUTPUT, pes[owner].fd) == 0) {
+        pes[owner].shared_rb = true;
+        continue;
+      }
+
       size_t reg_sz = 0;
-      void *region = perfown(pes[k].fd, &reg_sz);
+      void *region = NULL;
+      int shift = buf_size_shift;
+      for (; shift >= MIN_BUFF_SIZE_SHIFT; --shift) {
+        region = perfown(pes[k].fd, shift, &reg_sz);
+        if (region)
+          break;
+        if (shift > MIN_BUFF_SIZE_SHIFT) {
+          LG_NTC("Unable to map %lu bytes for watcher (idx#%d), retrying",
+                 reg_sz, k);
+        }
+      }
       if (!region) {
         LG_WRN("Could not finalize watcher (idx#%d): registration (%s)", k,
                strerror(errno));
         goto REGION_CLEANUP;
       }
+      if (shift < *mapped_shift)
+        *mapped_shift = shift;
       if (!rb_init(&pes[k].rb, region, reg_sz)) {
         LG_ERR("Could not allocate storage for watcher (idx#%d)", k);
         goto REGION_CLEANUP;
@@ -83,10 +191,28 @@ REGION_CLEANUP:
   return ddres_error(DD_WHAT_PERFMMAP);
 }
 
+int pevent_next_buf_size_shift(int shift, int base_shift, bool lossy,
+                               bool busy) {
+  if (lossy) {
+    // grow to avoid losing events
+    ++shift;
+  } else if (!busy && shift > base_shift) {
+    // buffers stayed mostly empty : give back memory
+    --shift;
+  }
+  if (shift < MIN_BUFF_SIZE_SHIFT)
+    return MIN_BUFF_SIZE_SHIFT;
+  if (shift > MAX_BUFF_SIZE_SHIFT)
+    return MAX_BUFF_SIZE_SHIFT;
+  return shift;
+}
+
 DDRes pevent_setup(DDProfContext *ctx, pid_t pid, int num_cpu,
                    PEventHdr *pevent_hdr) {
   DDRES_CHECK_FWD(pevent_open(ctx, pid, num_cpu, pevent_hdr));
-  DDRES_CHECK_FWD(pevent_mmap(pevent_hdr, true));
+  int mapped_shift;
+  DDRES_CHECK_FWD(pevent_mmap(pevent_hdr, pevent_buf_size_shift(ctx), true,
+                              &mapped_shift));
   return ddres_init();
 }
 
@@ -113,6 +239,7 @@ DDRes pevent_munmap(PEventHdr *pevent_hdr) {
       }
       pes[k].rb.region = NULL;
     }
+    pes[k].shared_rb = false;
     rb_free(&pevent_hdr->pes[k].rb);
   }
 
@@ -145,5 +272,13 @@ DDRes pevent_cleanup(PEventHdr *pevent_hdr) {
     ret = ret_tmp;
   if (!IsDDResOK(ret_tmp = pevent_close(pevent_hdr)))
     ret = ret_tmp;
+
+  // Release the storage
+  free(pevent_hdr->pes);
+  pevent_hdr->pes = NULL;
+  pevent_hdr->max_size = 0;
+  free(pevent_hdr->ids);
+  pevent_hdr->ids = NULL;
+  pevent_hdr->nb_ids = 0;
   return ret;
 }
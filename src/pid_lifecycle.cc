@@ -0,0 +1,31 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "pid_lifecycle.hpp"
+
+namespace ddprof {
+
+void PidLifecycle::exited(pid_t pid, int64_t now_ns) {
+  // a previous exit of the same pid becomes stale
+  _generations[pid] = ++_generation;
+  _exited.push_back(Exited{pid, now_ns, _generation});
+}
+
+void PidLifecycle::started(pid_t pid) { _generations.erase(pid); }
+
+void PidLifecycle::pop_expired(int64_t now_ns, std::vector<pid_t> &pids) {
+  while (!_exited.empty() &&
+         now_ns - _exited.front()._time_ns >= _grace_period_ns) {
+    const Exited &front = _exited.front();
+    auto it = _generations.find(front._pid);
+    if (it != _generations.end() && it->second == front._generation) {
+      pids.push_back(front._pid);
+      _generations.erase(it);
+    }
+    _exited.pop_front();
+  }
+}
+
+} // namespace ddprof
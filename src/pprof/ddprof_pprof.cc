@@ -23,7 +23,7 @@ static const unsigned long s_nanos_in_one_sec = 1000000000;
 
 // Slice helpers
 static ddprof_ffi_Slice_c_char
-std_string_2_slice_c_char(const std::string &str) {
+interned_2_slice_c_char(ddprof::InternedString str) {
   if (str.empty())
     return (struct ddprof_ffi_Slice_c_char){.ptr = NULL, .len = 0};
   else
@@ -34,10 +34,6 @@ std_string_2_slice_c_char(const std::string &str) {
 #define SLICE_LITERAL(str)                                                     \
   (struct ddprof_ffi_Slice_c_char) { .ptr = (str), .len = sizeof(str) - 1 }
 
-static ddprof_ffi_Slice_c_char ffi_empty_char_slice(void) {
-  return (struct ddprof_ffi_Slice_c_char){.ptr = (NULL), .len = 0};
-}
-
 static const struct ddprof_ffi_ValueType s_sample_count = {
     .type_ = SLICE_LITERAL("sample"),
     .unit = SLICE_LITERAL("count"),
@@ -99,22 +95,20 @@ DDRes pprof_free_profile(DDProfPProf *pprof) {
 
 static void write_function(const ddprof::Symbol &symbol,
                            ddprof_ffi_Function *ffi_func) {
-  ffi_func->name = std_string_2_slice_c_char(symbol._demangle_name);
-  ffi_func->system_name = std_string_2_slice_c_char(symbol._symname);
-  ffi_func->filename = std_string_2_slice_c_char(symbol._srcpath);
+  ffi_func->name = interned_2_slice_c_char(symbol._demangle_name);
+  ffi_func->system_name = interned_2_slice_c_char(symbol._symname);
+  ffi_func->filename = interned_2_slice_c_char(symbol._srcpath);
   // Not filed (can be computed if needed using the start range from elf)
   ffi_func->start_line = 0;
 }
 
-#define UNKNOWN_BUILD_ID ffi_empty_char_slice()
-
 static void write_mapping(const ddprof::MapInfo &mapinfo,
                           ddprof_ffi_Mapping *ffi_mapping) {
   ffi_mapping->memory_start = mapinfo._low_addr;
   ffi_mapping->memory_limit = mapinfo._high_addr;
   ffi_mapping->file_offset = mapinfo._offset;
-  ffi_mapping->filename = std_string_2_slice_c_char(mapinfo._sopath);
-  ffi_mapping->build_id = UNKNOWN_BUILD_ID;
+  ffi_mapping->filename = interned_2_slice_c_char(mapinfo._sopath);
+  ffi_mapping->build_id = interned_2_slice_c_char(mapinfo._build_id);
 }
 
 static void write_location(const FunLoc *loc, const ddprof::MapInfo &mapinfo,
@@ -134,11 +128,10 @@ static void write_line(const ddprof::Symbol &symbol,
 }
 
 // Assumption of API is that sample is valid in a single type
-DDRes pprof_aggregate(const UnwindOutput *uw_output,
-                      const SymbolHdr *symbol_hdr, uint64_t value,
-                      int watcher_idx, DDProfPProf *pprof) {
+DDRes pprof_aggregate(const UnwindOutput *uw_output, SymbolHdr *symbol_hdr,
+                      uint64_t value, int watcher_idx, DDProfPProf *pprof) {
 
-  const ddprof::SymbolTable &symbol_table = symbol_hdr->_symbol_table;
+  ddprof::SymbolTable &symbol_table = symbol_hdr->_symbol_table;
   const ddprof::MapInfoTable &mapinfo_table = symbol_hdr->_mapinfo_table;
   ddprof_ffi_Profile *profile = pprof->_profile;
 
@@ -155,7 +148,7 @@ DDRes pprof_aggregate(const UnwindOutput *uw_output,
   const FunLoc *locs = uw_output->locs;
   for (unsigned i = 0; i < uw_output->nb_locs; ++i) {
     // possibly several lines to handle inlined function (not handled for now)
-    write_line(symbol_table[locs[i]._symbol_idx], &line_buff[i]);
+    write_line(symbol_table.demangled(locs[i]._symbol_idx), &line_buff[i]);
     ddprof_ffi_Slice_line lines = {.ptr = &line_buff[i], .len = 1};
     write_location(&locs[i], mapinfo_table[locs[i]._map_info_idx], &lines,
                    &locations_buff[i]);
@@ -0,0 +1,186 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "procfs_maps.hpp"
+
+extern "C" {
+#include "logger.h"
+}
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace ddprof {
+
+namespace {
+// procfs maps of most processes fit, larger ones double the buffer
+constexpr size_t k_initial_buf_size = 64 * 1024;
+constexpr size_t k_min_read_size = 4096;
+
+// value of hexadecimal digits, -1 for other characters
+struct HexTable {
+  HexTable() {
+    for (int c = 0; c < 256; ++c) {
+      _values[c] = -1;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+      _values[c] = c - '0';
+    }
+    for (int c = 'a'; c <= 'f'; ++c) {
+      _values[c] = c - 'a' + 10;
+      _values[c - 'a' + 'A'] = c - 'a' + 10;
+    }
+  }
+  int8_t _values[256];
+};
+const HexTable s_hex_table;
+
+inline bool parse_hex(char *&p, const char *end, uint64_t &value) {
+  // accept a 0x prefix, as sscanf does
+  if (end - p > 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+    p += 2;
+  }
+  const char *start = p;
+  uint64_t res = 0;
+  int digit;
+  while (p < end &&
+         (digit = s_hex_table._values[static_cast<unsigned char>(*p)]) >= 0) {
+    res = (res << 4) | digit;
+    ++p;
+  }
+  value = res;
+  return p != start;
+}
+
+inline bool skip_dec(char *&p, const char *end) {
+  const char *start = p;
+  while (p < end && *p >= '0' && *p <= '9') {
+    ++p;
+  }
+  return p != start;
+}
+
+inline bool consume(char *&p, const char *end, char c) {
+  if (p < end && *p == c) {
+    ++p;
+    return true;
+  }
+  return false;
+}
+} // namespace
+
+bool ProcMapsReader::read(pid_t pid, const std::string &path_to_proc) {
+  char path[1024];
+  int n = snprintf(path, sizeof(path), "%s/proc/%d/maps", path_to_proc.c_str(),
+                   pid);
+  if (n >= static_cast<int>(sizeof(path))) {
+    return false;
+  }
+  return read(path);
+}
+
+bool ProcMapsReader::read(const char *path) {
+  _size = 0;
+  _pos = 0;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  if (_buf.empty()) {
+    _buf.resize(k_initial_buf_size);
+  }
+  while (true) {
+    // keep a byte to terminate the last line
+    if (_buf.size() - _size < k_min_read_size + 1) {
+      _buf.resize(_buf.size() * 2);
+    }
+    ssize_t res = ::read(fd, &_buf[_size], _buf.size() - _size - 1);
+    if (res == -1 && errno == EINTR) {
+      continue;
+    }
+    if (res == -1) {
+      close(fd);
+      _size = 0;
+      return false;
+    }
+    if (res == 0) {
+      break;
+    }
+    _size += res;
+  }
+  close(fd);
+  _buf[_size] = '\0';
+  return true;
+}
+
+bool ProcMapsReader::next(ProcMapsEntry &entry) {
+  while (_pos < _size) {
+    char *line = &_buf[_pos];
+    char *line_end = static_cast<char *>(memchr(line, '\n', _size - _pos));
+    if (!line_end) {
+      line_end = &_buf[_size];
+    }
+    _pos = line_end - _buf.data() + 1;
+    if (parse_line(line, line_end, entry)) {
+      return true;
+    }
+    LG_WRN("[DSO] Failed to scan mapfile line");
+  }
+  return false;
+}
+
+bool ProcMapsReader::parse_line(char *line, char *line_end,
+                                ProcMapsEntry &entry) {
+  // clang-format off
+  // Example of format
+  /*
+    55d78839f000-55d7883a1000 r--p 00000000 fe:01 3287864                    /usr/local/bin/BadBoggleSolver_run
+    55d7883a1000-55d7883a5000 r-xp 00002000 fe:01 3287864                    /usr/local/bin/BadBoggleSolver_run
+    ...
+    55d78a12b000-55d78a165000 rw-p 00000000 00:00 0                          [heap]
+    ...
+    7f531437b000-7f531439e000 r-xp 00001000 fe:01 3932979                    /usr/lib/x86_64-linux-gnu/ld-2.31.so
+    7f531439e000-7f53143a6000 r--p 00024000 fe:01 3932979                    /usr/lib/x86_64-linux-gnu/ld-2.31.so
+    7f53143a8000-7f53143a9000 rw-p 0002d000 fe:01 3932979                    /usr/lib/x86_64-linux-gnu/ld-2.31.so
+    7f53143a9000-7f53143aa000 rw-p 00000000 00:00 0
+    7ffcd6c68000-7ffcd6c89000 rw-p 00000000 00:00 0                          [stack]
+    7ffcd6ce2000-7ffcd6ce6000 r--p 00000000 00:00 0                          [vvar]
+    7ffcd6ce6000-7ffcd6ce8000 r-xp 00000000 00:00 0                          [vdso]
+    ffffffffff600000-ffffffffff601000 r-xp 00000000 00:00 0                  [vsyscall]
+  */
+  // clang-format on
+  char *p = line;
+  uint64_t dev;
+  if (!parse_hex(p, line_end, entry._start) || !consume(p, line_end, '-') ||
+      !parse_hex(p, line_end, entry._end) || !consume(p, line_end, ' ')) {
+    return false;
+  }
+  // permissions (rwxp)
+  if (line_end - p < 4) {
+    return false;
+  }
+  entry._executable = p[2] == 'x';
+  p += 4;
+  if (!consume(p, line_end, ' ') || !parse_hex(p, line_end, entry._offset) ||
+      !consume(p, line_end, ' ') || !parse_hex(p, line_end, dev) ||
+      !consume(p, line_end, ':') || !parse_hex(p, line_end, dev) ||
+      !consume(p, line_end, ' ') || !skip_dec(p, line_end)) {
+    return false;
+  }
+  while (p < line_end && *p == ' ') {
+    ++p;
+  }
+  if (*line_end) {
+    *line_end = '\0';
+  }
+  entry._path = p;
+  entry._path_len = line_end - p;
+  return true;
+}
+
+} // namespace ddprof
@@ -3,7 +3,6 @@
 // developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
 // Datadog, Inc.
 
-#define _GNU_SOURCE // for qsort_r in stdlib
 #include "producer_linearizer.h"
 
 #include <stdlib.h>
@@ -47,6 +46,17 @@ void ProducerLinearizer_free(ProducerLinearizer *pl) {
   memset(pl, 0, sizeof(*pl));
 }
 
+static inline bool PL_less(const ProducerLinearizer *pl, uint64_t i_L,
+                           uint64_t i_R) {
+  return pl->A[i_L] < pl->A[i_R] || (pl->A[i_L] == pl->A[i_R] && i_L < i_R);
+}
+
+static inline void PL_swap(uint64_t *I, uint64_t a, uint64_t b) {
+  uint64_t tmp = I[a];
+  I[a] = I[b];
+  I[b] = tmp;
+}
+
 bool ProducerLinearizer_push(ProducerLinearizer *pl, uint64_t i, uint64_t v) {
   if (i >= pl->sz)
     return false;
@@ -57,49 +67,46 @@ bool ProducerLinearizer_push(ProducerLinearizer *pl, uint64_t i, uint64_t v) {
 
   pl->A[i] = v;     // Update value
   pl->F[i] = false; // Update free list
-  --pl->freecount;  // Update free count
-  pl->cursor = 0;   // reposition cursor to head (see pop)
-  return true;
-}
 
-int PL_cmp(const void *L, const void *R, void *state) {
-  ProducerLinearizer *pl = (ProducerLinearizer *)state;
-  uint64_t i_L = *(uint64_t *)L;
-  uint64_t i_R = *(uint64_t *)R;
-  uint64_t v_L = pl->A[i_L];
-  uint64_t v_R = pl->A[i_R];
-
-  // Free elements are larger than any value.  We allow two frees to compare
-  // equally to let the sorting algorithm optimize accordingly.
-  if (pl->F[i_L] && pl->F[i_R]) // For the sake of optimization, inf == inf
-    return 0;
-  if (pl->F[i_L]) // L is infinity, so L > R -> return 1
-    return 1;
-  if (pl->F[i_R]) // R is infinity, so R > L -> return -1
-    return -1;
-
-  // Otherwise, standard comparison applies.
-  return v_L == v_R ? 0 : v_L < v_R ? -1 : 1;
+  // Append to the heap and sift up
+  uint64_t pos = pl->sz - pl->freecount;
+  --pl->freecount; // Update free count
+  pl->I[pos] = i;
+  while (pos) {
+    uint64_t parent = (pos - 1) / 2;
+    if (!PL_less(pl, pl->I[pos], pl->I[parent]))
+      break;
+    PL_swap(pl->I, pos, parent);
+    pos = parent;
+  }
+  return true;
 }
 
-// This is a modestly tuned implementation.  It could be made much better by
-// swapping out qsort_r() for an online sorting method (such as one based on
-// insertionsort or timsort), which would not sort free slots.
-#include <stdio.h>
 bool ProducerLinearizer_pop(ProducerLinearizer *pl, uint64_t *ret) {
   // If all items are free, then we have nothing to offer
   if (pl->sz == pl->freecount)
     return false;
 
-  // If the cursor is set to zero, that means we haven't popped since the
-  // last sort operation.  Sort the indices by value.
-  if (!pl->cursor)
-    qsort_r(pl->I, pl->sz, sizeof(*pl->I), PL_cmp, pl);
-
-  // We're done, give the user the corresponding index and set it to free
-  *ret = pl->I[pl->cursor];
+  // Give the user the top index and set it to free. The last item of the
+  // heap takes its place, and the popped index lands right after the heap.
+  uint64_t n = pl->sz - pl->freecount - 1;
+  *ret = pl->I[0];
+  PL_swap(pl->I, 0, n);
   pl->F[*ret] = true;
   ++pl->freecount;
-  ++pl->cursor;
+
+  // Sift down
+  uint64_t pos = 0;
+  while (true) {
+    uint64_t child = 2 * pos + 1;
+    if (child >= n)
+      break;
+    if (child + 1 < n && PL_less(pl, pl->I[child + 1], pl->I[child]))
+      ++child;
+    if (!PL_less(pl, pl->I[child], pl->I[pos]))
+      break;
+    PL_swap(pl->I, pos, child);
+    pos = child;
+  }
   return true;
 }
@@ -0,0 +1,101 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "sample_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SQ_ALIGN(x) (((x) + 0x7UL) & ~0x7UL)
+
+bool sample_queue_init(SampleQueue *q, uint64_t capacity) {
+  if (!q || !capacity)
+    return false;
+  memset(q, 0, sizeof(*q));
+  capacity = SQ_ALIGN(capacity);
+  if (!(q->buf = malloc(capacity)))
+    return false;
+  q->capacity = capacity;
+  return true;
+}
+
+void sample_queue_free(SampleQueue *q) {
+  free(q->buf);
+  memset(q, 0, sizeof(*q));
+}
+
+struct perf_event_header *sample_queue_reserve(SampleQueue *q, uint32_t size,
+                                               int pos) {
+  uint64_t entry_sz = sizeof(SampleQueueEntry) + SQ_ALIGN(size);
+  if (entry_sz > q->capacity)
+    return NULL;
+
+  // Only the producer writes head
+  uint64_t head = q->head;
+  uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+  uint64_t offset = head % q->capacity;
+  uint64_t contiguous = q->capacity - offset;
+
+  // Skip the end of the storage if the entry does not fit
+  uint64_t padding = contiguous < entry_sz ? contiguous : 0;
+  if (q->capacity - (head - tail) < padding + entry_sz)
+    return NULL;
+
+  if (padding) {
+    SampleQueueEntry *pad = (SampleQueueEntry *)(q->buf + offset);
+    pad->size = padding;
+    pad->pos = -1;
+    offset = 0;
+  }
+
+  SampleQueueEntry *entry = (SampleQueueEntry *)(q->buf + offset);
+  entry->size = entry_sz;
+  entry->pos = pos;
+  q->reserved = padding + entry_sz;
+  return (struct perf_event_header *)&entry[1];
+}
+
+void sample_queue_commit(SampleQueue *q) {
+  __atomic_store_n(&q->head, q->head + q->reserved, __ATOMIC_RELEASE);
+  q->reserved = 0;
+}
+
+bool sample_queue_push(SampleQueue *q, const struct perf_event_header *hdr,
+                       int pos) {
+  struct perf_event_header *dst = sample_queue_reserve(q, hdr->size, pos);
+  if (!dst)
+    return false;
+  memcpy(dst, hdr, hdr->size);
+  sample_queue_commit(q);
+  return true;
+}
+
+struct perf_event_header *sample_queue_front(SampleQueue *q, int *pos) {
+  uint64_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+  uint64_t tail = q->tail;
+  while (tail != head) {
+    SampleQueueEntry *entry =
+        (SampleQueueEntry *)(q->buf + tail % q->capacity);
+    if (entry->pos >= 0) {
+      *pos = entry->pos;
+      return (struct perf_event_header *)&entry[1];
+    }
+    // Padding : release it straight away
+    tail += entry->size;
+    __atomic_store_n(&q->tail, tail, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+void sample_queue_pop(SampleQueue *q) {
+  SampleQueueEntry *entry =
+      (SampleQueueEntry *)(q->buf + q->tail % q->capacity);
+  __atomic_store_n(&q->tail, q->tail + entry->size, __ATOMIC_RELEASE);
+}
+
+uint64_t sample_queue_used(const SampleQueue *q) {
+  return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) -
+      __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
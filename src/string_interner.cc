@@ -0,0 +1,58 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "string_interner.hpp"
+
+#include <cassert>
+
+namespace ddprof {
+
+size_t InternedStringHash::operator()(const InternedString &str) const {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (uint32_t i = 0; i < str._len; ++i) {
+    hash ^= static_cast<unsigned char>(str._ptr[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+InternedString StringInterner::intern(const char *str, size_t len) {
+  if (!len) {
+    return InternedString();
+  }
+  assert(len < UINT32_MAX);
+  // look up with the caller's storage, copy only new strings
+  auto it = _strings.find(InternedString(str, len));
+  if (it != _strings.end()) {
+    return *it;
+  }
+  char *dest = allocate(len + 1);
+  memcpy(dest, str, len);
+  dest[len] = '\0';
+  InternedString interned(dest, len);
+  _strings.insert(interned);
+  return interned;
+}
+
+char *StringInterner::allocate(size_t size) {
+  if (size > k_block_size / 4) {
+    // large strings get their own block, keeping the current one
+    _blocks.emplace_back(new char[size]);
+    _arena_size += size;
+    return _blocks.back().get();
+  }
+  if (size > static_cast<size_t>(_block_end - _block_pos)) {
+    _blocks.emplace_back(new char[k_block_size]);
+    _arena_size += k_block_size;
+    _block_pos = _blocks.back().get();
+    _block_end = _block_pos + k_block_size;
+  }
+  char *res = _block_pos;
+  _block_pos += size;
+  return res;
+}
+
+} // namespace ddprof
@@ -0,0 +1,237 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "symbol_disk_cache.hpp"
+
+extern "C" {
+#include "logger.h"
+}
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ddprof {
+
+namespace {
+// version is part of the magic : files of other versions are replaced
+constexpr char k_magic[8] = {'D', 'D', 'P', 'S', 'Y', 'M', 'C', 2};
+// files above this size are still loaded, but no longer grow
+constexpr off_t k_max_file_size = 64 * 1024 * 1024;
+// longer strings are considered as corruption
+constexpr uint32_t k_max_string_len = 64 * 1024;
+
+// Names are stored mangled : they are demangled when exported
+struct RecordHdr {
+  uint64_t _start;
+  uint32_t _size; // end - start
+  uint32_t _lineno;
+  uint32_t _symname_len;
+  uint32_t _srcpath_len;
+};
+static_assert(sizeof(RecordHdr) == 24, "RecordHdr is written as is");
+
+bool write_all(int fd, const char *buf, size_t sz) {
+  while (sz) {
+    ssize_t res = ::write(fd, buf, sz);
+    if (res == -1 && errno == EINTR) {
+      continue;
+    }
+    if (res <= 0) {
+      return false;
+    }
+    buf += res;
+    sz -= res;
+  }
+  return true;
+}
+} // namespace
+
+SymbolDiskCache::~SymbolDiskCache() {
+  for (const auto &el : _fds) {
+    if (el.second != -1) {
+      ::close(el.second);
+    }
+  }
+}
+
+void SymbolDiskCache::set_directory(const char *dir) {
+  _dir.clear();
+  if (!dir || !*dir) {
+    return;
+  }
+  if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+    LG_WRN("[SYMCACHE] Unable to create %s (%s), cache disabled", dir,
+           strerror(errno));
+    return;
+  }
+  _dir = dir;
+}
+
+std::string SymbolDiskCache::file_path(const BuildId &build_id,
+                                       int64_t file_size) const {
+  return _dir + "/" + build_id + "-" + std::to_string(file_size) + ".sym";
+}
+
+int SymbolDiskCache::open_file(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+  if (fd != -1 || errno != ENOENT) {
+    return fd;
+  }
+  // The header is written under a temporary name : other writers never see
+  // a file without header
+  std::string tmp_path = path + ".XXXXXX";
+  int tmp_fd = mkostemp(&tmp_path[0], O_CLOEXEC);
+  if (tmp_fd == -1) {
+    return -1;
+  }
+  bool written = write_all(tmp_fd, k_magic, sizeof(k_magic)) &&
+      fchmod(tmp_fd, 0644) == 0;
+  ::close(tmp_fd);
+  // existing file means another writer created it first
+  if (written && link(tmp_path.c_str(), path.c_str()) == -1 &&
+      errno != EEXIST) {
+    written = false;
+  }
+  unlink(tmp_path.c_str());
+  if (!written) {
+    return -1;
+  }
+  return ::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+}
+
+int SymbolDiskCache::open(FileInfoId_t id, const BuildId &build_id,
+                          int64_t file_size, Offset_t start_offset,
+                          Offset_t end_offset, SymbolTable &table,
+                          std::vector<SymbolCacheEntry> &entries) {
+  if (!enabled() || build_id.empty() || _fds.find(id) != _fds.end()) {
+    return 0;
+  }
+  std::string path = file_path(build_id, file_size);
+  int fd = open_file(path);
+  if (fd == -1) {
+    LG_DBG("[SYMCACHE] Unable to open %s (%s)", path.c_str(),
+           strerror(errno));
+    return 0;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 ||
+      static_cast<size_t>(st.st_size) < sizeof(k_magic)) {
+    ::close(fd);
+    return 0;
+  }
+  size_t sz = st.st_size;
+  const char *region = static_cast<const char *>(
+      mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0));
+  if (region == MAP_FAILED) {
+    ::close(fd);
+    return 0;
+  }
+  if (memcmp(region, k_magic, sizeof(k_magic)) != 0) {
+    // written by another version : start again from an empty file
+    LG_NTC("[SYMCACHE] Replacing %s (unknown format)", path.c_str());
+    munmap(const_cast<char *>(region), sz);
+    ::close(fd);
+    if (unlink(path.c_str()) == -1 && errno != ENOENT) {
+      return 0;
+    }
+    fd = open_file(path);
+    if (fd == -1) {
+      return 0;
+    }
+    _fds[id] = fd;
+    return 0;
+  }
+
+  int nb_loaded = 0;
+  size_t pos = sizeof(k_magic);
+  // a truncated record (interrupted writer) ends the records
+  while (sz - pos >= sizeof(RecordHdr)) {
+    RecordHdr hdr;
+    memcpy(&hdr, region + pos, sizeof(hdr));
+    if (hdr._symname_len > k_max_string_len ||
+        hdr._srcpath_len > k_max_string_len) {
+      LG_WRN("[SYMCACHE] Corrupted record in %s", path.c_str());
+      break;
+    }
+    size_t strings_len = hdr._symname_len + hdr._srcpath_len;
+    if (sz - pos - sizeof(RecordHdr) < strings_len) {
+      break;
+    }
+    const char *str = region + pos + sizeof(RecordHdr);
+    pos += sizeof(RecordHdr) + strings_len;
+    if (hdr._start < start_offset || hdr._start >= end_offset) {
+      continue;
+    }
+    InternedString symname = table.intern(str, hdr._symname_len);
+    str += hdr._symname_len;
+    InternedString srcpath = table.intern(str, hdr._srcpath_len);
+    entries.push_back(SymbolCacheEntry{
+        hdr._start, hdr._start + hdr._size,
+        Symbol(symname, InternedString(), hdr._lineno, srcpath)});
+    ++nb_loaded;
+  }
+  munmap(const_cast<char *>(region), sz);
+
+  // records appended after a corrupted one could not be read
+  if (pos != sz || st.st_size > k_max_file_size) {
+    LG_DBG("[SYMCACHE] No longer appending to %s", path.c_str());
+    ::close(fd);
+    fd = -1;
+  }
+  _fds[id] = fd;
+  LG_DBG("[SYMCACHE] Loaded %d symbols from %s", nb_loaded, path.c_str());
+  return nb_loaded;
+}
+
+void SymbolDiskCache::append(FileInfoId_t id, Offset_t start, Offset_t end,
+                             const Symbol &symbol) {
+  auto it = _fds.find(id);
+  if (it == _fds.end() || it->second == -1) {
+    return;
+  }
+  if (end < start || end - start > UINT32_MAX ||
+      symbol._symname.size() > k_max_string_len ||
+      symbol._srcpath.size() > k_max_string_len) {
+    return;
+  }
+  RecordHdr hdr;
+  hdr._start = start;
+  hdr._size = end - start;
+  hdr._lineno = symbol._lineno;
+  hdr._symname_len = symbol._symname.size();
+  hdr._srcpath_len = symbol._srcpath.size();
+  _record_buf.resize(sizeof(hdr) + hdr._symname_len + hdr._srcpath_len);
+  char *buf = _record_buf.data();
+  memcpy(buf, &hdr, sizeof(hdr));
+  buf += sizeof(hdr);
+  memcpy(buf, symbol._symname.c_str(), hdr._symname_len);
+  buf += hdr._symname_len;
+  memcpy(buf, symbol._srcpath.c_str(), hdr._srcpath_len);
+  // a single write per record : concurrent appends do not interleave
+  ssize_t res = ::write(it->second, _record_buf.data(), _record_buf.size());
+  if (res != static_cast<ssize_t>(_record_buf.size())) {
+    LG_WRN("[SYMCACHE] Unable to append to the cache of file %d", id);
+    ::close(it->second);
+    it->second = -1;
+  }
+}
+
+void SymbolDiskCache::close(FileInfoId_t id) {
+  auto it = _fds.find(id);
+  if (it == _fds.end()) {
+    return;
+  }
+  if (it->second != -1) {
+    ::close(it->second);
+  }
+  _fds.erase(it);
+}
+
+} // namespace ddprof
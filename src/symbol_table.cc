@@ -0,0 +1,27 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "symbol_table.hpp"
+
+#include <llvm/Demangle/Demangle.h>
+
+namespace ddprof {
+
+const Symbol &SymbolTable::demangled(SymbolIdx_t idx) {
+  Symbol &symbol = _symbols[idx];
+  if (!symbol._demangle_name.empty() || symbol._symname.empty()) {
+    return symbol;
+  }
+  // several symbols share a name (one per process and per file)
+  auto res =
+      _demangled_names.emplace(symbol._symname.c_str(), InternedString());
+  if (res.second) {
+    res.first->second = _strings.intern(llvm::demangle(symbol._symname.str()));
+  }
+  symbol._demangle_name = res.first->second;
+  return symbol;
+}
+
+} // namespace ddprof
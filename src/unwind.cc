@@ -6,6 +6,7 @@
 #include "unwind.hpp"
 
 extern "C" {
+#include "ddprof_stats.h"
 #include "ddres.h"
 #include "libebl.h"
 #include "logger.h"
@@ -16,10 +17,15 @@ extern "C" {
 #include "dso_hdr.hpp"
 #include "dwfl_hdr.hpp"
 #include "symbol_hdr.hpp"
+#include "unwind_cfi.hpp"
 #include "unwind_dwfl.hpp"
+#include "unwind_fp.hpp"
 #include "unwind_helpers.hpp"
 #include "unwind_state.hpp"
 
+#include <vector>
+#include <x86intrin.h>
+
 #define UNUSED(x) (void)(x)
 
 namespace ddprof {
@@ -28,26 +34,49 @@ void unwind_init(void) { elf_version(EV_CURRENT); }
 static void find_dso_add_error_frame(UnwindState *us) {
   DsoHdr::DsoFindRes find_res =
       us->dso_hdr.dso_find_closest(us->pid, us->current_eip);
-  add_error_frame(find_res.second ? &(find_res.first->second) : nullptr, us,
+  add_error_frame(find_res.second ? &(*find_res.first) : nullptr, us,
                   us->current_eip);
 }
 
 void unwind_init_sample(UnwindState *us, uint64_t *sample_regs,
                         pid_t sample_pid, uint64_t sample_size_stack,
-                        char *sample_data_stack) {
+                        char *sample_data_stack, uint64_t sample_stack_split,
+                        char *sample_data_stack_wrap) {
   uw_output_clear(&us->output);
   memcpy(&us->initial_regs.regs[0], sample_regs,
          K_NB_REGS_UNWIND * sizeof(uint64_t));
+  us->dwarf_regs = us->initial_regs;
   us->current_eip = us->initial_regs.eip;
   us->pid = sample_pid;
   us->stack_sz = sample_size_stack;
   us->stack = sample_data_stack;
+  us->stack_wrap = sample_data_stack_wrap;
+  us->stack_split =
+      sample_data_stack_wrap ? sample_stack_split : sample_size_stack;
 }
 
 DDRes unwindstate__unwind(UnwindState *us) {
   DDRes res = ddres_init();
   if (us->pid != 0) { // we can not unwind pid 0
-    res = unwind_dwfl(us);
+    bool complete = false;
+    if (us->fp_unwind) {
+      uint64_t ticks = __rdtsc();
+      res = unwind_fp(us, &complete);
+      ddprof_stats_add(STATS_UNWIND_FP_TICKS, __rdtsc() - ticks, NULL);
+      if (IsDDResOK(res) && !complete) {
+        ddprof_stats_add(STATS_UNWIND_FP_FALLBACKS, 1, NULL);
+      }
+    }
+    if (us->cfi_unwind && IsDDResOK(res) && !complete) {
+      uint64_t ticks = __rdtsc();
+      res = unwind_cfi(us, &complete);
+      ddprof_stats_add(STATS_UNWIND_CFI_TICKS, __rdtsc() - ticks, NULL);
+    }
+    if (IsDDResOK(res) && !complete) {
+      uint64_t ticks = __rdtsc();
+      res = unwind_dwfl(us);
+      ddprof_stats_add(STATS_UNWIND_DWFL_TICKS, __rdtsc() - ticks, NULL);
+    }
   }
   if (IsDDResNotOK(res)) {
     find_dso_add_error_frame(us);
@@ -66,6 +95,39 @@ void unwind_pid_free(UnwindState *us, pid_t pid) {
   us->dso_hdr.pid_free(pid);
   us->dwfl_hdr.clear_pid(pid);
   us->symbol_hdr._base_frame_symbol_lookup.erase(pid);
+  us->symbol_hdr._mapinfo_lookup.erase(pid);
+}
+
+void unwind_pid_fork(UnwindState *us, pid_t ppid, pid_t pid) {
+  us->pid_lifecycle.started(pid);
+  unwind_pid_free(us, pid);
+  // dwfl modules of the child are registered again from the shared elf
+  // handles, only the DSOs are inherited
+  us->dso_hdr.pid_fork(ppid, pid);
+}
+
+void unwind_pid_fork_replayed(UnwindState *us, pid_t ppid, pid_t pid) {
+  // the child can have exited or exec'd on this shard already : only inherit
+  // when nothing is known about it
+  us->dso_hdr.pid_fork(ppid, pid);
+}
+
+void unwind_pid_exit(UnwindState *us, pid_t pid, int64_t now_ns) {
+  us->pid_lifecycle.exited(pid, now_ns);
+}
+
+void unwind_release_exited(UnwindState *us, int64_t now_ns) {
+  if (us->pid_lifecycle.empty()) {
+    return;
+  }
+  std::vector<pid_t> pids;
+  us->pid_lifecycle.pop_expired(now_ns, pids);
+  for (pid_t pid : pids) {
+    LG_DBG("[UNWIND] Release exited pid %d", pid);
+    unwind_pid_free(us, pid);
+  }
+  us->pid_lifecycle._released.insert(us->pid_lifecycle._released.end(),
+                                     pids.begin(), pids.end());
 }
 
 void unwind_cycle(UnwindState *us) {
@@ -74,8 +136,13 @@ void unwind_cycle(UnwindState *us) {
   // clean up pids that we did not see recently
   us->dwfl_hdr.display_stats();
   us->dwfl_hdr.clear_unvisited();
+  // modules of cleared dwfl objects need to be registered again
+  us->frame_cache._stats.display();
+  us->frame_cache._stats.reset();
+  us->frame_cache.clear();
 
   us->dso_hdr._stats.reset();
+  us->pid_lifecycle._released.clear();
   unwind_metrics_reset();
 }
 
@@ -0,0 +1,103 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "unwind_cfi.hpp"
+
+extern "C" {
+#include "ddprof_stats.h"
+#include "ddres.h"
+#include "logger.h"
+}
+
+#include "cfi_table.hpp"
+#include "dso_hdr.hpp"
+#include "unwind_dwfl.hpp"
+#include "unwind_helpers.hpp"
+#include "unwind_state.hpp"
+
+namespace ddprof {
+
+// Unwinding rules of pc, or nullptr if the tables do not cover it
+static const CfiRow *find_cfi_row(UnwindState *us, const Dso &dso,
+                                  ProcessAddress_t pc) {
+  if (dso._type != dso::kStandard) {
+    return nullptr;
+  }
+  FileInfoId_t file_info_id = us->dso_hdr.get_or_insert_file_info(dso);
+  if (file_info_id <= k_file_info_error) {
+    return nullptr;
+  }
+  const CfiTable *table;
+  if (!us->cfi_table_hdr.find(file_info_id, &table)) {
+    const FileInfoValue &file_info_value =
+        us->dso_hdr.get_file_info_value(file_info_id);
+    // The file is opened once for dwfl and the tables
+    const ElfCacheEntry *entry = us->dwfl_hdr.get_elf_cache().get_or_insert(
+        file_info_id, file_info_value.get_path());
+    table = us->cfi_table_hdr.get_or_insert(file_info_id,
+                                            entry ? entry->_elf : nullptr);
+  }
+  ElfAddress_t elf_addr;
+  if (!table ||
+      !table->offset_to_addr(pc - dso._start + dso._pgoff, &elf_addr)) {
+    return nullptr;
+  }
+  return table->find(elf_addr);
+}
+
+DDRes unwind_cfi(UnwindState *us, bool *complete) {
+  *complete = false;
+  // Symbolization still relies on dwfl
+  DDRes res = unwind_init_dwfl(us);
+  if (!IsDDResOK(res)) {
+    LOG_ERROR_DETAILS(LG_DBG, res._what);
+    return res;
+  }
+
+  UnwindRegisters regs = us->dwarf_regs;
+  // the first frame is not a return address
+  bool activation = us->output.nb_locs == 0;
+  uint64_t sp_end = us->initial_regs.esp + us->stack_sz;
+  while (true) {
+    if (max_stack_depth_reached(us)) {
+      *complete = true;
+      break;
+    }
+    // Point into the call instruction (as done for DWARF frames)
+    ProcessAddress_t pc = activation ? regs.eip : regs.eip - 1;
+    DsoHdr::DsoFindRes find_res =
+        us->dso_hdr.dso_find_or_backpopulate(us->pid, pc);
+    if (!find_res.second) {
+      break;
+    }
+    const Dso &dso = *find_res.first;
+    const CfiRow *row = find_cfi_row(us, dso, pc);
+    if (!row) {
+      break;
+    }
+    UnwindRegisters caller;
+    cfi::StepResult step = cfi_step(*row, regs, &caller, memory_read, us);
+    if (step == cfi::kStepError || caller.esp > sp_end) {
+      break;
+    }
+    if (IsDDResNotOK(add_dwfl_frame(us, dso, pc))) {
+      break;
+    }
+    ddprof_stats_add(STATS_UNWIND_FRAMES, 1, NULL);
+    ddprof_stats_add(STATS_UNWIND_CFI_FRAMES, 1, NULL);
+    us->current_eip = pc;
+    if (step == cfi::kStepEnd) {
+      *complete = true;
+      break;
+    }
+    regs = caller;
+    activation = false;
+  }
+  // libdwfl resumes from the first frame we could not handle
+  us->dwarf_regs = regs;
+  return ddres_init();
+}
+
+} // namespace ddprof
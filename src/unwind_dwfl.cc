@@ -38,9 +38,8 @@ DDRes unwind_init_dwfl(UnwindState *us) {
 
     bool success = false;
     // Find an elf file we can load for this PID
-    for (auto el : map) {
-      if (el.second._executable) {
-        const Dso &dso = el.second;
+    for (const Dso &dso : map) {
+      if (dso._executable) {
         FileInfoId_t file_info_id = us->dso_hdr.get_or_insert_file_info(dso);
         if (file_info_id <= k_file_info_error) {
           LG_DBG("Unable to find file for DSO %s", dso.to_string().c_str());
@@ -81,15 +80,13 @@ static void trace_unwinding_end(UnwindState *us) {
         us->dso_hdr.dso_find_closest(us->pid, us->current_eip);
     if (find_res.second) {
       LG_DBG("Stopped at %lx - dso %s - error %s", us->current_eip,
-             find_res.first->second.to_string().c_str(), dwfl_errmsg(-1));
+             find_res.first->to_string().c_str(), dwfl_errmsg(-1));
     } else {
       LG_DBG("Unknown DSO %lx - error %s", us->current_eip, dwfl_errmsg(-1));
     }
   }
 }
 
-static DDRes add_dwfl_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc);
-
 // returns true if we should continue unwinding
 static DDRes add_symbol(Dwfl_Frame *dwfl_frame, UnwindState *us) {
 
@@ -113,6 +110,10 @@ static DDRes add_symbol(Dwfl_Frame *dwfl_frame, UnwindState *us) {
 
   us->current_eip = pc;
 
+  if (add_cached_frame(us, pc)) {
+    return ddres_init();
+  }
+
   DsoHdr::DsoFindRes find_res =
       us->dso_hdr.dso_find_or_backpopulate(us->pid, pc);
   if (!find_res.second) {
@@ -124,7 +125,7 @@ static DDRes add_symbol(Dwfl_Frame *dwfl_frame, UnwindState *us) {
   }
 
   // Now we register
-  if (IsDDResNotOK(add_dwfl_frame(us, find_res.first->second, pc))) {
+  if (IsDDResNotOK(add_resolved_frame(us, *find_res.first, pc))) {
     return ddres_warn(DD_WHAT_UW_ERROR);
   }
   return ddres_init();
@@ -164,8 +165,26 @@ DDRes unwind_dwfl(UnwindState *us) {
   return res;
 }
 
-static DDRes add_dwfl_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc) {
+bool add_cached_frame(UnwindState *us, ElfAddress_t pc) {
+  UnwindOutput *output = &us->output;
+  FunLoc &loc = output->locs[output->nb_locs];
+  if (!us->frame_cache.find(us->pid, pc, us->dso_hdr.get_generation(us->pid),
+                            &loc._symbol_idx, &loc._map_info_idx)) {
+    return false;
+  }
+  loc.ip = pc;
+  output->nb_locs++;
+  return true;
+}
+
+DDRes add_dwfl_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc) {
+  if (add_cached_frame(us, pc)) {
+    return ddres_init();
+  }
+  return add_resolved_frame(us, dso, pc);
+}
 
+DDRes add_resolved_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc) {
   SymbolHdr &unwind_symbol_hdr = us->symbol_hdr;
   // if not encountered previously, update file location / key
   FileInfoId_t file_info_id = us->dso_hdr.get_or_insert_file_info(dso);
@@ -202,7 +221,11 @@ static DDRes add_dwfl_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc) {
 
   output->locs[current_loc_idx]._map_info_idx =
       us->symbol_hdr._mapinfo_lookup.get_or_insert(
-          us->pid, us->symbol_hdr._mapinfo_table, dso);
+          us->pid, us->symbol_hdr._mapinfo_table, dso,
+          file_info_value.get_build_id());
+  us->frame_cache.insert(us->pid, pc, us->dso_hdr.get_generation(us->pid),
+                         output->locs[current_loc_idx]._symbol_idx,
+                         output->locs[current_loc_idx]._map_info_idx);
   output->nb_locs++;
 
   return ddres_init();
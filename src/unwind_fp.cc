@@ -0,0 +1,135 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "unwind_fp.hpp"
+
+extern "C" {
+#include "ddprof_stats.h"
+#include "ddres.h"
+#include "logger.h"
+}
+
+#include "dso_hdr.hpp"
+#include "unwind_dwfl.hpp"
+#include "unwind_helpers.hpp"
+#include "unwind_state.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+namespace ddprof {
+
+void unwind_fp_config(UnwindState *us, bool enable, const char *exclude) {
+  us->fp_unwind = enable;
+  us->fp_exclude.clear();
+  if (!exclude) {
+    return;
+  }
+  const char *start = exclude;
+  while (*start) {
+    const char *end = strchrnul(start, ',');
+    if (end != start) {
+      us->fp_exclude.emplace_back(start, end - start);
+    }
+    start = *end ? end + 1 : end;
+  }
+}
+
+static bool dso_has_frame_pointers(const UnwindState *us, const Dso &dso) {
+  if (dso._fp_status == dso::kFpUnknown) {
+    bool excluded = dso._type != dso::kStandard ||
+        std::any_of(us->fp_exclude.begin(), us->fp_exclude.end(),
+                    [&dso](const std::string &path) {
+                      return strstr(dso._filename.c_str(), path.c_str()) !=
+                          nullptr;
+                    });
+    dso._fp_status = excluded ? dso::kFpMissing : dso::kFpAvailable;
+  }
+  return dso._fp_status == dso::kFpAvailable;
+}
+
+// Registers of the caller, from the frame record pointed to by ebp :
+// [ebp] holds the caller's ebp and [ebp + 8] the return address.
+// Returns false if the frame record is not within the stack snapshot.
+static bool read_frame_record(UnwindState *us, const UnwindRegisters &regs,
+                              UnwindRegisters *caller) {
+  uint64_t sp_end = us->initial_regs.esp + us->stack_sz;
+  if (regs.ebp < regs.esp || regs.ebp + 2 * sizeof(ElfWord_t) > sp_end) {
+    return false;
+  }
+  ElfWord_t ebp, eip;
+  if (!memory_read(regs.ebp, &ebp, us) ||
+      !memory_read(regs.ebp + sizeof(ElfWord_t), &eip, us)) {
+    return false;
+  }
+  caller->ebp = ebp;
+  caller->esp = regs.ebp + 2 * sizeof(ElfWord_t);
+  caller->eip = eip;
+  return true;
+}
+
+static bool add_fp_frame(UnwindState *us, const Dso &dso, ElfAddress_t pc) {
+  if (IsDDResNotOK(add_dwfl_frame(us, dso, pc))) {
+    return false;
+  }
+  ddprof_stats_add(STATS_UNWIND_FRAMES, 1, NULL);
+  ddprof_stats_add(STATS_UNWIND_FP_FRAMES, 1, NULL);
+  us->current_eip = pc;
+  return true;
+}
+
+DDRes unwind_fp(UnwindState *us, bool *complete) {
+  *complete = false;
+  // Frame pointer unwinding still relies on dwfl for symbolization
+  DDRes res = unwind_init_dwfl(us);
+  if (!IsDDResOK(res)) {
+    LOG_ERROR_DETAILS(LG_DBG, res._what);
+    return res;
+  }
+
+  UnwindRegisters regs = us->initial_regs;
+  bool activation = true; // the first frame is not a return address
+  while (true) {
+    if (max_stack_depth_reached(us)) {
+      *complete = true;
+      break;
+    }
+    // Point into the call instruction (as done for DWARF frames)
+    ProcessAddress_t pc = activation ? regs.eip : regs.eip - 1;
+    DsoHdr::DsoFindRes find_res =
+        us->dso_hdr.dso_find_or_backpopulate(us->pid, pc);
+    if (!find_res.second || !dso_has_frame_pointers(us, *find_res.first)) {
+      break;
+    }
+    const Dso &dso = *find_res.first;
+    if (regs.ebp == 0) {
+      // Outermost frame (the ABI requires a null frame pointer there)
+      *complete = add_fp_frame(us, dso, pc);
+      break;
+    }
+    UnwindRegisters caller;
+    if (!read_frame_record(us, regs, &caller)) {
+      break;
+    }
+    if (caller.ebp != 0 && caller.ebp <= regs.ebp) {
+      // Frames should be further up the stack : this code does not maintain
+      // frame pointers
+      LG_DBG("[UW]%d: Broken frame pointer chain in %s", us->pid,
+             dso._filename.c_str());
+      dso._fp_status = dso::kFpMissing;
+      break;
+    }
+    if (!add_fp_frame(us, dso, pc)) {
+      break;
+    }
+    regs = caller;
+    activation = false;
+  }
+  // DWARF unwinding resumes from the first frame we could not handle
+  us->dwarf_regs = regs;
+  return ddres_init();
+}
+
+} // namespace ddprof
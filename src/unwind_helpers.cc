@@ -13,6 +13,8 @@ extern "C" {
 #include "unwind_helpers.hpp"
 #include "unwind_state.hpp"
 
+#include <string.h>
+
 namespace ddprof {
 
 bool max_stack_depth_reached(UnwindState *us) {
@@ -118,14 +120,13 @@ bool memory_read(ProcessAddress_t addr, ElfWord_t *result, void *arg) {
     // If we're here, we're not in the stack.  We should interpet addr as an
     // address in VM, not as a file offset.
     // Strongly assumes we're also in an executable region?
-    DsoHdr::DsoFindRes find_res =
-        us->dso_hdr.pid_read_dso(us->pid, result, sizeof(ElfWord_t), addr);
-    if (!find_res.second) {
+    if (!us->dso_hdr.pid_read(us->pid, result, sizeof(ElfWord_t), addr)) {
       // Some regions are not handled
       LG_DBG("Couldn't get read 0x%lx from %d, (0x%lx, 0x%lx)[%p, %p]", addr,
              us->pid, sp_start, sp_end, us->stack, us->stack + us->stack_sz);
+      return false;
     }
-    return find_res.second;
+    return true;
   }
 
   // If we're here, we're going to read from the stack.  Just the same, we need
@@ -137,7 +138,17 @@ bool memory_read(ProcessAddress_t addr, ElfWord_t *result, void *arg) {
     return false;
   }
 
-  *result = *(ElfWord_t *)(us->stack + stack_idx);
+  if (stack_idx + sizeof(ElfWord_t) <= us->stack_split) {
+    *result = *(ElfWord_t *)(us->stack + stack_idx);
+  } else if (stack_idx >= us->stack_split) {
+    *result = *(ElfWord_t *)(us->stack_wrap + stack_idx - us->stack_split);
+  } else {
+    // The word is split between the end and the start of the ring buffer
+    size_t head_sz = us->stack_split - stack_idx;
+    memcpy(result, us->stack + stack_idx, head_sz);
+    memcpy(reinterpret_cast<char *>(result) + head_sz, us->stack_wrap,
+           sizeof(ElfWord_t) - head_sz);
+  }
   return true;
 }
 
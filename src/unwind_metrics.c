@@ -7,7 +7,13 @@
 #include "ddprof_stats.h"
 
 static const DDPROF_STATS s_cycled_stats[] = {STATS_UNWIND_FRAMES,
-                                              STATS_UNWIND_ERRORS};
+                                              STATS_UNWIND_ERRORS,
+                                              STATS_UNWIND_FP_FRAMES,
+                                              STATS_UNWIND_FP_FALLBACKS,
+                                              STATS_UNWIND_FP_TICKS,
+                                              STATS_UNWIND_DWFL_TICKS,
+                                              STATS_UNWIND_CFI_FRAMES,
+                                              STATS_UNWIND_CFI_TICKS};
 
 #define cycled_stats_sz (sizeof(s_cycled_stats) / sizeof(DDPROF_STATS))
 void unwind_metrics_reset(void) {
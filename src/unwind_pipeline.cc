@@ -0,0 +1,191 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "unwind_pipeline.hpp"
+
+extern "C" {
+#include "ddprof_stats.h"
+#include "ddprof_worker.h"
+#include "ddres.h"
+#include "logger.h"
+#include "perf.h"
+#include "perf_ringbuffer.h"
+
+#include <sched.h>
+#include <string.h>
+}
+
+#include <algorithm>
+
+UnwindPipeline::UnwindPipeline()
+    : _ctx(nullptr), _tid(0), _started(false), _sleeping(false),
+      _stop(false), _fatal(false), _max_used(0), _res(ddres_init()) {
+  memset(&_queue, 0, sizeof(_queue));
+  pthread_mutex_init(&_mutex, nullptr);
+  pthread_cond_init(&_wake_cond, nullptr);
+  pthread_cond_init(&_idle_cond, nullptr);
+}
+
+UnwindPipeline::~UnwindPipeline() {
+  if (_started) {
+    pthread_mutex_lock(&_mutex);
+    _stop = true;
+    pthread_cond_signal(&_wake_cond);
+    pthread_mutex_unlock(&_mutex);
+    pthread_join(_tid, nullptr);
+  }
+  sample_queue_free(&_queue);
+  pthread_cond_destroy(&_idle_cond);
+  pthread_cond_destroy(&_wake_cond);
+  pthread_mutex_destroy(&_mutex);
+}
+
+DDRes UnwindPipeline::start(DDProfContext *ctx, uint64_t capacity) {
+  _ctx = ctx;
+  if (!sample_queue_init(&_queue, capacity)) {
+    DDRES_RETURN_ERROR_LOG(DD_WHAT_BADALLOC,
+                           "Unable to allocate sample queue (%lu bytes)",
+                           capacity);
+  }
+  if (pthread_create(&_tid, nullptr, thread_entry, this)) {
+    DDRES_RETURN_ERROR_LOG(DD_WHAT_WORKERLOOP_INIT,
+                           "Unable to create unwinding thread");
+  }
+  _started = true;
+  return ddres_init();
+}
+
+// The user stack is the last field of our samples : only keep the part of it
+// that was actually captured (dyn_size). The stack can be read from two parts
+// when the record wraps around the ring buffer.
+bool UnwindPipeline::push_trimmed_sample(const RecordView *view, int pos) {
+  struct perf_event_header *hdr = view->hdr;
+  uint64_t prefix_sz = sample_stack_offset(DEFAULT_SAMPLE_TYPE);
+  uint64_t raw_size =
+      reinterpret_cast<const uint64_t *>(
+          reinterpret_cast<const char *>(hdr) + prefix_sz)[-1];
+  uint64_t raw_aligned = (raw_size + 0x7UL) & ~0x7UL;
+  if (!raw_size || prefix_sz + raw_aligned + sizeof(uint64_t) != hdr->size) {
+    // Nothing to trim or unexpected layout, keep the record as is
+    // (records without a stack are contiguous)
+    return !view->wrap && sample_queue_push(&_queue, hdr, pos);
+  }
+
+  perf_event_sample *sample = view2samp(view, DEFAULT_SAMPLE_TYPE);
+  uint64_t kept_sz = (sample->size_stack + 0x7UL) & ~0x7UL;
+  uint64_t size = prefix_sz + kept_sz + sizeof(uint64_t);
+  char *dst =
+      reinterpret_cast<char *>(sample_queue_reserve(&_queue, size, pos));
+  if (!dst) {
+    return false;
+  }
+  memcpy(dst, hdr, prefix_sz);
+  reinterpret_cast<perf_event_header *>(dst)->size = size;
+  memcpy(dst + prefix_sz - sizeof(uint64_t), &kept_sz, sizeof(uint64_t));
+  uint64_t head_sz = std::min(kept_sz, sample->size_stack_head);
+  memcpy(dst + prefix_sz, sample->data_stack, head_sz);
+  if (kept_sz > head_sz) {
+    memcpy(dst + prefix_sz + head_sz, sample->data_stack_wrap,
+           kept_sz - head_sz);
+  }
+  memcpy(dst + prefix_sz + kept_sz, &sample->size_stack, sizeof(uint64_t));
+  sample_queue_commit(&_queue);
+  return true;
+}
+
+void UnwindPipeline::notify_consumer() {
+  // Pairs with the fence in consume : either the unwinder sees the new head,
+  // or we see it sleeping
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&_sleeping, __ATOMIC_RELAXED)) {
+    pthread_mutex_lock(&_mutex);
+    pthread_cond_signal(&_wake_cond);
+    pthread_mutex_unlock(&_mutex);
+  }
+}
+
+DDRes UnwindPipeline::push_event(const RecordView *view, int pos) {
+  struct perf_event_header *hdr = view->hdr;
+  if (__atomic_load_n(&_fatal, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&_mutex);
+    DDRes res = _res;
+    pthread_mutex_unlock(&_mutex);
+    return res;
+  }
+
+  if (hdr->type == PERF_RECORD_SAMPLE) {
+    if (!push_trimmed_sample(view, pos)) {
+      ddprof_stats_add(STATS_SAMPLE_QUEUE_DROPS, 1, NULL);
+      return ddres_init();
+    }
+  } else {
+    while (!sample_queue_push(&_queue, hdr, pos)) {
+      notify_consumer();
+      sched_yield();
+    }
+  }
+  uint64_t used = sample_queue_used(&_queue);
+  if (used > _max_used) {
+    _max_used = used;
+  }
+  notify_consumer();
+  return ddres_init();
+}
+
+DDRes UnwindPipeline::quiesce() {
+  pthread_mutex_lock(&_mutex);
+  while (!(_sleeping && sample_queue_used(&_queue) == 0)) {
+    pthread_cond_wait(&_idle_cond, &_mutex);
+  }
+  DDRes res = _res;
+  _res = ddres_init();
+  pthread_mutex_unlock(&_mutex);
+  return res;
+}
+
+void UnwindPipeline::cycle_stats() {
+  ddprof_stats_set(STATS_SAMPLE_QUEUE_DEPTH, _max_used);
+  _max_used = 0;
+}
+
+void *UnwindPipeline::thread_entry(void *arg) {
+  static_cast<UnwindPipeline *>(arg)->consume();
+  return nullptr;
+}
+
+void UnwindPipeline::consume() {
+  while (true) {
+    int pos;
+    struct perf_event_header *hdr = sample_queue_front(&_queue, &pos);
+    if (hdr) {
+      DDRes res = ddprof_worker_process_event(hdr, pos, _ctx);
+      sample_queue_pop(&_queue);
+      if (IsDDResNotOK(res)) {
+        pthread_mutex_lock(&_mutex);
+        if (!IsDDResFatal(_res)) {
+          _res = res;
+          __atomic_store_n(&_fatal, IsDDResFatal(res), __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&_mutex);
+      }
+      continue;
+    }
+
+    // Out of work : sleep until the reader pushes something
+    pthread_mutex_lock(&_mutex);
+    __atomic_store_n(&_sleeping, true, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!_stop && sample_queue_used(&_queue) == 0) {
+      pthread_cond_broadcast(&_idle_cond);
+      pthread_cond_wait(&_wake_cond, &_mutex);
+    }
+    bool stop = _stop;
+    __atomic_store_n(&_sleeping, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&_mutex);
+    if (stop) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,189 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "worker_shard.hpp"
+
+extern "C" {
+#include "ddres.h"
+#include "logger.h"
+}
+
+#include <string.h>
+
+void WorkerShard::push_sample(const UnwindOutput *output, uint64_t value,
+                              int pos) {
+  _locs.insert(_locs.end(), output->locs, output->locs + output->nb_locs);
+  _samples.push_back(
+      PendingSample{value, pos, static_cast<unsigned>(output->nb_locs)});
+}
+
+void WorkerShard::push_sideband(const perf_event_header *hdr, int pos) {
+  // Records are 8 bytes aligned : prefix them with a 64 bits position
+  std::vector<char> &buf = _sideband[_round_parity];
+  size_t offset = buf.size();
+  uint64_t pos64 = pos;
+  buf.resize(offset + sizeof(pos64) + hdr->size);
+  memcpy(&buf[offset], &pos64, sizeof(pos64));
+  memcpy(&buf[offset + sizeof(pos64)], hdr, hdr->size);
+}
+
+WorkerShardPool::WorkerShardPool(int nb_shards)
+    : _res(nb_shards, ddres_init()), _round(0), _pending(0), _stop(false),
+      _fun(nullptr) {
+  for (int i = 0; i < nb_shards; ++i) {
+    _shards.emplace_back(new WorkerShard(i));
+  }
+  pthread_mutex_init(&_mutex, nullptr);
+  pthread_cond_init(&_start_cond, nullptr);
+  pthread_cond_init(&_done_cond, nullptr);
+}
+
+WorkerShardPool::~WorkerShardPool() {
+  pthread_mutex_lock(&_mutex);
+  _stop = true;
+  pthread_cond_broadcast(&_start_cond);
+  pthread_mutex_unlock(&_mutex);
+  for (pthread_t tid : _tids) {
+    pthread_join(tid, nullptr);
+  }
+  pthread_cond_destroy(&_done_cond);
+  pthread_cond_destroy(&_start_cond);
+  pthread_mutex_destroy(&_mutex);
+}
+
+DDRes WorkerShardPool::start(const PEventHdr *pevent_hdr) {
+  // All watchers of a given CPU land in the same shard
+  for (size_t k = 0; k < pevent_hdr->size; ++k) {
+    if (!pevent_hdr->pes[k].rb.region) {
+      continue; // redirected to another ring buffer
+    }
+    int shard_idx = pevent_hdr->pes[k].cpu % size();
+    _shards[shard_idx]->_pevent_idx.push_back(k);
+  }
+
+  _thread_args.resize(size());
+  _tids.reserve(size());
+  for (int i = 1; i < size(); ++i) {
+    _thread_args[i] = ThreadArg{this, i};
+    pthread_t tid;
+    if (pthread_create(&tid, nullptr, thread_entry, &_thread_args[i])) {
+      DDRES_RETURN_ERROR_LOG(DD_WHAT_WORKERLOOP_INIT,
+                             "Unable to create worker thread %d", i);
+    }
+    _tids.push_back(tid);
+  }
+  LG_NTC("Draining %lu ring buffers with %d threads", pevent_hdr->size,
+         size());
+  return ddres_init();
+}
+
+DDRes WorkerShardPool::run(const RoundFun &fun) {
+  pthread_mutex_lock(&_mutex);
+  _fun = &fun;
+  _pending = _tids.size();
+  ++_round;
+  pthread_cond_broadcast(&_start_cond);
+  pthread_mutex_unlock(&_mutex);
+
+  run_shard(*_shards[0]);
+
+  pthread_mutex_lock(&_mutex);
+  while (_pending) {
+    pthread_cond_wait(&_done_cond, &_mutex);
+  }
+  _fun = nullptr;
+  pthread_mutex_unlock(&_mutex);
+
+  DDRes res = ddres_init();
+  for (const DDRes &shard_res : _res) {
+    if (IsDDResFatal(shard_res)) {
+      return shard_res;
+    }
+    if (IsDDResNotOK(shard_res)) {
+      res = shard_res;
+    }
+  }
+  return res;
+}
+
+DDRes WorkerShardPool::aggregate(UnwindOutput *output,
+                                 const AggregateFun &fun) {
+  DDRes res = ddres_init();
+  for (std::unique_ptr<WorkerShard> &shard : _shards) {
+    const FunLoc *locs = shard->_locs.data();
+    for (const PendingSample &sample : shard->_samples) {
+      if (IsDDResNotOK(res)) {
+        break;
+      }
+      memcpy(output->locs, locs, sample.nb_locs * sizeof(FunLoc));
+      output->nb_locs = sample.nb_locs;
+      locs += sample.nb_locs;
+      res = fun(output, &shard->_us.symbol_hdr, sample.value, sample.pos);
+    }
+    shard->clear_samples();
+  }
+  return res;
+}
+
+void *WorkerShardPool::thread_entry(void *arg) {
+  ThreadArg *thread_arg = static_cast<ThreadArg *>(arg);
+  WorkerShardPool *pool = thread_arg->pool;
+  WorkerShard &shard = *pool->_shards[thread_arg->idx];
+  unsigned seen_round = 0;
+
+  pthread_mutex_lock(&pool->_mutex);
+  while (true) {
+    while (!pool->_stop && pool->_round == seen_round) {
+      pthread_cond_wait(&pool->_start_cond, &pool->_mutex);
+    }
+    if (pool->_stop) {
+      break;
+    }
+    seen_round = pool->_round;
+    pthread_mutex_unlock(&pool->_mutex);
+
+    pool->run_shard(shard);
+
+    pthread_mutex_lock(&pool->_mutex);
+    if (--pool->_pending == 0) {
+      pthread_cond_signal(&pool->_done_cond);
+    }
+  }
+  pthread_mutex_unlock(&pool->_mutex);
+  return nullptr;
+}
+
+void WorkerShardPool::run_shard(WorkerShard &shard) {
+  replay_sideband(shard);
+  shard._round_parity = _round & 1;
+  shard._sideband[shard._round_parity].clear();
+  try {
+    _res[shard._idx] = (*_fun)(shard);
+  } catch (...) {
+    LG_ERR("Unexpected exception in worker shard %d", shard._idx);
+    _res[shard._idx] = ddres_error(DD_WHAT_UKNWEXCEPT);
+  }
+}
+
+void WorkerShardPool::replay_sideband(WorkerShard &shard) {
+  // Events recorded by other shards during the previous round. Nobody writes
+  // to these buffers during the current round.
+  unsigned prev_parity = (_round - 1) & 1;
+  for (const std::unique_ptr<WorkerShard> &other : _shards) {
+    if (other.get() == &shard) {
+      continue;
+    }
+    const std::vector<char> &buf = other->_sideband[prev_parity];
+    size_t offset = 0;
+    while (offset < buf.size()) {
+      uint64_t pos64;
+      memcpy(&pos64, &buf[offset], sizeof(pos64));
+      offset += sizeof(pos64);
+      perf_event_header *hdr = (perf_event_header *)(&buf[offset]);
+      ddprof::worker_shard_replay_event(hdr, pos64, &shard);
+      offset += hdr->size;
+    }
+  }
+}
@@ -0,0 +1,79 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "build_id.hpp"
+
+#include "loghandle.hpp"
+
+#include <elf.h>
+#include <gtest/gtest.h>
+#include <link.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+namespace ddprof {
+
+TEST(BuildIdTest, format) {
+  const unsigned char bits[] = {0x01, 0xab, 0xf0};
+  EXPECT_EQ(format_build_id(bits, 3), "01abf0");
+  EXPECT_EQ(format_build_id(bits, 0), "");
+  EXPECT_EQ(format_build_id(nullptr, 3), "");
+}
+
+TEST(BuildIdTest, notes) {
+  // an ABI tag note followed by a build-id note
+  struct {
+    Elf64_Nhdr _abi_hdr;
+    char _abi_name[4];
+    uint32_t _abi_desc[4];
+    Elf64_Nhdr _build_id_hdr;
+    char _build_id_name[4];
+    unsigned char _build_id[6];
+  } notes = {{4, 16, NT_GNU_ABI_TAG},
+             "GNU",
+             {0, 3, 2, 0},
+             {4, 6, NT_GNU_BUILD_ID},
+             "GNU",
+             {0xde, 0xad, 0xbe, 0xef, 0x00, 0x01}};
+  const char *buf = reinterpret_cast<const char *>(&notes);
+  EXPECT_EQ(build_id_from_notes(buf, sizeof(notes)), "deadbeef0001");
+  // truncated
+  size_t build_id_end = offsetof(decltype(notes), _build_id) + 6;
+  EXPECT_EQ(build_id_from_notes(buf, build_id_end), "deadbeef0001");
+  EXPECT_EQ(build_id_from_notes(buf, build_id_end - 1), "");
+  EXPECT_EQ(build_id_from_notes(buf, sizeof(Elf64_Nhdr) + 4), "");
+}
+
+namespace {
+int find_exe_build_id(struct dl_phdr_info *info, size_t, void *data) {
+  // main program is the first object
+  BuildId *build_id = static_cast<BuildId *>(data);
+  for (int i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr) &phdr = info->dlpi_phdr[i];
+    if (phdr.p_type == PT_NOTE && build_id->empty()) {
+      *build_id = build_id_from_notes(
+          reinterpret_cast<const char *>(info->dlpi_addr + phdr.p_vaddr),
+          phdr.p_memsz, phdr.p_align == 8 ? 8 : 4);
+    }
+  }
+  return 1;
+}
+} // namespace
+
+TEST(BuildIdTest, read_self) {
+  LogHandle handle;
+  // compare with the notes mapped in memory
+  BuildId expected;
+  dl_iterate_phdr(find_exe_build_id, &expected);
+  BuildId build_id = read_build_id("/proc/self/exe");
+  EXPECT_EQ(build_id, expected);
+  EXPECT_EQ(build_id.find_first_not_of("0123456789abcdef"), std::string::npos);
+
+  EXPECT_EQ(read_build_id(IPC_TEST_DATA "/procutils_test.txt"), "");
+  EXPECT_EQ(read_build_id("/not/a/file"), "");
+}
+
+} // namespace ddprof
@@ -0,0 +1,228 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "cfi_table.hpp"
+
+#include "loghandle.hpp"
+
+#include <execinfo.h>
+#include <gelf.h>
+#include <gtest/gtest.h>
+#include <link.h>
+#include <string.h>
+#include <vector>
+
+namespace ddprof {
+
+namespace {
+void push_u32(std::vector<uint8_t> &buf, uint32_t val) {
+  uint8_t bytes[sizeof(val)];
+  memcpy(bytes, &val, sizeof(val));
+  buf.insert(buf.end(), bytes, bytes + sizeof(val));
+}
+
+void set_u32(std::vector<uint8_t> &buf, size_t pos, uint32_t val) {
+  memcpy(&buf[pos], &val, sizeof(val));
+}
+
+// Append an entry (CIE or FDE), patching its length
+void push_entry(std::vector<uint8_t> &buf, uint32_t id,
+                const std::vector<uint8_t> &content) {
+  size_t start = buf.size();
+  push_u32(buf, 0);
+  push_u32(buf, id);
+  buf.insert(buf.end(), content.begin(), content.end());
+  while ((buf.size() - start) % 8) {
+    buf.push_back(0); // DW_CFA_nop
+  }
+  set_u32(buf, start, buf.size() - start - 4);
+}
+
+// Typical prologue / epilogue of a function using rbp as frame pointer
+std::vector<uint8_t> build_eh_frame() {
+  std::vector<uint8_t> eh_frame;
+  push_entry(eh_frame, 0,
+             {
+                 1,                // version
+                 'z', 'R', 0,      // augmentation
+                 1,                // code alignment
+                 0x78,             // data alignment (-8)
+                 16,               // return address register
+                 1, 0x03,          // augmentation data : udata4 pointers
+                 0x0c, 7, 8,       // def_cfa rsp+8
+                 0x80 | 16, 1,     // offset ra, cfa-8
+             });
+  std::vector<uint8_t> fde;
+  push_u32(fde, 0x1000); // pc_begin
+  push_u32(fde, 0x20);   // pc_range
+  fde.insert(fde.end(),
+             {
+                 0,            // augmentation data length
+                 0x40 | 1,     // advance_loc 1
+                 0x0e, 16,     // def_cfa_offset 16
+                 0x80 | 6, 2,  // offset rbp, cfa-16
+                 0x40 | 3,     // advance_loc 3
+                 0x0d, 6,      // def_cfa_register rbp
+                 0x40 | 0x10,  // advance_loc 16
+                 0x0c, 7, 8,   // def_cfa rsp+8
+             });
+  // the CIE pointer is relative to its own position
+  push_entry(eh_frame, eh_frame.size() + 4, fde);
+  push_u32(eh_frame, 0); // terminator
+  return eh_frame;
+}
+
+bool read_fake_stack(ProcessAddress_t addr, ElfWord_t *result, void *arg) {
+  const std::vector<ElfWord_t> &stack =
+      *static_cast<const std::vector<ElfWord_t> *>(arg);
+  if (addr % sizeof(ElfWord_t) || addr / sizeof(ElfWord_t) >= stack.size()) {
+    return false;
+  }
+  *result = stack[addr / sizeof(ElfWord_t)];
+  return true;
+}
+} // namespace
+
+TEST(CfiTableTest, ParseRows) {
+  LogHandle handle;
+  std::vector<uint8_t> eh_frame = build_eh_frame();
+  CfiTable table;
+  ASSERT_TRUE(table.parse_eh_frame(eh_frame.data(), eh_frame.size(), 0));
+  EXPECT_EQ(table.size(), 5);
+
+  EXPECT_EQ(table.find(0xfff), nullptr);
+  const CfiRow *row = table.find(0x1000);
+  ASSERT_TRUE(row);
+  EXPECT_EQ(row->cfa_rule, cfi::kCfaRsp);
+  EXPECT_EQ(row->cfa_offset, 8);
+  EXPECT_EQ(row->rbp_rule, cfi::kRegSame);
+  EXPECT_EQ(row->ra_rule, cfi::kRegOffset);
+  EXPECT_EQ(row->ra_offset, -8);
+
+  row = table.find(0x1003);
+  ASSERT_TRUE(row);
+  EXPECT_EQ(row->cfa_rule, cfi::kCfaRsp);
+  EXPECT_EQ(row->cfa_offset, 16);
+  EXPECT_EQ(row->rbp_rule, cfi::kRegOffset);
+  EXPECT_EQ(row->rbp_offset, -16);
+
+  row = table.find(0x1010);
+  ASSERT_TRUE(row);
+  EXPECT_EQ(row->cfa_rule, cfi::kCfaRbp);
+  EXPECT_EQ(row->cfa_offset, 16);
+
+  row = table.find(0x101f);
+  ASSERT_TRUE(row);
+  EXPECT_EQ(row->cfa_rule, cfi::kCfaRsp);
+  EXPECT_EQ(row->cfa_offset, 8);
+
+  EXPECT_EQ(table.find(0x1020), nullptr);
+}
+
+TEST(CfiTableTest, Step) {
+  std::vector<uint8_t> eh_frame = build_eh_frame();
+  CfiTable table;
+  ASSERT_TRUE(table.parse_eh_frame(eh_frame.data(), eh_frame.size(), 0));
+
+  // Within the body of the function : caller's rbp and return address are
+  // pushed right above the frame
+  std::vector<ElfWord_t> stack(16, 0);
+  stack[10] = 0xcafe; // saved rbp
+  stack[11] = 0x4242; // return address
+  UnwindRegisters regs;
+  regs.esp = 8 * sizeof(ElfWord_t);
+  regs.ebp = 10 * sizeof(ElfWord_t);
+  regs.eip = 0x1008;
+  UnwindRegisters caller;
+  const CfiRow *row = table.find(regs.eip);
+  ASSERT_TRUE(row);
+  EXPECT_EQ(cfi_step(*row, regs, &caller, read_fake_stack, &stack),
+            cfi::kStepOk);
+  EXPECT_EQ(caller.eip, 0x4242);
+  EXPECT_EQ(caller.ebp, 0xcafe);
+  EXPECT_EQ(caller.esp, 12 * sizeof(ElfWord_t));
+
+  // Reads outside of the stack fail
+  regs.ebp = 15 * sizeof(ElfWord_t);
+  EXPECT_EQ(cfi_step(*row, regs, &caller, read_fake_stack, &stack),
+            cfi::kStepError);
+}
+
+namespace {
+const int k_nb_frames = 3;
+
+int phdr_callback(struct dl_phdr_info *info, size_t, void *data) {
+  // first object is the main program
+  *static_cast<ElfAddress_t *>(data) = info->dlpi_addr;
+  return 1;
+}
+
+bool read_self(ProcessAddress_t addr, ElfWord_t *result, void *) {
+  *result = *reinterpret_cast<const ElfWord_t *>(addr);
+  return true;
+}
+
+// Unwind the current stack with the tables and compare with backtrace
+__attribute__((noinline)) int check_unwind() {
+  UnwindRegisters regs;
+  __asm__ volatile("lea 0(%%rip), %0\n"
+                   "mov %%rsp, %1\n"
+                   "mov %%rbp, %2\n"
+                   : "=r"(regs.eip), "=r"(regs.esp), "=r"(regs.ebp));
+  // backtrace can be intercepted (sanitizers) : leave room for extra frames
+  void *bt[k_nb_frames + 4];
+  int nb_bt = backtrace(bt, k_nb_frames + 4);
+
+  CfiTable table;
+  EXPECT_TRUE(table.load("/proc/self/exe"));
+  ElfAddress_t bias = 0;
+  dl_iterate_phdr(phdr_callback, &bias);
+  std::vector<ElfAddress_t> pcs;
+  for (int i = 0; i < k_nb_frames; ++i) {
+    // return addresses point after the call
+    ElfAddress_t addr = regs.eip - bias - (i ? 1 : 0);
+    const CfiRow *row = table.find(addr);
+    EXPECT_TRUE(row);
+    if (!row) {
+      return -1;
+    }
+    UnwindRegisters caller;
+    EXPECT_EQ(cfi_step(*row, regs, &caller, read_self, nullptr),
+              cfi::kStepOk);
+    pcs.push_back(caller.eip);
+    regs = caller;
+  }
+  int first = 0;
+  while (first < nb_bt &&
+         reinterpret_cast<ElfAddress_t>(bt[first]) != pcs[0]) {
+    ++first;
+  }
+  EXPECT_LE(first + k_nb_frames, nb_bt);
+  for (int i = 0; i < k_nb_frames && first + i < nb_bt; ++i) {
+    EXPECT_EQ(pcs[i], reinterpret_cast<ElfAddress_t>(bt[first + i]));
+  }
+  return 0;
+}
+
+__attribute__((noinline)) int call_2() {
+  int res = check_unwind();
+  __asm__ volatile("" ::: "memory"); // avoid tail calls
+  return res + 1;
+}
+
+__attribute__((noinline)) int call_1() {
+  int res = call_2();
+  __asm__ volatile("" ::: "memory");
+  return res + 1;
+}
+} // namespace
+
+TEST(CfiTableTest, SelfUnwind) {
+  LogHandle handle;
+  elf_version(EV_CURRENT);
+  EXPECT_EQ(call_1(), 2);
+}
+
+} // namespace ddprof
@@ -22,7 +22,8 @@ extern "C" {
 
 namespace ddprof {
 // todo : cut this dependency
-DwflSymbolLookup_V2::DwflSymbolLookup_V2() : _lookup_setting(K_CACHE_ON) {}
+DwflSymbolLookup_V2::DwflSymbolLookup_V2()
+    : _lookup_setting(K_CACHE_ON), _eager_symbols(false), _line_info(true) {}
 
 // Mock
 int get_nb_hw_thread() { return 2; }
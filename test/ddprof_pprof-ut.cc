@@ -23,7 +23,8 @@ extern "C" {
 
 namespace ddprof {
 // todo : cut this dependency
-DwflSymbolLookup_V2::DwflSymbolLookup_V2() : _lookup_setting(K_CACHE_ON) {}
+DwflSymbolLookup_V2::DwflSymbolLookup_V2()
+    : _lookup_setting(K_CACHE_ON), _eager_symbols(false), _line_info(true) {}
 
 TEST(DDProfPProf, init_profiles) {
   DDProfPProf pprofs;
@@ -5,6 +5,8 @@
 
 #include "llvm/Demangle/Demangle.h"
 
+#include "symbol_table.hpp"
+
 #include <gtest/gtest.h>
 
 struct test_case {
@@ -42,3 +44,33 @@ TEST(DemangleTest, Positive) {
     EXPECT_EQ(demangled_func, tcase.answer);
   }
 }
+
+namespace ddprof {
+
+TEST(DemangleTest, SymbolTable) {
+  SymbolTable table;
+  // same function seen in two processes
+  table.push_back(Symbol(table.intern("_Z3fooi"), InternedString(), 0,
+                         InternedString()));
+  table.push_back(Symbol(table.intern("_Z3fooi"), InternedString(), 0,
+                         InternedString()));
+  table.push_back(Symbol(table.intern("bar"), InternedString(), 0,
+                         InternedString()));
+  // names that do not come from a symbol table are kept
+  table.push_back(Symbol(InternedString(), table.intern("[unknown_dso]"), 0,
+                         InternedString()));
+  EXPECT_TRUE(table[0]._demangle_name.empty());
+  EXPECT_EQ(table.nb_demangled(), 0);
+
+  EXPECT_EQ(table.demangled(0)._demangle_name.str(), "foo(int)");
+  EXPECT_EQ(table.demangled(1)._demangle_name.c_str(),
+            table[0]._demangle_name.c_str());
+  EXPECT_EQ(table.nb_demangled(), 1);
+  EXPECT_EQ(table.demangled(2)._demangle_name.str(), "bar");
+  EXPECT_EQ(table.demangled(3)._demangle_name.str(), "[unknown_dso]");
+  EXPECT_EQ(table.nb_demangled(), 2);
+  // mangled names are kept
+  EXPECT_EQ(table[0]._symname.str(), "_Z3fooi");
+}
+
+} // namespace ddprof
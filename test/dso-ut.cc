@@ -6,7 +6,11 @@
 #include "dso_hdr.hpp"
 
 #include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
+#include <unistd.h>
+#include <vector>
 
 #include "loghandle.hpp"
 namespace ddprof {
@@ -23,25 +27,54 @@ using DsoRange = DsoHdr::DsoRange;
 // <DEBUG>Dec 12 16:20:50 dso-ut[60184]: [DSO] : Insert PID[10] 7d0-9c4 0 ()(T-Anonymous)(x)(ID#-1)
 // clang-format on
 
-Dso build_dso_5_1500() { return Dso(5, 1500, 1999, 10, "foo.so.1"); }
+// filenames of the DSOs built by the tests
+StringInterner s_filenames;
 
-Dso build_dso_10_1000() { return Dso(10, 1000, 1199, 0, "bar.so.1"); }
+Dso build_dso_5_1500() {
+  return Dso(5, 1500, 1999, 10, s_filenames.intern("foo.so.1"));
+}
+
+Dso build_dso_10_1000() {
+  return Dso(10, 1000, 1199, 0, s_filenames.intern("bar.so.1"));
+}
 
-Dso build_dso_10_1000_dupe() { return Dso(10, 1000, 1499, 0, "bar.so.1"); }
+Dso build_dso_10_1000_dupe() {
+  return Dso(10, 1000, 1499, 0, s_filenames.intern("bar.so.1"));
+}
 
 Dso build_dso_10_2000() { return Dso(10, 2000, 2500); }
 
 Dso build_dso_10_1500() { return Dso(10, 1500, 1999); }
 
-Dso build_dso_vdso() { return Dso(10, 12, 13, 14, "[vdso]/usr/var/12"); }
+Dso build_dso_vdso() {
+  return Dso(10, 12, 13, 14, s_filenames.intern("[vdso]/usr/var/12"));
+}
 
-Dso build_dso_vsyscall() { return Dso(0, 0, 0, 7, "[vsyscall]/some/syscall"); }
+Dso build_dso_vsyscall() {
+  return Dso(0, 0, 0, 7, s_filenames.intern("[vsyscall]/some/syscall"));
+}
 
 Dso build_dso_file_10_2500() {
-  std::string fileName = IPC_TEST_DATA "/dso_test_data.so";
   // not using the current pid would fail (as we need to access the file in the
   // context of the process)
-  return Dso(getpid(), 2501, 2510, 0, std::move(fileName));
+  return Dso(getpid(), 2501, 2510, 0,
+             s_filenames.intern(IPC_TEST_DATA "/dso_test_data.so"));
+}
+
+TEST(DSOTest, adjust_same_range) {
+  DsoHdr dso_hdr;
+  dso_hdr._map[10].insert(build_dso_10_1000());
+  EXPECT_FALSE(dso_hdr.dso_find_closest(10, 1300).second);
+  DsoFindRes find_res =
+      dso_hdr.dso_find_adjust_same(dso_hdr._map[10], build_dso_10_1000_dupe());
+  ASSERT_TRUE(find_res.second);
+  EXPECT_EQ(find_res.first->_end, 1499);
+  // lookups see the adjusted range
+  find_res = dso_hdr.dso_find_closest(10, 1300);
+  ASSERT_TRUE(find_res.second);
+  EXPECT_EQ(find_res.first->_start, 1000);
+  EXPECT_FALSE(dso_hdr.dso_find_closest(10, 1500).second);
+  EXPECT_FALSE(dso_hdr.dso_find_closest(10, 999).second);
 }
 
 /*
@@ -57,7 +90,7 @@ Dso build_dso_file_10_2500() {
 
 void fill_mock_hdr(DsoHdr &dso_hdr) {
   auto insert_res = dso_hdr.insert_erase_overlap(build_dso_5_1500());
-  EXPECT_TRUE(insert_res.first->second._type == dso::kStandard);
+  EXPECT_TRUE(insert_res.first->_type == dso::kStandard);
   EXPECT_TRUE(insert_res.second);
 
   insert_res = dso_hdr.insert_erase_overlap(build_dso_10_1000());
@@ -66,14 +99,14 @@ void fill_mock_hdr(DsoHdr &dso_hdr) {
   // insert with equal key (start and pid)
   insert_res = dso_hdr.insert_erase_overlap(build_dso_10_1000_dupe());
   EXPECT_TRUE(insert_res.second);
-  EXPECT_EQ(insert_res.first->second._start, 1000);
+  EXPECT_EQ(insert_res.first->_start, 1000);
 
   insert_res = dso_hdr.insert_erase_overlap(build_dso_10_2000());
   EXPECT_TRUE(insert_res.second);
 
   insert_res = dso_hdr.insert_erase_overlap(build_dso_10_1500());
   EXPECT_TRUE(insert_res.second);
-  EXPECT_TRUE(insert_res.first->second._type == dso::kAnon);
+  EXPECT_TRUE(insert_res.first->_type == dso::kAnon);
 }
 
 TEST(DSOTest, is_within) {
@@ -83,8 +116,8 @@ TEST(DSOTest, is_within) {
   EXPECT_TRUE(find_res.second);
   DsoHdr::DsoFindRes not_found = dso_hdr.find_res_not_found(10);
   ASSERT_FALSE(find_res == not_found);
-  EXPECT_EQ(find_res.first->second._pid, 10);
-  EXPECT_EQ(find_res.first->second._start, 1000);
+  EXPECT_EQ(find_res.first->_pid, 10);
+  EXPECT_EQ(find_res.first->_start, 1000);
 }
 
 TEST(DSOTest, is_within_2) {
@@ -100,12 +133,12 @@ TEST(DSOTest, intersections) {
   {
     Dso dso_inter(10, 900, 1700);
     DsoRange range = dso_hdr.get_intersection(dso_hdr._map[10], dso_inter);
-    EXPECT_EQ(range.first->second._pid, 10);
-    EXPECT_EQ(range.first->second._start, 1000);
+    EXPECT_EQ(range.first->_pid, 10);
+    EXPECT_EQ(range.first->_start, 1000);
     // contains the 1500 -> 1999 element, WARNING the end element is after the
     // intersection
-    EXPECT_EQ(range.second->second._start, 2000);
-    EXPECT_EQ(range.second->second._end, 2500);
+    EXPECT_EQ(range.second->_start, 2000);
+    EXPECT_EQ(range.second->_end, 2500);
   }
   {
     Dso dso_no(10, 400, 500);
@@ -127,8 +160,8 @@ TEST(DSOTest, intersections) {
     DsoHdr::DsoFindRes not_found = dso_hdr.find_res_not_found(10);
     ASSERT_TRUE(range.first != not_found.first);
     ASSERT_TRUE(range.second != not_found.first);
-    EXPECT_EQ(range.first->second._start, 1000);
-    EXPECT_EQ(range.second->second._start, 1500);
+    EXPECT_EQ(range.first->_start, 1000);
+    EXPECT_EQ(range.second->_start, 1500);
   }
 }
 
@@ -141,6 +174,81 @@ TEST(DSOTest, erase) {
   }
 }
 
+TEST(DSOTest, pid_fork) {
+  DsoHdr dso_hdr;
+  fill_mock_hdr(dso_hdr);
+  int nb_dso = dso_hdr.get_nb_dso();
+  int nb_dso_10 = dso_hdr._map[10].size();
+  dso_hdr._map[10].begin()->_id = 3;
+
+  EXPECT_EQ(dso_hdr.pid_fork(10, 11), nb_dso_10);
+  EXPECT_EQ(dso_hdr.get_nb_dso(), nb_dso + nb_dso_10);
+  auto parent_it = dso_hdr._map[10].begin();
+  for (const Dso &dso : dso_hdr._map[11]) {
+    EXPECT_EQ(dso._pid, 11);
+    EXPECT_EQ(dso._start, parent_it->_start);
+    EXPECT_EQ(dso._end, parent_it->_end);
+    EXPECT_EQ(dso._filename, parent_it->_filename);
+    EXPECT_EQ(dso._id, parent_it->_id);
+    ++parent_it;
+  }
+  DsoHdr::DsoFindRes find_res = dso_hdr.dso_find_closest(11, 1100);
+  ASSERT_TRUE(find_res.second);
+  EXPECT_EQ(find_res.first->_id, 3);
+
+  // the child changes its mappings independently
+  dso_hdr.insert_erase_overlap(Dso(11, 1100, 1700));
+  EXPECT_EQ(dso_hdr._map[10].size(), nb_dso_10);
+
+  // unknown parent : nothing is inherited
+  EXPECT_EQ(dso_hdr.pid_fork(12, 13), 0);
+  EXPECT_TRUE(dso_hdr._map[13].empty());
+}
+
+TEST(DSOTest, pid_fork_replayed_late) {
+  DsoHdr dso_hdr;
+  fill_mock_hdr(dso_hdr);
+  int nb_dso_10 = dso_hdr._map[10].size();
+  // the child exec'd : its mappings are processed before the fork is replayed
+  InternedString exec_bin = s_filenames.intern("exec_bin");
+  dso_hdr.insert_erase_overlap(Dso(11, 5000, 5999, 0, exec_bin));
+  EXPECT_EQ(dso_hdr.pid_fork(10, 11), 0);
+  ASSERT_EQ(dso_hdr._map[11].size(), 1);
+  EXPECT_EQ(dso_hdr._map[11].begin()->_filename, exec_bin);
+  DsoHdr::DsoFindRes find_res = dso_hdr.dso_find_closest(11, 1100);
+  EXPECT_FALSE(find_res.second);
+  EXPECT_EQ(dso_hdr._map[10].size(), nb_dso_10);
+
+  // once the child is freed (exit), a fork of the pid inherits again
+  dso_hdr.pid_free(11);
+  EXPECT_EQ(dso_hdr.pid_fork(10, 11), nb_dso_10);
+}
+
+TEST(DSOTest, generation) {
+  DsoHdr dso_hdr;
+  fill_mock_hdr(dso_hdr);
+  uint64_t gen_5 = dso_hdr.get_generation(5);
+  uint64_t gen_10 = dso_hdr.get_generation(10);
+  EXPECT_NE(gen_5, gen_10);
+  EXPECT_EQ(dso_hdr.get_generation(5), gen_5);
+
+  // new mapping without overlap : cached resolutions are still valid
+  dso_hdr.insert_erase_overlap(Dso(10, 3000, 3500));
+  EXPECT_EQ(dso_hdr.get_generation(10), gen_10);
+
+  // mapping replaced
+  dso_hdr.insert_erase_overlap(Dso(10, 1100, 1700));
+  uint64_t new_gen_10 = dso_hdr.get_generation(10);
+  EXPECT_NE(new_gen_10, gen_10);
+  EXPECT_EQ(dso_hdr.get_generation(5), gen_5);
+
+  // freed pids never get a previous generation back
+  dso_hdr.pid_free(10);
+  uint64_t freed_gen_10 = dso_hdr.get_generation(10);
+  EXPECT_NE(freed_gen_10, gen_10);
+  EXPECT_NE(freed_gen_10, new_gen_10);
+}
+
 TEST(DSOTest, find_same) {
   DsoHdr dso_hdr;
   fill_mock_hdr(dso_hdr);
@@ -149,7 +257,7 @@ TEST(DSOTest, find_same) {
     DsoFindRes find_res =
         dso_hdr.dso_find_adjust_same(dso_hdr._map[10], dso_equal_addr);
     ASSERT_FALSE(find_res.second);
-    EXPECT_EQ(find_res.first->second._start, 1000);
+    EXPECT_EQ(find_res.first->_start, 1000);
   }
 }
 
@@ -199,13 +307,42 @@ TEST(DSOTest, file_dso) {
   DsoFindRes insert_res =
       dso_hdr.insert_erase_overlap(dso_hdr._map[10], build_dso_file_10_2500());
   ASSERT_TRUE(insert_res.second);
-  const Dso &dso = insert_res.first->second;
+  const Dso &dso = *insert_res.first;
   // actual file access here
   const RegionHolder *region = dso_hdr.find_or_insert_region(dso);
   ASSERT_TRUE(region);
   ASSERT_TRUE(region->get_region());
 }
 
+TEST(DSOTest, file_info_build_id) {
+  LogHandle handle;
+  char exe_path[1024] = {};
+  ASSERT_GT(readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1), 0);
+  BuildId build_id = read_build_id(exe_path);
+  if (build_id.empty()) {
+    return; // test binary built without build-id
+  }
+  // copy of the binary : other inode, same build-id
+  char copy_path[] = "/tmp/dso-ut.XXXXXX";
+  int fd = mkstemp(copy_path);
+  ASSERT_NE(fd, -1);
+  close(fd);
+  std::string cmd = std::string("cp ") + exe_path + " " + copy_path;
+  ASSERT_EQ(system(cmd.c_str()), 0);
+
+  DsoHdr dso_hdr;
+  Dso dso(getpid(), 0x1000, 0x1fff, 0, dso_hdr.intern_filename(exe_path));
+  Dso dso_copy(getpid(), 0x3000, 0x3fff, 0, dso_hdr.intern_filename(copy_path));
+  FileInfoId_t id = dso_hdr.get_or_insert_file_info(dso);
+  ASSERT_GT(id, k_file_info_error);
+  EXPECT_EQ(dso_hdr.get_file_info_value(id).get_build_id(), build_id);
+  EXPECT_EQ(dso_hdr.get_or_insert_file_info(dso_copy), id);
+  // latest location is kept
+  EXPECT_NE(dso_hdr.get_file_info_value(id).get_path().find(copy_path),
+            std::string::npos);
+  unlink(copy_path);
+}
+
 // clang-format off
 static const char *s_exec_line = "55d7883a1000-55d7883a5000 r-xp 00002000 fe:01 3287864                    /usr/local/bin/BadBoggleSolver_run";
 static const char *s_exec_line2 = "55d788391000-55d7883a1000 r-xp 00002000 fe:01 0                    /usr/local/bin/BadBoggleSolver_run_2";
@@ -223,42 +360,42 @@ static const char *s_jsa_line = "0x800000000-0x800001fff rw-p 00000000 00:00 0
 // clang-format on
 
 TEST(DSOTest, dso_from_procline) {
+  DsoHdr dso_hdr;
   // todo make dso_from_procline const
   Dso no_exec =
-      DsoHdr::dso_from_procline(10, const_cast<char *>(s_line_noexec));
+      dso_hdr.dso_from_procline(10, const_cast<char *>(s_line_noexec));
   EXPECT_EQ(no_exec._type, dso::kStandard);
   EXPECT_EQ(no_exec._executable, false);
   EXPECT_EQ(no_exec._pid, 10);
   Dso standard_dso =
-      DsoHdr::dso_from_procline(10, const_cast<char *>(s_exec_line));
+      dso_hdr.dso_from_procline(10, const_cast<char *>(s_exec_line));
   { // standard
     EXPECT_EQ(standard_dso._type, dso::kStandard);
   }
   { // vdso
     Dso vdso_dso =
-        DsoHdr::dso_from_procline(10, const_cast<char *>(s_vdso_lib));
+        dso_hdr.dso_from_procline(10, const_cast<char *>(s_vdso_lib));
     EXPECT_EQ(vdso_dso._type, dso::kVdso);
   }
   { // stack
     Dso stack_dso =
-        DsoHdr::dso_from_procline(10, const_cast<char *>(s_stack_line));
+        dso_hdr.dso_from_procline(10, const_cast<char *>(s_stack_line));
     EXPECT_EQ(stack_dso._type, dso::kStack);
   }
   { // inode
     Dso inode_dso =
-        DsoHdr::dso_from_procline(10, const_cast<char *>(s_inode_line));
+        dso_hdr.dso_from_procline(10, const_cast<char *>(s_inode_line));
     EXPECT_EQ(inode_dso._type, dso::kAnon);
   }
   {
     // jsa
-    Dso jsa_dso = DsoHdr::dso_from_procline(10, const_cast<char *>(s_jsa_line));
+    Dso jsa_dso = dso_hdr.dso_from_procline(10, const_cast<char *>(s_jsa_line));
     EXPECT_EQ(jsa_dso._type, dso::kAnon);
   }
-  DsoHdr dso_hdr;
   {
     // check that we don't overlap between lines that end on same byte
     Dso standard_dso_2 =
-        DsoHdr::dso_from_procline(10, const_cast<char *>(s_exec_line2));
+        dso_hdr.dso_from_procline(10, const_cast<char *>(s_exec_line2));
     EXPECT_EQ(standard_dso._type, dso::kStandard);
     dso_hdr.insert_erase_overlap(std::move(standard_dso_2));
     dso_hdr.insert_erase_overlap(std::move(standard_dso));
@@ -267,7 +404,7 @@ TEST(DSOTest, dso_from_procline) {
   {
     // check that we erase everything if we have an overlap
     Dso standard_dso_3 =
-        DsoHdr::dso_from_procline(10, const_cast<char *>(s_exec_line3));
+        dso_hdr.dso_from_procline(10, const_cast<char *>(s_exec_line3));
     EXPECT_EQ(standard_dso._type, dso::kStandard);
     dso_hdr.insert_erase_overlap(std::move(standard_dso_3));
     EXPECT_EQ(dso_hdr.get_nb_dso(), 1);
@@ -275,11 +412,11 @@ TEST(DSOTest, dso_from_procline) {
   {
     // check that we still match element number 3
     Dso standard_dso_4 =
-        DsoHdr::dso_from_procline(10, const_cast<char *>(s_exec_line4));
+        dso_hdr.dso_from_procline(10, const_cast<char *>(s_exec_line4));
     ProcessAddress_t end_4 = standard_dso_4._end;
     DsoFindRes findres =
         dso_hdr.insert_erase_overlap(std::move(standard_dso_4));
-    EXPECT_EQ(findres.first->second._end, end_4);
+    EXPECT_EQ(findres.first->_end, end_4);
   }
 }
 
@@ -298,15 +435,14 @@ TEST(DSOTest, backpopulate) {
   DsoFindRes find_res = dso_hdr.dso_find_or_backpopulate(getpid(), ip);
   ASSERT_TRUE(find_res.second);
   // check that string dso-ut is contained in the dso
-  EXPECT_TRUE(find_res.first->second._filename.find(MYNAME) !=
-              std::string::npos);
+  EXPECT_TRUE(strstr(find_res.first->_filename.c_str(), MYNAME) != nullptr);
   // check that we match the local binary
-  FileInfo file_info = dso_hdr.find_file_info(find_res.first->second);
+  FileInfo file_info = dso_hdr.find_file_info(*find_res.first);
   std::string filename_disk =
       file_info._path.substr(file_info._path.find_last_of("/") + 1);
 
-  std::string filename_procfs = find_res.first->second._filename.substr(
-      find_res.first->second._filename.find_last_of("/") + 1);
+  std::string filename_procfs = find_res.first->_filename.str().substr(
+      find_res.first->_filename.str().find_last_of("/") + 1);
 
   EXPECT_EQ(filename_procfs, filename_disk);
   // manually erase the unit test's binary
@@ -333,8 +469,8 @@ TEST(DSOTest, pid_read_dso) {
   const DsoHdr::DsoMap &map = dso_hdr._map[my_pid];
   bool found = false;
   for (auto it = map.begin(); it != map.end(); ++it) {
-    const Dso &dso = it->second;
-    if (dso._filename.find("c++") != std::string::npos && dso._pgoff == 0) {
+    const Dso &dso = *it;
+    if (strstr(dso._filename.c_str(), "c++") && dso._pgoff == 0) {
       ElfWord_t elf_word = 0;
       DsoHdr::DsoFindRes find_res = dso_hdr.pid_read_dso(
           my_pid, &elf_word, sizeof(ElfWord_t), dso._start + 0x100);
@@ -346,6 +482,38 @@ TEST(DSOTest, pid_read_dso) {
   EXPECT_TRUE(found);
 }
 
+TEST(DSOTest, pid_read) {
+  ElfAddress_t ip = _THIS_IP_;
+  DsoHdr dso_hdr;
+  pid_t my_pid = getpid();
+  DsoHdr::DsoFindRes find_res = dso_hdr.dso_find_or_backpopulate(my_pid, ip);
+  ASSERT_TRUE(find_res.second);
+  const Dso dso = *find_res.first;
+  for (int i = 0; i < 2; ++i) {
+    // second iteration is served from the last read ranges
+    for (ProcessAddress_t addr = dso._start; addr < dso._start + 0x1000;
+         addr += sizeof(ElfWord_t)) {
+      ElfWord_t cached = 0;
+      ElfWord_t uncached = 1;
+      ASSERT_TRUE(dso_hdr.pid_read(my_pid, &cached, sizeof(ElfWord_t), addr));
+      ASSERT_TRUE(dso_hdr
+                      .pid_read_dso(my_pid, &uncached, sizeof(ElfWord_t), addr)
+                      .second);
+      EXPECT_EQ(cached, uncached);
+    }
+  }
+  ElfWord_t elf_word;
+  EXPECT_FALSE(
+      dso_hdr.pid_read(my_pid, &elf_word, sizeof(ElfWord_t), dso._end - 1));
+
+  // erased mappings are no longer read from (backpopulate was already
+  // attempted for this pid)
+  ProcessAddress_t addr = dso._start + 0x100;
+  EXPECT_TRUE(dso_hdr.pid_read(my_pid, &elf_word, sizeof(ElfWord_t), addr));
+  dso_hdr.erase_overlap(dso);
+  EXPECT_FALSE(dso_hdr.pid_read(my_pid, &elf_word, sizeof(ElfWord_t), addr));
+}
+
 // clang-format off
 // Assuming we get a big insertion
 // <DEBUG>Dec 14 14:15:16 ddprof[725]: <0>(MAP)722: /usr/lib/x86_64-linux-gnu/libstdc++.so.6.0.25 (7f51f1d42000/389000/0)
@@ -367,14 +535,15 @@ TEST(DSOTest, mmap_into_backpop) {
   EXPECT_TRUE(nb_elts);
   DsoHdr::DsoMap &map = dso_hdr._map[my_pid];
   bool found = false;
-  for (auto &el : map) {
-    Dso &dso = el.second;
+  for (const Dso &dso : map) {
     // emulate an insert of big size
-    if (dso._filename.find("c++") != std::string::npos && dso._pgoff == 0) {
+    if (strstr(dso._filename.c_str(), "c++") && dso._pgoff == 0) {
       Dso copy(dso);
       copy._end = copy._start + 0x388FFF;
       found = true;
+      // inserting invalidates the iterators of the map
       dso_hdr.insert_erase_overlap(map, std::move(copy));
+      break;
     }
   }
   EXPECT_TRUE(found);
@@ -383,4 +552,92 @@ TEST(DSOTest, mmap_into_backpop) {
   // TODO: To be discussed - should we erase overlaping or not
 }
 
+TEST(DSOTest, dso_map) {
+  DsoMap map;
+  EXPECT_TRUE(map.insert(build_dso_10_2000()).second);
+  auto insert_res = map.insert(build_dso_10_1000());
+  EXPECT_TRUE(insert_res.second);
+  const Dso &dso_1000 = *insert_res.first;
+  EXPECT_TRUE(map.insert(build_dso_10_1500()).second);
+  // same start : the existing dso is kept
+  insert_res = map.insert(build_dso_10_1000_dupe());
+  EXPECT_FALSE(insert_res.second);
+  EXPECT_EQ(insert_res.first->_end, 1199);
+  EXPECT_EQ(map.size(), 3);
+
+  // sorted by start, references are kept across insertions
+  EXPECT_EQ(&*map.begin(), &dso_1000);
+  ProcessAddress_t previous_start = 0;
+  for (const Dso &dso : map) {
+    EXPECT_LT(previous_start, dso._start);
+    previous_start = dso._start;
+  }
+  EXPECT_EQ(map.lower_bound(1001)->_start, 1500);
+  EXPECT_EQ(map.upper_bound(1500)->_start, 2000);
+  EXPECT_TRUE(map.find(1001) == map.end());
+
+  auto it = map.erase(map.find(1500));
+  EXPECT_EQ(it->_start, 2000);
+  EXPECT_EQ(map.size(), 2);
+  // erased slot is reused
+  EXPECT_TRUE(map.insert(build_dso_10_1500()).second);
+  EXPECT_EQ(map.lower_bound(1001)->_start, 1500);
+  EXPECT_EQ(dso_1000._end, 1199);
+
+  map.erase(map.begin(), map.end());
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(DSOTest, dso_map_staged) {
+  DsoMap map;
+  // descending inserts (mmap order) go through the staging level
+  const int nb_dsos = 500;
+  std::vector<const Dso *> dsos;
+  for (int i = nb_dsos - 1; i >= 0; --i) {
+    ProcessAddress_t start = 1000 + i * 100;
+    auto insert_res = map.insert(Dso(10, start, start + 49));
+    ASSERT_TRUE(insert_res.second);
+    EXPECT_EQ(insert_res.first->_start, start);
+    dsos.push_back(&*insert_res.first);
+    EXPECT_FALSE(map.insert(Dso(10, start, start + 10)).second);
+  }
+  EXPECT_EQ(map.size(), nb_dsos);
+  // references are kept across merges
+  EXPECT_EQ(dsos.front()->_start, 1000 + (nb_dsos - 1) * 100);
+  EXPECT_EQ(dsos.back()->_start, 1000);
+
+  ProcessAddress_t previous_start = 0;
+  for (const Dso &dso : map) {
+    EXPECT_LT(previous_start, dso._start);
+    previous_start = dso._start;
+  }
+  int nb_reverse = 0;
+  for (auto it = map.end(); it != map.begin();) {
+    --it;
+    EXPECT_EQ(it->_start, previous_start);
+    previous_start -= 100;
+    ++nb_reverse;
+  }
+  EXPECT_EQ(nb_reverse, nb_dsos);
+
+  // lookups see both levels, whatever the level a dso is in
+  map.insert(Dso(10, 1060, 1079));
+  for (int i = 0; i < nb_dsos; ++i) {
+    bool is_within;
+    auto it = map.find_closest(1000 + i * 100 + 20, &is_within);
+    EXPECT_TRUE(is_within);
+    EXPECT_EQ(it->_start, 1000 + i * 100);
+    map.find_closest(1000 + i * 100 + 70, &is_within);
+    EXPECT_EQ(is_within, i == 0);
+  }
+  bool is_within;
+  EXPECT_TRUE(map.find_closest(999, &is_within) == map.end());
+
+  // the erased range spans both levels
+  auto it = map.erase(map.lower_bound(1000), map.lower_bound(2000));
+  EXPECT_EQ(it->_start, 2000);
+  EXPECT_EQ(map.size(), nb_dsos - 10);
+  EXPECT_EQ(map.begin()->_start, 2000);
+}
+
 } // namespace ddprof
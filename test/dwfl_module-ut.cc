@@ -2,6 +2,7 @@
 
 #include "dso_hdr.hpp"
 #include "dwfl_hdr.hpp"
+#include "dwfl_symbol.hpp"
 
 #include <gtest/gtest.h>
 #include <string>
@@ -33,8 +34,7 @@ TEST(DwflModule, inconsistency_test) {
   // retrieve the map associated to pid
   DsoHdr::DsoMap &dso_map = dso_hdr._map[my_pid];
 
-  for (auto &tmp_dso : dso_map) {
-    const Dso &dso = tmp_dso.second;
+  for (const Dso &dso : dso_map) {
     if (dso._type != dso::kStandard || !dso._executable) {
       continue; // skip non exec / non standard (anon/vdso...)
     }
@@ -53,11 +53,12 @@ TEST(DwflModule, inconsistency_test) {
   {
     // attempt loading a bad DSO that overlap with existing
     // Create a DSO from the unit test DSO
-    const Dso &ut_dso = find_res.first->second;
+    const Dso &ut_dso = *find_res.first;
     Dso bad_dso(ut_dso);
     bad_dso._id = k_file_info_undef;
     // Test file to avoid matching file names
-    bad_dso._filename = DWFL_TEST_DATA "/dso_test_data.so";
+    bad_dso._filename =
+        dso_hdr.intern_filename(DWFL_TEST_DATA "/dso_test_data.so");
     bad_dso._start += 1; // offset to avoid matching previous dso
 
     FileInfoId_t file_info_id = dso_hdr.get_or_insert_file_info(bad_dso);
@@ -72,4 +73,88 @@ TEST(DwflModule, inconsistency_test) {
   }
 }
 
+TEST(DwflModule, shared_elf) {
+  LogHandle handle;
+  ElfAddress_t ip = _THIS_IP_;
+  DsoHdr dso_hdr;
+  pid_t my_pid = getpid();
+  DsoHdr::DsoFindRes find_res = dso_hdr.dso_find_or_backpopulate(my_pid, ip);
+  ASSERT_TRUE(find_res.second);
+  const Dso &dso = *find_res.first;
+  FileInfoId_t file_info_id = dso_hdr.get_or_insert_file_info(dso);
+  ASSERT_TRUE(file_info_id > k_file_info_error);
+  const FileInfoValue &file_info_value =
+      dso_hdr.get_file_info_value(file_info_id);
+
+  // Two pids mapping the same file share the Elf handle
+  ElfCache elf_cache;
+  DwflWrapper dwfl_wrappers[2];
+  Elf *elfs[2];
+  for (int i = 0; i < 2; ++i) {
+    DDProfMod ddprof_mod = update_module(dwfl_wrappers[i]._dwfl, ip, dso,
+                                         file_info_value, &elf_cache);
+    ASSERT_TRUE(ddprof_mod._mod);
+    EXPECT_EQ(ddprof_mod._low_addr, dso._start - dso._pgoff);
+    GElf_Addr bias;
+    elfs[i] = dwfl_module_getelf(ddprof_mod._mod, &bias);
+    ASSERT_TRUE(elfs[i]);
+    // Symbolization matches a module loaded from the file
+    GElf_Off offset;
+    GElf_Sym sym;
+    const char *name = dwfl_module_addrinfo(ddprof_mod._mod, ip, &offset, &sym,
+                                            nullptr, nullptr, nullptr);
+    ASSERT_TRUE(name);
+    EXPECT_NE(std::string(name).find("shared_elf"), std::string::npos);
+  }
+  EXPECT_EQ(elfs[0], elfs[1]);
+  EXPECT_EQ(elf_cache.size(), 1);
+
+  elf_cache.evict_unreferenced({file_info_id});
+  EXPECT_EQ(elf_cache.size(), 1);
+  // Modules keep their own reference on the mapped image
+  elf_cache.evict_unreferenced({});
+  EXPECT_EQ(elf_cache.size(), 0);
+  Dwfl_Module *mod = dwfl_addrmodule(dwfl_wrappers[0]._dwfl, ip);
+  ASSERT_TRUE(mod);
+  GElf_Off offset;
+  GElf_Sym sym;
+  const char *name = dwfl_module_addrinfo(mod, ip, &offset, &sym, nullptr,
+                                          nullptr, nullptr);
+  ASSERT_TRUE(name);
+  EXPECT_NE(std::string(name).find("shared_elf"), std::string::npos);
+}
+
+TEST(DwflModule, line_info) {
+  LogHandle handle;
+  ElfAddress_t ip = _THIS_IP_;
+  DsoHdr dso_hdr;
+  DsoHdr::DsoFindRes find_res = dso_hdr.dso_find_or_backpopulate(getpid(), ip);
+  ASSERT_TRUE(find_res.second);
+  const Dso &dso = *find_res.first;
+  FileInfoId_t file_info_id = dso_hdr.get_or_insert_file_info(dso);
+  ASSERT_TRUE(file_info_id > k_file_info_error);
+  const FileInfoValue &file_info_value =
+      dso_hdr.get_file_info_value(file_info_id);
+  DwflWrapper dwfl_wrapper;
+  DDProfMod ddprof_mod =
+      update_module(dwfl_wrapper._dwfl, ip, dso, file_info_value);
+  ASSERT_TRUE(ddprof_mod._mod);
+
+  SymbolTable table;
+  GElf_Sym elf_sym;
+  Offset_t lbias;
+  Symbol with_lines;
+  ASSERT_TRUE(symbol_get_from_dwfl(ddprof_mod._mod, ip, table, with_lines,
+                                   elf_sym, lbias, true));
+  EXPECT_NE(with_lines._symname.str().find("line_info"), std::string::npos);
+
+  // line tables are not read : same symbol, without source
+  Symbol without_lines;
+  ASSERT_TRUE(symbol_get_from_dwfl(ddprof_mod._mod, ip, table, without_lines,
+                                   elf_sym, lbias, false));
+  EXPECT_EQ(without_lines._symname, with_lines._symname);
+  EXPECT_TRUE(without_lines._srcpath.empty());
+  EXPECT_EQ(without_lines._lineno, 0);
+}
+
 } // namespace ddprof
@@ -0,0 +1,88 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "elf_symbol_table.hpp"
+
+#include "loghandle.hpp"
+
+#include <gelf.h>
+#include <gtest/gtest.h>
+#include <link.h>
+#include <string.h>
+
+namespace ddprof {
+
+TEST(ElfSymbolTableTest, Find) {
+  ElfSymbolTable table;
+  table.add_symbol(0x2000, 0x100, "second");
+  table.add_symbol(0x1000, 0x10, "first");
+  table.add_symbol(0x1000, 0x20, "first_alias");
+  table.add_symbol(0x3000, 0, "no_size");
+  table.add_symbol(0x4000, 0x10, "last");
+  table.sort();
+  // aliases are merged, keeping the largest symbol
+  EXPECT_EQ(table.size(), 4);
+  EXPECT_EQ(table.find(0xfff), -1);
+  int idx = table.find(0x1000);
+  ASSERT_NE(idx, -1);
+  EXPECT_STREQ(table.name(idx), "first_alias");
+  EXPECT_EQ(table.find(0x101f), idx);
+  // gap between symbols
+  EXPECT_EQ(table.find(0x1020), -1);
+  idx = table.find(0x20ff);
+  ASSERT_NE(idx, -1);
+  EXPECT_STREQ(table.name(idx), "second");
+  EXPECT_EQ(table.find(0x2100), -1);
+  // symbols without size extend to the next one
+  idx = table.find(0x3fff);
+  ASSERT_NE(idx, -1);
+  EXPECT_STREQ(table.name(idx), "no_size");
+  idx = table.find(0x400f);
+  ASSERT_NE(idx, -1);
+  EXPECT_STREQ(table.name(idx), "last");
+  EXPECT_EQ(table.find(0x4010), -1);
+}
+
+TEST(ElfSymbolTableTest, OffsetToAddr) {
+  ElfSymbolTable table;
+  table.add_segment(0x1000, 0x401000, 0x2000);
+  ElfAddress_t addr;
+  EXPECT_TRUE(table.offset_to_addr(0x1010, &addr));
+  EXPECT_EQ(addr, 0x401010);
+  EXPECT_FALSE(table.offset_to_addr(0x3000, &addr));
+  EXPECT_FALSE(table.offset_to_addr(0x10, &addr));
+}
+
+__attribute__((noinline)) int elf_symbol_table_target(int val) {
+  __asm__ volatile("" ::: "memory");
+  return val + 1;
+}
+
+namespace {
+int phdr_callback(struct dl_phdr_info *info, size_t, void *data) {
+  // first object is the main program
+  *static_cast<ElfAddress_t *>(data) = info->dlpi_addr;
+  return 1;
+}
+} // namespace
+
+TEST(ElfSymbolTableTest, SelfSymbols) {
+  LogHandle handle;
+  elf_version(EV_CURRENT);
+  ElfSymbolTable table;
+  ASSERT_TRUE(table.load("/proc/self/exe"));
+  EXPECT_LT(0, table.size());
+  ElfAddress_t bias = 0;
+  dl_iterate_phdr(phdr_callback, &bias);
+  ElfAddress_t addr =
+      reinterpret_cast<ElfAddress_t>(&elf_symbol_table_target) - bias;
+  int idx = table.find(addr);
+  ASSERT_NE(idx, -1);
+  EXPECT_TRUE(strstr(table.name(idx), "elf_symbol_table_target"));
+  EXPECT_EQ(table[idx]._start, addr);
+  EXPECT_EQ(elf_symbol_table_target(1), 2);
+}
+
+} // namespace ddprof
@@ -0,0 +1,58 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "frame_cache.hpp"
+
+#include "loghandle.hpp"
+
+#include <gtest/gtest.h>
+
+namespace ddprof {
+
+TEST(FrameCacheTest, FindInsert) {
+  LogHandle handle;
+  FrameCache cache;
+  SymbolIdx_t symbol_idx = -1;
+  MapInfoIdx_t map_info_idx = -1;
+  EXPECT_FALSE(cache.find(10, 0x1000, 1, &symbol_idx, &map_info_idx));
+
+  cache.insert(10, 0x1000, 1, 42, 7);
+  EXPECT_TRUE(cache.find(10, 0x1000, 1, &symbol_idx, &map_info_idx));
+  EXPECT_EQ(symbol_idx, 42);
+  EXPECT_EQ(map_info_idx, 7);
+
+  // other pid, other address or newer generation
+  EXPECT_FALSE(cache.find(11, 0x1000, 1, &symbol_idx, &map_info_idx));
+  EXPECT_FALSE(cache.find(10, 0x1001, 1, &symbol_idx, &map_info_idx));
+  EXPECT_FALSE(cache.find(10, 0x1000, 2, &symbol_idx, &map_info_idx));
+  EXPECT_EQ(cache._stats._hits, 1);
+  EXPECT_EQ(cache._stats._misses, 4);
+  cache._stats.display();
+
+  cache.clear();
+  EXPECT_FALSE(cache.find(10, 0x1000, 1, &symbol_idx, &map_info_idx));
+}
+
+TEST(FrameCacheTest, Collisions) {
+  FrameCache cache;
+  // More entries than the cache holds : latest insertions are found
+  const int nb_entries = 10000;
+  for (int i = 0; i < nb_entries; ++i) {
+    cache.insert(10, 0x1000 + i, 1, i, 0);
+  }
+  SymbolIdx_t symbol_idx;
+  MapInfoIdx_t map_info_idx;
+  int nb_found = 0;
+  for (int i = 0; i < nb_entries; ++i) {
+    if (cache.find(10, 0x1000 + i, 1, &symbol_idx, &map_info_idx)) {
+      EXPECT_EQ(symbol_idx, i);
+      ++nb_found;
+    }
+  }
+  EXPECT_GT(nb_found, 0);
+  EXPECT_LT(nb_found, nb_entries);
+}
+
+} // namespace ddprof
@@ -40,7 +40,7 @@ TEST(MMapTest, PerfOpen) {
     std::cerr << "#######################################" << std::endl;
     std::cerr << "-->" << i << " " << perfoptions_preset(i)->desc << std::endl;
 
-    int perf_fd = perfopen(pid, perfoptions_preset(i), cpu, false);
+    int perf_fd = perfopen(pid, perfoptions_preset(i), cpu, false, 0);
     if (i == 10 || i == 11) { // Expected not to fail for CPU / WALL profiling
       EXPECT_TRUE(perf_fd != -1);
     }
@@ -94,3 +94,169 @@ TEST(PerfRingbufferTest, SampleSymmetryx86) {
   // Compare
   ASSERT_TRUE(sample_eq(&sample, sample_new));
 }
+
+TEST(PerfRingbufferTest, RecordIdentifier) {
+  uint64_t mask = DEFAULT_SAMPLE_TYPE;
+  struct perf_event_sample sample = {};
+  sample.header.type = PERF_RECORD_SAMPLE;
+  sample.sample_id = 42;
+  sample.period = 1;
+  uint64_t regs[3] = {};
+  sample.regs = regs;
+  char hdr_placeholder[256] = {0};
+  struct perf_event_header *hdr = (struct perf_event_header *)hdr_placeholder;
+  ASSERT_TRUE(samp2hdr(hdr, &sample, sizeof(hdr_placeholder), mask));
+  EXPECT_EQ(hdr_id(hdr, mask), 42);
+  EXPECT_EQ(hdr_id(hdr, mask & ~PERF_SAMPLE_IDENTIFIER), 0);
+
+  // Non-sample records carry the identifier at the end of sample_id
+  struct {
+    struct perf_event_header header;
+    uint32_t pid, tid;
+    uint64_t sample_id[4]; // tid, time, identifier
+  } exit_record = {};
+  exit_record.header.type = PERF_RECORD_EXIT;
+  exit_record.header.size = sizeof(struct perf_event_header) + 8 + 3 * 8;
+  exit_record.sample_id[2] = 1234;
+  EXPECT_EQ(hdr_id(&exit_record.header, mask), 1234);
+}
+
+TEST(PerfRingbufferTest, WrappedSampleView) {
+  uint64_t mask = DEFAULT_SAMPLE_TYPE;
+  char stack[1024];
+  for (unsigned i = 0; i < sizeof(stack); ++i)
+    stack[i] = i & 255;
+  uint64_t regs[3] = {0x1111, 0x2222, 0x4444};
+  struct perf_event_sample sample = {};
+  sample.header.type = PERF_RECORD_SAMPLE;
+  sample.sample_id = 7;
+  sample.pid = 12;
+  sample.period = 3;
+  sample.abi = PERF_REGS_MASK_X86;
+  sample.regs = regs;
+  sample.size_stack = sizeof(stack);
+  sample.data_stack = stack;
+  sample.dyn_size_stack = 1000;
+  char record[2048] = {0};
+  struct perf_event_header *hdr = (struct perf_event_header *)record;
+  ASSERT_TRUE(samp2hdr(hdr, &sample, sizeof(record), mask));
+
+  // Write the record so that its stack wraps around a 4096 bytes buffer
+  const uint64_t data_size = 4096;
+  char data[data_size] = {0};
+  const uint64_t offset = data_size - 512;
+  memcpy(data + offset, record, data_size - offset);
+  memcpy(data, record + data_size - offset, hdr->size - (data_size - offset));
+  RingBuffer rb = {};
+  rb.start = data;
+  rb.meta_size = 4096;
+  rb.size = rb.meta_size + data_size;
+  rb.mask = data_size - 1;
+
+  RecordView view;
+  rb_seek_view(&rb, offset, mask, &view);
+  ASSERT_EQ(view.hdr, (struct perf_event_header *)(data + offset));
+  ASSERT_EQ(view.wrap, data);
+  ASSERT_EQ(view.split, data_size - offset);
+
+  perf_event_sample *sample_new = view2samp(&view, mask);
+  EXPECT_EQ(sample_new->sample_id, 7);
+  EXPECT_EQ(sample_new->pid, 12);
+  EXPECT_EQ(sample_new->period, 3);
+  EXPECT_EQ(sample_new->size_stack, 1000);
+  ASSERT_TRUE(sample_new->data_stack_wrap);
+  uint64_t head_sz = sample_new->size_stack_head;
+  EXPECT_EQ(head_sz, data_size - offset - sample_stack_offset(mask));
+  EXPECT_EQ(memcmp(sample_new->data_stack, stack, head_sz), 0);
+  EXPECT_EQ(memcmp(sample_new->data_stack_wrap, stack + head_sz,
+                   sample_new->size_stack - head_sz),
+            0);
+}
+
+TEST(PerfRingbufferTest, SpecializedDecoder) {
+  uint64_t mask = DEFAULT_SAMPLE_TYPE;
+  char stack[512];
+  for (unsigned i = 0; i < sizeof(stack); ++i)
+    stack[i] = i & 255;
+  uint64_t regs[3] = {0x1111, 0x2222, 0x4444};
+  struct perf_event_sample sample = {};
+  sample.header.type = PERF_RECORD_SAMPLE;
+  sample.sample_id = 5;
+  sample.pid = 12;
+  sample.tid = 13;
+  sample.time = 123456789;
+  sample.period = 3;
+  sample.abi = PERF_REGS_MASK_X86;
+  sample.regs = regs;
+  sample.size_stack = sizeof(stack);
+  sample.data_stack = stack;
+  sample.dyn_size_stack = sizeof(stack);
+  char record[1024] = {0};
+  struct perf_event_header *hdr = (struct perf_event_header *)record;
+  ASSERT_TRUE(samp2hdr(hdr, &sample, sizeof(record), mask));
+
+  // Specialized and generic decoders return the same thread local sample
+  RecordView view;
+  record_view_init(&view, hdr);
+  perf_event_sample generic = *view2samp_generic(&view, mask);
+  perf_event_sample *specialized = view2samp(&view, mask);
+  ASSERT_TRUE(sample_eq(&generic, specialized));
+  EXPECT_EQ(specialized->sample_id, 5);
+  EXPECT_EQ(specialized->tid, 13);
+  EXPECT_EQ(specialized->time, 123456789);
+  EXPECT_EQ(specialized->period, 3);
+  EXPECT_EQ(specialized->size_stack, sizeof(stack));
+  EXPECT_EQ(hdr_time(hdr, mask), 123456789);
+  EXPECT_EQ(hdr_time_generic(hdr, mask), 123456789);
+
+  // sample_id trailer of non-sample records : tid, time, identifier
+  struct {
+    struct perf_event_header header;
+    uint32_t pid, tid;
+    uint64_t sample_id[3];
+  } exit_record = {};
+  exit_record.header.type = PERF_RECORD_EXIT;
+  exit_record.header.size = sizeof(exit_record);
+  exit_record.sample_id[1] = 42;
+  EXPECT_EQ(hdr_time(&exit_record.header, mask), 42);
+  EXPECT_EQ(hdr_time_generic(&exit_record.header, mask), 42);
+}
+
+TEST(PerfRingbufferTest, AbsentFieldsCleared) {
+  uint64_t mask = DEFAULT_SAMPLE_TYPE;
+  char stack[64] = {1};
+  uint64_t regs[3] = {0x1111, 0x2222, 0x4444};
+  struct perf_event_sample sample = {};
+  sample.header.type = PERF_RECORD_SAMPLE;
+  sample.time = 123456789;
+  sample.abi = PERF_REGS_MASK_X86;
+  sample.regs = regs;
+  sample.size_stack = sizeof(stack);
+  sample.data_stack = stack;
+  sample.dyn_size_stack = sizeof(stack);
+  char record[512] = {0};
+  struct perf_event_header *hdr = (struct perf_event_header *)record;
+  ASSERT_TRUE(samp2hdr(hdr, &sample, sizeof(record), mask));
+  perf_event_sample *decoded = hdr2samp(hdr, mask);
+  ASSERT_EQ(decoded->time, 123456789);
+  ASSERT_EQ(decoded->size_stack, sizeof(stack));
+
+  // The thread local sample does not keep fields of the previous decode
+  uint64_t small_mask = PERF_SAMPLE_IDENTIFIER | PERF_SAMPLE_TID;
+  struct perf_event_sample small = {};
+  small.header.type = PERF_RECORD_SAMPLE;
+  small.sample_id = 3;
+  small.pid = 12;
+  char small_record[128] = {0};
+  hdr = (struct perf_event_header *)small_record;
+  ASSERT_TRUE(samp2hdr(hdr, &small, sizeof(small_record), small_mask));
+  decoded = hdr2samp(hdr, small_mask);
+  EXPECT_EQ(decoded->sample_id, 3);
+  EXPECT_EQ(decoded->pid, 12);
+  EXPECT_EQ(decoded->time, 0);
+  EXPECT_EQ(decoded->abi, 0);
+  EXPECT_EQ(decoded->regs, nullptr);
+  EXPECT_EQ(decoded->size_stack, 0);
+  EXPECT_EQ(decoded->data_stack, nullptr);
+  EXPECT_EQ(decoded->data_stack_wrap, nullptr);
+}
@@ -7,6 +7,7 @@ extern "C" {
 #include "pevent_lib.h"
 
 #include "ddprof_context.h"
+#include "perf.h"
 #include "perf_option.h"
 
 #include <sys/sysinfo.h>
@@ -32,3 +33,52 @@ TEST(PeventTest, setup_cleanup) {
   res = pevent_cleanup(&pevent_hdr);
   ASSERT_TRUE(IsDDResOK(res));
 }
+
+TEST(PeventTest, pos_from_id) {
+  PEventHdr pevent_hdr;
+  pevent_init(&pevent_hdr);
+  PEventId ids[] = {{3, 0}, {8, 2}, {12, 1}};
+  pevent_hdr.ids = ids;
+  pevent_hdr.nb_ids = 3;
+  EXPECT_EQ(pevent_pos_from_id(&pevent_hdr, 3, -1), 0);
+  EXPECT_EQ(pevent_pos_from_id(&pevent_hdr, 8, -1), 2);
+  EXPECT_EQ(pevent_pos_from_id(&pevent_hdr, 12, -1), 1);
+  EXPECT_EQ(pevent_pos_from_id(&pevent_hdr, 1, -1), -1);
+  EXPECT_EQ(pevent_pos_from_id(&pevent_hdr, 9, -1), -1);
+  EXPECT_EQ(pevent_pos_from_id(&pevent_hdr, 13, -1), -1);
+}
+
+TEST(PeventTest, next_buf_size_shift) {
+  // grow when events are lost, up to the max
+  EXPECT_EQ(pevent_next_buf_size_shift(6, 6, true, false), 7);
+  EXPECT_EQ(pevent_next_buf_size_shift(6, 6, true, true), 7);
+  EXPECT_EQ(pevent_next_buf_size_shift(MAX_BUFF_SIZE_SHIFT, 6, true, false),
+            MAX_BUFF_SIZE_SHIFT);
+  // busy buffers keep their size
+  EXPECT_EQ(pevent_next_buf_size_shift(8, 6, false, true), 8);
+  // idle buffers shrink back to the configured size
+  EXPECT_EQ(pevent_next_buf_size_shift(8, 6, false, false), 7);
+  EXPECT_EQ(pevent_next_buf_size_shift(6, 6, false, false), 6);
+  // smaller buffers mapped as a fallback are not shrunk further
+  EXPECT_EQ(pevent_next_buf_size_shift(5, 6, false, false), 5);
+  EXPECT_EQ(pevent_next_buf_size_shift(MIN_BUFF_SIZE_SHIFT, 6, false, false),
+            MIN_BUFF_SIZE_SHIFT);
+  EXPECT_EQ(pevent_next_buf_size_shift(MIN_BUFF_SIZE_SHIFT - 1, 6, false,
+                                       false),
+            MIN_BUFF_SIZE_SHIFT);
+}
+
+TEST(PeventTest, mapped_shift) {
+  PEventHdr pevent_hdr;
+  DDProfContext ctx = {};
+  mock_ddprof_context(&ctx);
+  pevent_init(&pevent_hdr);
+  DDRes res = pevent_open(&ctx, getpid(), get_nprocs(), &pevent_hdr);
+  ASSERT_TRUE(IsDDResOK(res));
+  int mapped_shift = -1;
+  res = pevent_mmap(&pevent_hdr, MIN_BUFF_SIZE_SHIFT, false, &mapped_shift);
+  ASSERT_TRUE(IsDDResOK(res));
+  EXPECT_EQ(mapped_shift, MIN_BUFF_SIZE_SHIFT);
+  res = pevent_cleanup(&pevent_hdr);
+  ASSERT_TRUE(IsDDResOK(res));
+}
@@ -0,0 +1,71 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "pid_lifecycle.hpp"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace ddprof {
+
+TEST(PidLifecycleTest, grace_period) {
+  PidLifecycle lifecycle(100);
+  EXPECT_TRUE(lifecycle.empty());
+  lifecycle.exited(10, 1000);
+  lifecycle.exited(11, 1050);
+  EXPECT_EQ(lifecycle.nb_exited(), 2);
+
+  std::vector<pid_t> pids;
+  lifecycle.pop_expired(1099, pids);
+  EXPECT_TRUE(pids.empty());
+  lifecycle.pop_expired(1100, pids);
+  ASSERT_EQ(pids.size(), 1);
+  EXPECT_EQ(pids[0], 10);
+  lifecycle.pop_expired(2000, pids);
+  ASSERT_EQ(pids.size(), 2);
+  EXPECT_EQ(pids[1], 11);
+  EXPECT_TRUE(lifecycle.empty());
+}
+
+TEST(PidLifecycleTest, reused_pid) {
+  PidLifecycle lifecycle(100);
+  lifecycle.exited(10, 1000);
+  lifecycle.exited(11, 1000);
+  // exit reported twice (sideband of other shards) restarts the period
+  lifecycle.exited(11, 1050);
+  EXPECT_EQ(lifecycle.nb_exited(), 2);
+  // pid reused by a new process before the end of the grace period
+  lifecycle.started(10);
+  EXPECT_EQ(lifecycle.nb_exited(), 1);
+
+  std::vector<pid_t> pids;
+  lifecycle.pop_expired(1100, pids);
+  EXPECT_TRUE(pids.empty());
+  lifecycle.pop_expired(1150, pids);
+  ASSERT_EQ(pids.size(), 1);
+  EXPECT_EQ(pids[0], 11);
+}
+
+TEST(PidLifecycleTest, exit_after_reuse) {
+  PidLifecycle lifecycle(100);
+  lifecycle.exited(10, 1000);
+  lifecycle.started(10);
+  EXPECT_FALSE(lifecycle.is_exited(10));
+  // the new process exits as well : only its exit is considered
+  lifecycle.exited(10, 1080);
+  EXPECT_TRUE(lifecycle.is_exited(10));
+  EXPECT_EQ(lifecycle.nb_exited(), 1);
+
+  std::vector<pid_t> pids;
+  lifecycle.pop_expired(1100, pids);
+  EXPECT_TRUE(pids.empty());
+  lifecycle.pop_expired(1180, pids);
+  ASSERT_EQ(pids.size(), 1);
+  EXPECT_EQ(pids[0], 10);
+  EXPECT_TRUE(lifecycle.empty());
+  EXPECT_EQ(lifecycle.nb_exited(), 0);
+}
+
+} // namespace ddprof
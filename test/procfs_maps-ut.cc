@@ -0,0 +1,99 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "procfs_maps.hpp"
+
+#include "loghandle.hpp"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+namespace ddprof {
+
+// clang-format off
+static const char *s_maps_content =
+    "55d78839f000-55d7883a1000 r--p 00000000 fe:01 3287864                    /usr/local/bin/BadBoggleSolver_run\n"
+    "55d7883a1000-55d7883a5000 r-xp 00002000 fe:01 3287864                    /usr/local/bin/BadBoggleSolver_run\n"
+    "not a mapping\n"
+    "7f53143a9000-7f53143aa000 rw-p 00000000 00:00 0\n"
+    "ffffffffff600000-ffffffffff601000 r-xp 00000000 00:00 0                  [vsyscall]";
+// clang-format on
+
+TEST(ProcMapsTest, parse_line) {
+  char line[] = "7f531437b000-7f531439e000 r-xp 0001a000 fe:01 3932979  "
+                "          /usr/lib/x86_64-linux-gnu/ld-2.31.so\n";
+  ProcMapsEntry entry;
+  ASSERT_TRUE(
+      ProcMapsReader::parse_line(line, line + strlen(line) - 1, entry));
+  EXPECT_EQ(entry._start, 0x7f531437b000);
+  EXPECT_EQ(entry._end, 0x7f531439e000);
+  EXPECT_EQ(entry._offset, 0x1a000);
+  EXPECT_TRUE(entry._executable);
+  EXPECT_STREQ(entry._path, "/usr/lib/x86_64-linux-gnu/ld-2.31.so");
+  EXPECT_EQ(entry._path_len, strlen(entry._path));
+
+  char no_path[] = "7f53143a9000-7f53143aa000 rw-p 00000000 00:00 0";
+  ASSERT_TRUE(ProcMapsReader::parse_line(
+      no_path, no_path + strlen(no_path), entry));
+  EXPECT_FALSE(entry._executable);
+  EXPECT_EQ(entry._path_len, 0);
+
+  char truncated[] = "7f53143a9000-7f53143aa000 rw-p";
+  EXPECT_FALSE(ProcMapsReader::parse_line(
+      truncated, truncated + strlen(truncated), entry));
+}
+
+TEST(ProcMapsTest, read_file) {
+  LogHandle handle;
+  char path[] = "/tmp/procfs_maps-ut.XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(write(fd, s_maps_content, strlen(s_maps_content)),
+            static_cast<ssize_t>(strlen(s_maps_content)));
+  close(fd);
+
+  ProcMapsReader reader;
+  ASSERT_TRUE(reader.read(path));
+  unlink(path);
+  ProcMapsEntry entry;
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_FALSE(entry._executable);
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_TRUE(entry._executable);
+  EXPECT_EQ(entry._offset, 0x2000);
+  EXPECT_STREQ(entry._path, "/usr/local/bin/BadBoggleSolver_run");
+  // invalid line is skipped
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry._start, 0x7f53143a9000);
+  // last line has no line feed
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_STREQ(entry._path, "[vsyscall]");
+  EXPECT_FALSE(reader.next(entry));
+
+  EXPECT_FALSE(reader.read(path));
+  EXPECT_FALSE(reader.next(entry));
+}
+
+TEST(ProcMapsTest, read_self) {
+  ProcMapsReader reader;
+  ASSERT_TRUE(reader.read(getpid()));
+  ProcMapsEntry entry;
+  bool found_exe = false;
+  int nb_entries = 0;
+  while (reader.next(entry)) {
+    EXPECT_LT(entry._start, entry._end);
+    if (entry._executable && strstr(entry._path, MYNAME)) {
+      found_exe = true;
+    }
+    ++nb_entries;
+  }
+  EXPECT_TRUE(found_exe);
+  EXPECT_GT(nb_entries, 1);
+}
+
+} // namespace ddprof
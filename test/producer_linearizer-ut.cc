@@ -8,6 +8,7 @@ extern "C" {
 }
 
 #include <gtest/gtest.h>
+#include <vector>
 
 TEST(ProducerLinearizerTest, SimpleTest) {
   ProducerLinearizer pl = {};
@@ -51,3 +52,28 @@ TEST(ProducerLinearizerTest, SimpleTest) {
   // We're done here
   ProducerLinearizer_free(&pl);
 }
+
+TEST(ProducerLinearizerTest, MergeProducers) {
+  // Merge 3 ordered producers, pushing the next value of a producer whenever
+  // its previous one is popped
+  std::vector<std::vector<uint64_t>> producers = {
+      {1, 4, 4, 9, 12}, {2, 3, 4, 20}, {0, 15}};
+  ProducerLinearizer pl = {};
+  ASSERT_TRUE(ProducerLinearizer_init(&pl, producers.size()));
+  std::vector<size_t> next(producers.size(), 0);
+  for (uint64_t k = 0; k < producers.size(); ++k) {
+    ASSERT_TRUE(ProducerLinearizer_push(&pl, k, producers[k][next[k]++]));
+  }
+
+  std::vector<uint64_t> merged;
+  uint64_t k;
+  while (ProducerLinearizer_pop(&pl, &k)) {
+    merged.push_back(producers[k][next[k] - 1]);
+    if (next[k] < producers[k].size()) {
+      ASSERT_TRUE(ProducerLinearizer_push(&pl, k, producers[k][next[k]++]));
+    }
+  }
+  std::vector<uint64_t> expected = {0, 1, 2, 3, 4, 4, 4, 9, 12, 15, 20};
+  ASSERT_EQ(merged, expected);
+  ProducerLinearizer_free(&pl);
+}
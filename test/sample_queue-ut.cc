@@ -0,0 +1,140 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+extern "C" {
+#include "sample_queue.h"
+}
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+// header followed by up to 15 values of 64 bits
+struct TestRecord {
+  perf_event_header hdr;
+  uint64_t values[15];
+};
+
+void fill_record(TestRecord *rec, unsigned nb_values, uint64_t seed) {
+  rec->hdr.type = PERF_RECORD_SAMPLE;
+  rec->hdr.misc = 0;
+  rec->hdr.size = sizeof(perf_event_header) + nb_values * sizeof(uint64_t);
+  for (unsigned i = 0; i < nb_values; ++i) {
+    rec->values[i] = seed + i;
+  }
+}
+
+void check_record(const perf_event_header *hdr, uint64_t seed) {
+  const uint64_t *values = reinterpret_cast<const uint64_t *>(&hdr[1]);
+  unsigned nb_values = (hdr->size - sizeof(*hdr)) / sizeof(uint64_t);
+  for (unsigned i = 0; i < nb_values; ++i) {
+    ASSERT_EQ(values[i], seed + i);
+  }
+}
+} // namespace
+
+TEST(SampleQueueTest, PushPop) {
+  SampleQueue q;
+  ASSERT_TRUE(sample_queue_init(&q, 1024));
+  TestRecord rec;
+  for (int i = 0; i < 5; ++i) {
+    fill_record(&rec, i + 1, i * 100);
+    ASSERT_TRUE(sample_queue_push(&q, &rec.hdr, i));
+  }
+  int pos;
+  for (int i = 0; i < 5; ++i) {
+    perf_event_header *hdr = sample_queue_front(&q, &pos);
+    ASSERT_TRUE(hdr);
+    EXPECT_EQ(pos, i);
+    EXPECT_EQ(hdr->size, sizeof(perf_event_header) + (i + 1) * 8);
+    check_record(hdr, i * 100);
+    sample_queue_pop(&q);
+  }
+  EXPECT_FALSE(sample_queue_front(&q, &pos));
+  EXPECT_EQ(sample_queue_used(&q), 0);
+  sample_queue_free(&q);
+}
+
+TEST(SampleQueueTest, FullAndWrap) {
+  SampleQueue q;
+  // Room for 3 records of 64 bytes (8 bytes header per entry)
+  ASSERT_TRUE(sample_queue_init(&q, 3 * 72 + 16));
+  TestRecord rec;
+  fill_record(&rec, 7, 0);
+  ASSERT_EQ(rec.hdr.size, 64);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(sample_queue_push(&q, &rec.hdr, i));
+  }
+  EXPECT_FALSE(sample_queue_push(&q, &rec.hdr, 3));
+
+  // Loop several times around the storage
+  int pos;
+  for (int i = 3; i < 100; ++i) {
+    perf_event_header *hdr = sample_queue_front(&q, &pos);
+    ASSERT_TRUE(hdr);
+    EXPECT_EQ(pos, i - 3);
+    sample_queue_pop(&q);
+    fill_record(&rec, 7, i);
+    ASSERT_TRUE(sample_queue_push(&q, &rec.hdr, i));
+  }
+  for (int i = 97; i < 100; ++i) {
+    perf_event_header *hdr = sample_queue_front(&q, &pos);
+    ASSERT_TRUE(hdr);
+    EXPECT_EQ(pos, i);
+    check_record(hdr, i);
+    sample_queue_pop(&q);
+  }
+  EXPECT_FALSE(sample_queue_front(&q, &pos));
+  sample_queue_free(&q);
+}
+
+TEST(SampleQueueTest, TooLarge) {
+  SampleQueue q;
+  ASSERT_TRUE(sample_queue_init(&q, 64));
+  TestRecord rec;
+  fill_record(&rec, 15, 0);
+  EXPECT_FALSE(sample_queue_push(&q, &rec.hdr, 0));
+  sample_queue_free(&q);
+}
+
+namespace {
+constexpr int k_nb_records = 20000;
+
+void *produce(void *arg) {
+  SampleQueue *q = static_cast<SampleQueue *>(arg);
+  TestRecord rec;
+  for (int i = 0; i < k_nb_records; ++i) {
+    fill_record(&rec, 1 + i % 15, i);
+    while (!sample_queue_push(q, &rec.hdr, i)) {
+      sched_yield();
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+TEST(SampleQueueTest, Threaded) {
+  SampleQueue q;
+  ASSERT_TRUE(sample_queue_init(&q, 4096 + 8));
+  pthread_t tid;
+  ASSERT_EQ(pthread_create(&tid, nullptr, produce, &q), 0);
+  int expected = 0;
+  while (expected < k_nb_records) {
+    int pos;
+    perf_event_header *hdr = sample_queue_front(&q, &pos);
+    if (!hdr) {
+      continue;
+    }
+    ASSERT_EQ(pos, expected);
+    ASSERT_EQ(hdr->size, sizeof(perf_event_header) + (1 + pos % 15) * 8);
+    check_record(hdr, pos);
+    sample_queue_pop(&q);
+    ++expected;
+  }
+  pthread_join(tid, nullptr);
+  EXPECT_EQ(sample_queue_used(&q), 0);
+  sample_queue_free(&q);
+}
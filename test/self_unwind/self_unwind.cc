@@ -16,9 +16,9 @@ extern "C" {
 #include "stackchecker.hpp"
 
 #include <iostream>
+#include <string.h>
 #include <unistd.h>
-
-#define SZ_STATIC_ARRAY(array) (sizeof(array) / sizeof(array[0]))
+#include <vector>
 
 static const char *k_test_executable = "BadBoggleSolver_run";
 
@@ -72,13 +72,18 @@ int main(int argc, char *argv[]) {
   }
 
   std::string str_pid = std::to_string(pid_test_prog);
-  const char *argv_override[] = {MYNAME,    "--pid",     str_pid.c_str(),
-                                 "--event", "sCPU,1000", (char *)NULL};
+  std::vector<const char *> argv_override = {
+      MYNAME, "--pid", str_pid.c_str(), "--event", "sCPU,1000"};
+  // Extra arguments are given to ddprof (example: --unwind_tables yes)
+  for (int i = 2; i < argc; ++i) {
+    argv_override.push_back(argv[i]);
+  }
+  argv_override.push_back(nullptr);
   SymbolMap symbol_map;
 
   // size - 1 as we add a null char at the end
-  if (IsDDResNotOK(ddprof_input_parse(SZ_STATIC_ARRAY(argv_override) - 1,
-                                      const_cast<char **>(argv_override),
+  if (IsDDResNotOK(ddprof_input_parse(argv_override.size() - 1,
+                                      const_cast<char **>(argv_override.data()),
                                       &input, &continue_exec))) {
     std::cerr << "unable to init input " << std::endl;
     ret = -1;
@@ -126,12 +131,13 @@ bool stack_addtomap(const UnwindOutput *unwind_output, const DDProfContext *ctx,
   assert(perf_option_pos == 0);
   for (unsigned i = 0; i < unwind_output->nb_locs; ++i) {
     const ddprof::Symbol &symbol = ddprof::get_symbol(ctx, unwind_output, i);
-    if (symbol._demangle_name.find("0x") != std::string::npos) {
+    if (strstr(symbol._demangle_name.c_str(), "0x")) {
       // skip non symbolized frames
       continue;
     }
-    suw::DwflSymbolKey key(symbol);
-    (*symbol_map)[key] = symbol;
+    suw::SymbolInfo symbol_info(symbol);
+    suw::DwflSymbolKey key(symbol_info);
+    (*symbol_map)[key] = symbol_info;
   }
   return true;
 }
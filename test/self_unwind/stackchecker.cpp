@@ -12,19 +12,17 @@
 
 namespace suw {
 
-using Symbol = ddprof::Symbol;
-
-void to_json(json &j, const Symbol &symbol) {
+void to_json(json &j, const SymbolInfo &symbol) {
   j = json{{"src_path", symbol._srcpath},
            {"demangle_name", symbol._demangle_name}};
 }
 
-void from_json(const json &j, Symbol &symbol) {
+void from_json(const json &j, SymbolInfo &symbol) {
   j.at("src_path").get_to(symbol._srcpath);
   j.at("demangle_name").get_to(symbol._demangle_name);
 }
 
-void add_symbol(json &j, const Symbol &symbol) {
+void add_symbol(json &j, const SymbolInfo &symbol) {
   json symbol_j;
   to_json(symbol_j, symbol);
   j.push_back(symbol_j);
@@ -79,7 +77,7 @@ int compare_to_ref(std::string exe_name, const SymbolMap &map,
   json ref_json = parse_json_file(file_path);
   SymbolMap ref_symbol_map;
   for (auto json_el : ref_json) {
-    Symbol symbol;
+    SymbolInfo symbol;
     from_json(json_el, symbol);
     DwflSymbolKey key(symbol);
     ref_symbol_map[key] = symbol;
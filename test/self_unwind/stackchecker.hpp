@@ -18,9 +18,19 @@ static inline std::size_t hash_combine(std::size_t lhs, std::size_t rhs) {
   return rhs + 0x9e3779b9 + (lhs << 6) + (lhs >> 2);
 }
 
+// Copy of the symbol strings (interned strings do not outlive the worker)
+struct SymbolInfo {
+  SymbolInfo() = default;
+  explicit SymbolInfo(const ddprof::Symbol &symbol)
+      : _srcpath(symbol._srcpath.str()),
+        _demangle_name(symbol._demangle_name.str()) {}
+  std::string _srcpath;
+  std::string _demangle_name;
+};
+
 // Only consider demangled name for now
 struct DwflSymbolKey {
-  explicit DwflSymbolKey(const ddprof::Symbol &symbol)
+  explicit DwflSymbolKey(const SymbolInfo &symbol)
       : _demangle_name(symbol._demangle_name) {}
   std::string _demangle_name;
 
@@ -44,10 +54,10 @@ namespace suw {
 
 using json = nlohmann::json;
 
-using SymbolMap = std::unordered_map<suw::DwflSymbolKey, ddprof::Symbol>;
+using SymbolMap = std::unordered_map<suw::DwflSymbolKey, SymbolInfo>;
 
 // Append ip info to a json file
-void add_symbol(json &j, const ddprof::Symbol &symbol);
+void add_symbol(json &j, const SymbolInfo &symbol);
 
 void write_json_file(std::string exe_name, const SymbolMap &map,
                      std::string data_directory = "");
@@ -0,0 +1,55 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "string_interner.hpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace ddprof {
+
+TEST(StringInternerTest, Intern) {
+  StringInterner strings;
+  InternedString empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_STREQ(empty.c_str(), "");
+  EXPECT_EQ(strings.intern(""), empty);
+  EXPECT_EQ(strings.size(), 0);
+
+  std::string foo = "foo";
+  InternedString foo_1 = strings.intern(foo);
+  InternedString foo_2 = strings.intern("foo");
+  // same storage, not the caller's
+  EXPECT_EQ(foo_1.c_str(), foo_2.c_str());
+  EXPECT_NE(foo_1.c_str(), foo.c_str());
+  EXPECT_EQ(foo_1.str(), foo);
+  EXPECT_EQ(foo_1.size(), 3);
+
+  InternedString foobar = strings.intern("foobar");
+  EXPECT_NE(foo_1, foobar);
+  EXPECT_EQ(strings.intern("foobar", 3), foo_1);
+  EXPECT_EQ(strings.size(), 2);
+}
+
+TEST(StringInternerTest, Blocks) {
+  StringInterner strings;
+  std::vector<InternedString> interned;
+  for (int i = 0; i < 10000; ++i) {
+    interned.push_back(strings.intern("/usr/lib/libfoo_" + std::to_string(i)));
+  }
+  // larger than a block
+  std::string large(100 * 1024, 'a');
+  InternedString large_interned = strings.intern(large);
+  EXPECT_EQ(large_interned.str(), large);
+  // strings do not move when blocks are added
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(interned[i].str(), "/usr/lib/libfoo_" + std::to_string(i));
+  }
+  EXPECT_EQ(strings.size(), 10001);
+  EXPECT_GE(strings.arena_size(), large.size());
+}
+
+} // namespace ddprof
@@ -0,0 +1,165 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "symbol_disk_cache.hpp"
+
+#include "loghandle.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace ddprof {
+
+namespace {
+class TmpDir {
+public:
+  TmpDir() : _path("/tmp/symbol_disk_cache-ut.XXXXXX") {
+    mkdtemp(&_path[0]);
+  }
+  ~TmpDir() {
+    std::string cmd = "rm -rf " + _path;
+    EXPECT_EQ(system(cmd.c_str()), 0);
+  }
+  std::string _path;
+};
+
+const BuildId k_build_id = "0123456789abcdef";
+const int64_t k_file_size = 4096;
+
+Symbol make_symbol(SymbolTable &table, const char *name, uint32_t lineno) {
+  return Symbol(table.intern(name), InternedString(), lineno,
+                table.intern("foo.cc"));
+}
+} // namespace
+
+TEST(SymbolDiskCacheTest, persist) {
+  LogHandle handle;
+  TmpDir dir;
+  SymbolTable table;
+  {
+    SymbolDiskCache cache;
+    std::vector<SymbolCacheEntry> entries;
+    // disabled without directory
+    EXPECT_EQ(
+        cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries), 0);
+    cache.set_directory(dir._path.c_str());
+    ASSERT_TRUE(cache.enabled());
+    // no build-id
+    EXPECT_EQ(cache.open(1, "", k_file_size, 0, 0x10000, table, entries), 0);
+    EXPECT_EQ(
+        cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries), 0);
+    cache.append(1, 0x1000, 0x100f, make_symbol(table, "foo", 12));
+    cache.append(1, 0x2000, 0x2fff, make_symbol(table, "bar", 0));
+    // outside of the range of the next load
+    cache.append(1, 0x20000, 0x20010, make_symbol(table, "baz", 1));
+    // not opened
+    cache.append(2, 0x3000, 0x3010, make_symbol(table, "qux", 1));
+  }
+
+  // new worker
+  SymbolTable table_2;
+  SymbolDiskCache cache;
+  cache.set_directory(dir._path.c_str());
+  std::vector<SymbolCacheEntry> entries;
+  ASSERT_EQ(cache.open(3, k_build_id, k_file_size, 0x1000, 0x10000, table_2,
+                       entries),
+            2);
+  EXPECT_EQ(entries[0]._start, 0x1000);
+  EXPECT_EQ(entries[0]._end, 0x100f);
+  EXPECT_EQ(entries[0]._symbol._symname.str(), "foo");
+  // names are demangled on export
+  EXPECT_TRUE(entries[0]._symbol._demangle_name.empty());
+  EXPECT_EQ(entries[0]._symbol._srcpath.str(), "foo.cc");
+  EXPECT_EQ(entries[0]._symbol._lineno, 12);
+  EXPECT_EQ(entries[1]._symbol._symname.str(), "bar");
+
+  // appends go to the same file
+  cache.append(3, 0x4000, 0x4010, make_symbol(table_2, "quux", 0));
+  cache.close(3);
+  entries.clear();
+  EXPECT_EQ(cache.open(3, k_build_id, k_file_size, 0, 0x100000, table_2,
+                       entries),
+            4);
+}
+
+TEST(SymbolDiskCacheTest, truncated) {
+  LogHandle handle;
+  TmpDir dir;
+  SymbolTable table;
+  SymbolDiskCache cache;
+  cache.set_directory(dir._path.c_str());
+  std::vector<SymbolCacheEntry> entries;
+  cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries);
+  cache.append(1, 0x1000, 0x100f, make_symbol(table, "foo", 12));
+  cache.close(1);
+
+  // interrupted writer
+  std::string path = dir._path + "/" + k_build_id + "-4096.sym";
+  int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(write(fd, "garbage", 7), 7);
+  ::close(fd);
+
+  EXPECT_EQ(cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries),
+            1);
+  EXPECT_EQ(entries[0]._symbol._symname.str(), "foo");
+  // no longer appending after the truncated record
+  cache.append(1, 0x2000, 0x200f, make_symbol(table, "bar", 1));
+  cache.close(1);
+  entries.clear();
+  EXPECT_EQ(cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries),
+            1);
+}
+
+TEST(SymbolDiskCacheTest, other_version) {
+  LogHandle handle;
+  TmpDir dir;
+  std::string path = dir._path + "/" + k_build_id + "-4096.sym";
+  // file of a previous format
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+  ASSERT_NE(fd, -1);
+  const char old_file[] = "DDPSYMC\1garbage records";
+  ASSERT_EQ(write(fd, old_file, sizeof(old_file) - 1),
+            static_cast<ssize_t>(sizeof(old_file) - 1));
+  ::close(fd);
+
+  SymbolTable table;
+  SymbolDiskCache cache;
+  cache.set_directory(dir._path.c_str());
+  std::vector<SymbolCacheEntry> entries;
+  EXPECT_EQ(cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries),
+            0);
+  // the file was replaced
+  cache.append(1, 0x1000, 0x100f, make_symbol(table, "foo", 12));
+  cache.close(1);
+  EXPECT_EQ(cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries),
+            1);
+  EXPECT_EQ(entries[0]._symbol._symname.str(), "foo");
+}
+
+TEST(SymbolDiskCacheTest, stripped_copy) {
+  LogHandle handle;
+  TmpDir dir;
+  SymbolTable table;
+  SymbolDiskCache cache;
+  cache.set_directory(dir._path.c_str());
+  std::vector<SymbolCacheEntry> entries;
+  cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries);
+  cache.append(1, 0x1000, 0x100f, make_symbol(table, "foo", 12));
+  cache.close(1);
+
+  // same build-id, different size : symbols are not shared
+  EXPECT_EQ(cache.open(2, k_build_id, k_file_size / 2, 0, 0x10000, table,
+                       entries),
+            0);
+  EXPECT_EQ(cache.open(1, k_build_id, k_file_size, 0, 0x10000, table, entries),
+            1);
+}
+
+} // namespace ddprof
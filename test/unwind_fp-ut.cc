@@ -0,0 +1,141 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "unwind_fp.hpp"
+
+#include "dso_hdr.hpp"
+#include "loghandle.hpp"
+#include "unwind_dwfl.hpp"
+#include "unwind_state.hpp"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace ddprof {
+
+namespace {
+// Symbolization is not under test : frames added by the unwinder are recorded
+std::vector<ElfAddress_t> s_frames;
+} // namespace
+
+DDRes unwind_init_dwfl(UnwindState *) { return ddres_init(); }
+
+DDRes add_dwfl_frame(UnwindState *us, const Dso &, ElfAddress_t pc) {
+  s_frames.push_back(pc);
+  ++us->output.nb_locs;
+  return ddres_init();
+}
+
+namespace {
+const pid_t k_pid = 4242;
+// address of the top of the stack snapshot
+const ProcessAddress_t k_sp = 0x7ffe00000000;
+const int k_stack_words = 64;
+
+StringInterner s_filenames;
+
+// Frame records are [rbp] -> caller's rbp, [rbp + 8] -> return address
+class UnwindFpTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    s_frames.clear();
+    _stack.assign(k_stack_words, 0);
+    _us.pid = k_pid;
+    _us.stack = reinterpret_cast<char *>(_stack.data());
+    _us.stack_sz = _stack.size() * sizeof(ElfWord_t);
+    _us.stack_split = _us.stack_sz;
+    _us.initial_regs.esp = k_sp;
+    unwind_fp_config(&_us, true, "libnofp");
+    _us.dso_hdr.insert_erase_overlap(
+        Dso(k_pid, 0x1000, 0x1fff, 0, s_filenames.intern("/usr/lib/libfp.so")));
+    _us.dso_hdr.insert_erase_overlap(Dso(
+        k_pid, 0x3000, 0x3fff, 0, s_filenames.intern("/usr/lib/libnofp.so")));
+  }
+
+  static ProcessAddress_t word_addr(int idx) {
+    return k_sp + idx * sizeof(ElfWord_t);
+  }
+  // Frame record at word idx of the stack
+  void set_frame_record(int idx, ProcessAddress_t caller_rbp,
+                        ElfAddress_t ret_addr) {
+    _stack[idx] = caller_rbp;
+    _stack[idx + 1] = ret_addr;
+  }
+  const Dso &find_dso(ElfAddress_t pc) {
+    DsoHdr::DsoFindRes find_res = _us.dso_hdr.dso_find_closest(k_pid, pc);
+    EXPECT_TRUE(find_res.second);
+    return *find_res.first;
+  }
+
+  LogHandle _loghandle;
+  std::vector<ElfWord_t> _stack;
+  UnwindState _us;
+};
+} // namespace
+
+TEST_F(UnwindFpTest, null_rbp_ends_walk) {
+  _us.initial_regs.eip = 0x1100;
+  _us.initial_regs.ebp = word_addr(4);
+  set_frame_record(4, word_addr(10), 0x1201);
+  set_frame_record(10, 0, 0x1301);
+
+  bool complete;
+  ASSERT_TRUE(IsDDResOK(unwind_fp(&_us, &complete)));
+  EXPECT_TRUE(complete);
+  // return addresses point into the call instruction
+  EXPECT_EQ(s_frames, std::vector<ElfAddress_t>({0x1100, 0x1200, 0x1300}));
+  EXPECT_EQ(find_dso(0x1100)._fp_status, dso::kFpAvailable);
+}
+
+TEST_F(UnwindFpTest, broken_chain) {
+  _us.initial_regs.eip = 0x1100;
+  _us.initial_regs.ebp = word_addr(4);
+  set_frame_record(4, word_addr(10), 0x1201);
+  // the caller's rbp goes down the stack : not a frame record
+  set_frame_record(10, word_addr(2), 0x1301);
+
+  bool complete;
+  ASSERT_TRUE(IsDDResOK(unwind_fp(&_us, &complete)));
+  EXPECT_FALSE(complete);
+  EXPECT_EQ(s_frames, std::vector<ElfAddress_t>({0x1100}));
+  EXPECT_EQ(find_dso(0x1200)._fp_status, dso::kFpMissing);
+  // DWARF unwinding resumes from the frame that was not added
+  EXPECT_EQ(_us.dwarf_regs.eip, 0x1201);
+  EXPECT_EQ(_us.dwarf_regs.ebp, word_addr(10));
+  EXPECT_EQ(_us.dwarf_regs.esp, word_addr(6));
+}
+
+TEST_F(UnwindFpTest, rbp_outside_stack) {
+  _us.initial_regs.eip = 0x1100;
+  _us.initial_regs.ebp = word_addr(4);
+  set_frame_record(4, word_addr(k_stack_words + 10), 0x1201);
+
+  bool complete;
+  ASSERT_TRUE(IsDDResOK(unwind_fp(&_us, &complete)));
+  EXPECT_FALSE(complete);
+  EXPECT_EQ(s_frames, std::vector<ElfAddress_t>({0x1100}));
+  // the chain is not broken, the snapshot is too small
+  EXPECT_EQ(find_dso(0x1200)._fp_status, dso::kFpAvailable);
+  EXPECT_EQ(_us.dwarf_regs.eip, 0x1201);
+  EXPECT_EQ(_us.dwarf_regs.ebp, word_addr(k_stack_words + 10));
+}
+
+TEST_F(UnwindFpTest, excluded_dso) {
+  _us.initial_regs.eip = 0x1100;
+  _us.initial_regs.ebp = word_addr(4);
+  set_frame_record(4, word_addr(10), 0x3201);
+  set_frame_record(10, 0, 0x1301);
+
+  bool complete;
+  ASSERT_TRUE(IsDDResOK(unwind_fp(&_us, &complete)));
+  EXPECT_FALSE(complete);
+  EXPECT_EQ(s_frames, std::vector<ElfAddress_t>({0x1100}));
+  EXPECT_EQ(find_dso(0x3200)._fp_status, dso::kFpMissing);
+  // frames of the excluded dso are left to DWARF unwinding
+  EXPECT_EQ(_us.dwarf_regs.eip, 0x3201);
+  EXPECT_EQ(_us.dwarf_regs.ebp, word_addr(10));
+}
+
+} // namespace ddprof
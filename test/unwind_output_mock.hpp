@@ -29,16 +29,16 @@ static const char *s_so_paths[] = {"/app/lib/bar.0.so"};
 
 static inline void fill_symbol_table_1(SymbolTable &symbol_table) {
   for (unsigned i = 0; i < K_MOCK_LOC_SIZE; ++i) {
-    symbol_table.emplace_back(std::string(s_syn_names[i]),
-                              std::string(s_func_names[i]), 10 * i,
-                              std::string(s_src_paths[i]));
+    symbol_table.push_back(Symbol(symbol_table.intern(s_syn_names[i]),
+                                  symbol_table.intern(s_func_names[i]), 10 * i,
+                                  symbol_table.intern(s_src_paths[i])));
   }
 }
 
 static inline void fill_mapinfo_table_1(MapInfoTable &mapinfo_table) {
   for (unsigned i = 0; i < K_MOCK_LOC_SIZE; ++i) {
-    mapinfo_table.emplace_back(100 + i, 200 + i, 10 + i,
-                               std::string(s_so_paths[0]));
+    mapinfo_table.push_back(MapInfo(100 + i, 200 + i, 10 + i,
+                                    mapinfo_table.intern(s_so_paths[0])));
   }
 }
 
@@ -0,0 +1,191 @@
+// Unless explicitly stated otherwise all files in this repository are licensed
+// under the Apache License Version 2.0. This product includes software
+// developed at Datadog (https://www.datadoghq.com/). Copyright 2021-Present
+// Datadog, Inc.
+
+#include "worker_shard.hpp"
+
+#include "loghandle.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <string.h>
+#include <tuple>
+#include <vector>
+
+namespace ddprof {
+
+namespace {
+// (shard replaying the event, event type, position)
+typedef std::tuple<int, uint32_t, int> ReplayedEvent;
+std::mutex s_replayed_mutex;
+std::vector<ReplayedEvent> s_replayed;
+} // namespace
+
+// Side-band events are not applied : replays are recorded
+void worker_shard_replay_event(struct perf_event_header *hdr, int pos,
+                               WorkerShard *shard) {
+  std::lock_guard<std::mutex> lock(s_replayed_mutex);
+  s_replayed.emplace_back(shard->_idx, hdr->type, pos);
+}
+
+namespace {
+std::vector<ReplayedEvent> take_replayed() {
+  std::lock_guard<std::mutex> lock(s_replayed_mutex);
+  std::vector<ReplayedEvent> res;
+  res.swap(s_replayed);
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+// One watcher per CPU, event at index k watches CPU cpus[k]
+class PEventHdrHolder {
+public:
+  explicit PEventHdrHolder(const std::vector<int> &cpus)
+      : _pes(cpus.size()) {
+    memset(&_region, 0, sizeof(_region));
+    for (size_t k = 0; k < cpus.size(); ++k) {
+      memset(&_pes[k], 0, sizeof(PEvent));
+      _pes[k].pos = k;
+      _pes[k].cpu = cpus[k];
+      _pes[k].rb.region = &_region;
+    }
+    memset(&_hdr, 0, sizeof(_hdr));
+    _hdr.pes = _pes.data();
+    _hdr.size = _pes.size();
+    _hdr.max_size = _pes.size();
+  }
+
+  std::vector<PEvent> _pes;
+  PEventHdr _hdr;
+
+private:
+  perf_event_mmap_page _region;
+};
+
+DDRes run_noop(WorkerShard &) { return ddres_init(); }
+
+void push_samples(WorkerShard &shard, int nb_samples) {
+  UnwindOutput output;
+  uw_output_clear(&output);
+  for (int i = 0; i < nb_samples; ++i) {
+    // sample i of shard s has i + 1 frames with ip s * 100 + frame index
+    output.nb_locs = i + 1;
+    for (int j = 0; j <= i; ++j) {
+      output.locs[j].ip = shard._idx * 100 + j;
+    }
+    shard.push_sample(&output, shard._idx * 10 + i, i);
+  }
+}
+} // namespace
+
+TEST(WorkerShardTest, cpu_assignment) {
+  LogHandle handle;
+  // two watchers per CPU on 4 CPUs, the last one redirected to another buffer
+  PEventHdrHolder holder({0, 1, 2, 3, 0, 1, 2, 3});
+  holder._pes[7].rb.region = nullptr;
+  WorkerShardPool pool(3);
+  ASSERT_TRUE(IsDDResOK(pool.start(&holder._hdr)));
+  ASSERT_EQ(pool.size(), 3);
+  EXPECT_EQ(pool._shards[0]->_pevent_idx, std::vector<int>({0, 3, 4}));
+  EXPECT_EQ(pool._shards[1]->_pevent_idx, std::vector<int>({1, 5}));
+  EXPECT_EQ(pool._shards[2]->_pevent_idx, std::vector<int>({2, 6}));
+
+  // every shard runs once per round, with its own state
+  std::vector<int> nb_runs(pool.size(), 0);
+  ASSERT_TRUE(IsDDResOK(pool.run([&nb_runs](WorkerShard &shard) {
+    ++nb_runs[shard._idx];
+    return ddres_init();
+  })));
+  EXPECT_EQ(nb_runs, std::vector<int>({1, 1, 1}));
+}
+
+TEST(WorkerShardTest, replay_sideband) {
+  LogHandle handle;
+  PEventHdrHolder holder({0, 1, 2});
+  WorkerShardPool pool(3);
+  ASSERT_TRUE(IsDDResOK(pool.start(&holder._hdr)));
+  take_replayed();
+
+  perf_event_header fork_hdr = {PERF_RECORD_FORK, 0, sizeof(fork_hdr)};
+  perf_event_header mmap_hdr = {PERF_RECORD_MMAP, 0, sizeof(mmap_hdr)};
+  ASSERT_TRUE(IsDDResOK(pool.run([&](WorkerShard &shard) {
+    if (shard._idx == 1) {
+      shard.push_sideband(&fork_hdr, 7);
+      shard.push_sideband(&mmap_hdr, 8);
+    }
+    return ddres_init();
+  })));
+  // applied by the other shards at the start of the next round
+  EXPECT_TRUE(take_replayed().empty());
+
+  ASSERT_TRUE(IsDDResOK(pool.run(run_noop)));
+  std::vector<ReplayedEvent> expected = {
+      ReplayedEvent{0, PERF_RECORD_MMAP, 8},
+      ReplayedEvent{0, PERF_RECORD_FORK, 7},
+      ReplayedEvent{2, PERF_RECORD_MMAP, 8},
+      ReplayedEvent{2, PERF_RECORD_FORK, 7}};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(take_replayed(), expected);
+
+  // replayed once
+  ASSERT_TRUE(IsDDResOK(pool.run(run_noop)));
+  EXPECT_TRUE(take_replayed().empty());
+}
+
+TEST(WorkerShardTest, aggregate) {
+  LogHandle handle;
+  PEventHdrHolder holder({0, 1, 2});
+  WorkerShardPool pool(3);
+  ASSERT_TRUE(IsDDResOK(pool.start(&holder._hdr)));
+  ASSERT_TRUE(IsDDResOK(pool.run([](WorkerShard &shard) {
+    push_samples(shard, shard._idx + 1);
+    return ddres_init();
+  })));
+
+  // samples of all shards end up in a single export, with their frames
+  UnwindOutput output;
+  uw_output_clear(&output);
+  std::vector<std::pair<uint64_t, int>> aggregated;
+  auto fun = [&](const UnwindOutput *uw_output, SymbolHdr *symbol_hdr,
+                 uint64_t value, int pos) {
+    int shard_idx = value / 10;
+    EXPECT_EQ(symbol_hdr, &pool._shards[shard_idx]->_us.symbol_hdr);
+    EXPECT_EQ(uw_output->nb_locs, pos + 1);
+    for (int j = 0; j <= pos; ++j) {
+      EXPECT_EQ(uw_output->locs[j].ip, shard_idx * 100 + j);
+    }
+    aggregated.emplace_back(value, pos);
+    return ddres_init();
+  };
+  ASSERT_TRUE(IsDDResOK(pool.aggregate(&output, fun)));
+  std::vector<std::pair<uint64_t, int>> expected = {
+      {0, 0}, {10, 0}, {11, 1}, {20, 0}, {21, 1}, {22, 2}};
+  EXPECT_EQ(aggregated, expected);
+
+  // samples are only aggregated once
+  aggregated.clear();
+  ASSERT_TRUE(IsDDResOK(pool.aggregate(&output, fun)));
+  EXPECT_TRUE(aggregated.empty());
+
+  // on errors, remaining samples are dropped
+  ASSERT_TRUE(IsDDResOK(pool.run([](WorkerShard &shard) {
+    push_samples(shard, 2);
+    return ddres_init();
+  })));
+  int nb_calls = 0;
+  DDRes res = pool.aggregate(
+      &output, [&nb_calls](const UnwindOutput *, SymbolHdr *, uint64_t, int) {
+        ++nb_calls;
+        return ddres_warn(DD_WHAT_PPROF);
+      });
+  EXPECT_FALSE(IsDDResOK(res));
+  EXPECT_EQ(nb_calls, 1);
+  for (const std::unique_ptr<WorkerShard> &shard : pool._shards) {
+    EXPECT_TRUE(shard->_samples.empty());
+    EXPECT_TRUE(shard->_locs.empty());
+  }
+}
+
+} // namespace ddprof